@@ -23,9 +23,50 @@
 
 
 #include "AudioComponent.h"
+#include "../Processors/ProcessorGraph/ProcessorGraph.h"
+#include "../Processors/GenericProcessor/GenericProcessor.h"
+#include "../Processors/SourceNode/SourceNode.h"
 #include <stdio.h>
+#include <thread>
+#include <chrono>
+
+#define GRAPH_CLOCK_SAMPLE_RATE 44100.0
+#define GRAPH_CLOCK_DEFAULT_BLOCK_SIZE 1024
+#define GRAPH_CLOCK_SPIN_US 200
 
 AudioComponent::AudioComponent() : isPlaying(false)
+{
+    const StringArray parameters = JUCEApplication::getCommandLineParameterArray();
+    const int periodIndex = parameters.indexOf("--graph-clock");
+    const int samplesIndex = parameters.indexOf("--graph-clock-samples");
+
+    if (periodIndex >= 0 && periodIndex + 1 < parameters.size()
+        && parameters[periodIndex + 1].getDoubleValue() > 0)
+    {
+        graphClock = GraphClock::createPeriodic(parameters[periodIndex + 1].getDoubleValue());
+    }
+    else if (samplesIndex >= 0 && samplesIndex + 1 < parameters.size()
+             && parameters[samplesIndex + 1].getIntValue() > 0)
+    {
+        graphClock = GraphClock::createSampleTriggered(parameters[samplesIndex + 1].getIntValue());
+    }
+
+    graphPlayer = new AudioProcessorPlayer();
+
+    if (graphClock != nullptr)
+    {
+        std::cout << "Driving the processor graph from the graph clock; no audio device will be used." << std::endl;
+        return;
+    }
+
+    initialiseAudioDevice();
+
+    stopDevice(); // reduces the amount of background processing when
+    // device is not in use
+
+}
+
+void AudioComponent::initialiseAudioDevice()
 {
     // if this is nonempty, we got an error
     String error = deviceManager.initialise(0,  // numInputChannelsNeeded
@@ -102,13 +143,6 @@ AudioComponent::AudioComponent() : isPlaying(false)
     std::cout << "Audio output channels: " <<  oC.toInteger() << std::endl;
     std::cout << "Audio device sample rate: " <<  sr << std::endl;
     std::cout << "Audio device buffer size: " << buffSize << std::endl << std::endl;
-
-    graphPlayer = new AudioProcessorPlayer();
-
-    stopDevice(); // reduces the amount of background processing when
-    // device is not in use
-
-
 }
 
 AudioComponent::~AudioComponent()
@@ -121,6 +155,16 @@ AudioComponent::~AudioComponent()
 
 void AudioComponent::setBufferSize(int s)
 {
+    if (graphClock != nullptr)
+    {
+        if (s > 16 && s < 6000)
+            graphClock->setBlockSize(s);
+        else
+            std::cout << "Buffer size out of range." << std::endl;
+
+        return;
+    }
+
     AudioDeviceManager::AudioDeviceSetup setup;
     deviceManager.getAudioDeviceSetup(setup);
 
@@ -138,6 +182,9 @@ void AudioComponent::setBufferSize(int s)
 
 int AudioComponent::getBufferSize()
 {
+    if (graphClock != nullptr)
+        return graphClock->getBlockSize();
+
     AudioDeviceManager::AudioDeviceSetup setup;
     deviceManager.getAudioDeviceSetup(setup);
 
@@ -146,6 +193,9 @@ int AudioComponent::getBufferSize()
 
 int AudioComponent::getBufferSizeMs()
 {
+    if (graphClock != nullptr)
+        return jmax(1, roundToInt(graphClock->getPeriodMs()));
+
     AudioDeviceManager::AudioDeviceSetup setup;
     deviceManager.getAudioDeviceSetup(setup);
 
@@ -157,6 +207,9 @@ void AudioComponent::connectToProcessorGraph(AudioProcessorGraph* processorGraph
 
     graphPlayer->setProcessor(processorGraph);
 
+    if (graphClock != nullptr)
+        graphClock->setProcessor(processorGraph);
+
 }
 
 void AudioComponent::disconnectProcessorGraph()
@@ -164,6 +217,9 @@ void AudioComponent::disconnectProcessorGraph()
 
     graphPlayer->setProcessor(0);
 
+    if (graphClock != nullptr)
+        graphClock->setProcessor(nullptr);
+
 }
 
 bool AudioComponent::callbacksAreActive()
@@ -171,14 +227,32 @@ bool AudioComponent::callbacksAreActive()
     return isPlaying;
 }
 
+double AudioComponent::getCpuUsage()
+{
+    if (graphClock != nullptr)
+        return graphClock->getCpuUsage();
+
+    return deviceManager.getCpuUsage();
+}
+
+bool AudioComponent::usesGraphClock()
+{
+    return graphClock != nullptr;
+}
+
 void AudioComponent::restartDevice()
 {
+    if (graphClock != nullptr)
+        return;
+
     deviceManager.restartLastAudioDevice();
 
 }
 
 void AudioComponent::stopDevice()
 {
+    if (graphClock != nullptr)
+        return;
 
     deviceManager.closeAudioDevice();
 }
@@ -220,8 +294,17 @@ void AudioComponent::beginCallbacks()
         }
 
 
-        std::cout << std::endl << "Adding audio callback." << std::endl;
-        deviceManager.addAudioCallback(graphPlayer);
+        if (graphClock != nullptr)
+        {
+            std::cout << std::endl << "Starting graph clock." << std::endl;
+            graphClock->startThread(9); // SCHED_RR where permitted
+        }
+        else
+        {
+            std::cout << std::endl << "Adding audio callback." << std::endl;
+            deviceManager.addAudioCallback(graphPlayer);
+        }
+
         isPlaying = true;
     }
     else
@@ -259,8 +342,17 @@ void AudioComponent::endCallbacks()
     //     std::cout << "NOT THE MESSAGE THREAD -- AUDIO COMPONENT" << std::endl;
 
 
-    std::cout << std::endl << "Removing audio callback." << std::endl;
-    deviceManager.removeAudioCallback(graphPlayer);
+    if (graphClock != nullptr)
+    {
+        std::cout << std::endl << "Stopping graph clock." << std::endl;
+        graphClock->stopThread(1000);
+    }
+    else
+    {
+        std::cout << std::endl << "Removing audio callback." << std::endl;
+        deviceManager.removeAudioCallback(graphPlayer);
+    }
+
     isPlaying = false;
 
     stopDevice();
@@ -276,3 +368,178 @@ void AudioComponent::endCallbacks()
 
 }
 
+
+// ==================================================================
+
+GraphClock* GraphClock::createPeriodic(double periodMs)
+{
+    return new GraphClock(periodMs, 0);
+}
+
+GraphClock* GraphClock::createSampleTriggered(int numSamples)
+{
+    return new GraphClock(0.0, numSamples);
+}
+
+GraphClock::GraphClock(double periodMs_, int sampleThreshold_)
+    : Thread("Graph clock"), graph(nullptr), periodMs(periodMs_),
+      sampleThreshold(sampleThreshold_), blockSize(GRAPH_CLOCK_DEFAULT_BLOCK_SIZE)
+{
+    if (sampleThreshold > 0)
+    {
+        blockSize = jmax(blockSize, sampleThreshold);
+        periodMs = sampleThreshold / 30.0; // until the real source sample rate is known
+    }
+}
+
+GraphClock::~GraphClock()
+{
+    stopThread(1000);
+}
+
+void GraphClock::setProcessor(AudioProcessorGraph* graph_)
+{
+    jassert(!isThreadRunning());
+    graph = graph_;
+}
+
+void GraphClock::setBlockSize(int size)
+{
+    if (!isThreadRunning())
+        blockSize = jmax(size, sampleThreshold);
+}
+
+int GraphClock::getBlockSize()
+{
+    return blockSize;
+}
+
+double GraphClock::getPeriodMs()
+{
+    return periodMs;
+}
+
+double GraphClock::getCpuUsage()
+{
+    return cpuUsagePermille.get() / 1000.0;
+}
+
+bool GraphClock::sourcesAreReady()
+{
+    for (int i = 0; i < sourceBuffers.size(); i++)
+    {
+        if (sourceBuffers[i]->getNumSamples() < sampleThreshold)
+            return false;
+    }
+
+    return true;
+}
+
+void GraphClock::waitUntil(int64 ticks)
+{
+    const int64 ticksPerSecond = Time::getHighResolutionTicksPerSecond();
+    const int64 spinTicks = ticksPerSecond * GRAPH_CLOCK_SPIN_US / 1000000;
+
+    // sleep in whole milliseconds while that can't take us past the spin window
+    // (wait() also returns as soon as the thread is asked to stop)...
+    int64 remaining = ticks - Time::getHighResolutionTicks();
+
+    while (remaining - spinTicks > ticksPerSecond / 1000 && !threadShouldExit())
+    {
+        wait(int((remaining - spinTicks) * 1000 / ticksPerSecond));
+        remaining = ticks - Time::getHighResolutionTicks();
+    }
+
+    // ...sleep off the sub-millisecond part...
+    if (remaining > spinTicks)
+        std::this_thread::sleep_for(std::chrono::microseconds((remaining - spinTicks) * 1000000 / ticksPerSecond));
+
+    // ...and only yield through the last few hundred microseconds, where the
+    // scheduler can't be trusted to wake us on time
+    while (Time::getHighResolutionTicks() < ticks && !threadShouldExit())
+        Thread::yield();
+}
+
+void GraphClock::run()
+{
+    if (graph == nullptr)
+        return;
+
+    sourceBuffers.clear();
+
+    if (sampleThreshold > 0)
+    {
+        ProcessorGraph* processorGraph = dynamic_cast<ProcessorGraph*>(graph);
+
+        if (processorGraph != nullptr)
+        {
+            Array<GenericProcessor*> processors = processorGraph->getListOfProcessors();
+
+            for (int i = 0; i < processors.size(); i++)
+            {
+                SourceNode* source = dynamic_cast<SourceNode*>(processors[i]);
+
+                if (source != nullptr && source->getThread() != nullptr)
+                {
+                    if (sourceBuffers.size() == 0 && source->getSampleRate() > 0)
+                        periodMs = 1000.0 * sampleThreshold / source->getSampleRate();
+
+                    sourceBuffers.add(source->getThread()->getBufferAddress());
+                }
+            }
+        }
+    }
+
+    graph->setPlayConfigDetails(0, 2, GRAPH_CLOCK_SAMPLE_RATE, blockSize);
+    graph->prepareToPlay(GRAPH_CLOCK_SAMPLE_RATE, blockSize);
+
+    AudioSampleBuffer buffer(2, blockSize);
+    MidiBuffer midiMessages;
+
+    const int64 ticksPerSecond = Time::getHighResolutionTicksPerSecond();
+    int64 periodTicks = int64(periodMs * ticksPerSecond / 1000.0);
+
+    if (sampleThreshold > 0) // poll the sources a few times per expected period
+        periodTicks = jmax(ticksPerSecond / 10000, periodTicks / 4);
+
+    int64 nextTick = Time::getHighResolutionTicks() + periodTicks;
+    int64 busyTicks = 0;
+    int64 windowStart = Time::getHighResolutionTicks();
+
+    while (!threadShouldExit())
+    {
+        if (sampleThreshold == 0 || sourcesAreReady())
+        {
+            const int64 start = Time::getHighResolutionTicks();
+
+            {
+                const ScopedLock sl(graph->getCallbackLock());
+
+                buffer.clear();
+                midiMessages.clear();
+
+                if (!graph->isSuspended())
+                    graph->processBlock(buffer, midiMessages);
+            }
+
+            busyTicks += Time::getHighResolutionTicks() - start;
+        }
+
+        const int64 now = Time::getHighResolutionTicks();
+
+        if (now - windowStart > ticksPerSecond / 4)
+        {
+            cpuUsagePermille.set(int(1000 * busyTicks / (now - windowStart)));
+            busyTicks = 0;
+            windowStart = now;
+        }
+
+        if (now > nextTick + 10 * periodTicks)
+            nextTick = now; // fell far behind; don't try to catch up with a burst of callbacks
+
+        waitUntil(nextTick);
+        nextTick += periodTicks;
+    }
+
+    graph->releaseResources();
+}
@@ -26,6 +26,10 @@
 
 #include "../../JuceLibraryCode/JuceHeader.h"
 
+class DataBuffer;
+
+class GraphClock;
+
 /**
 
   Interfaces with system audio hardware.
@@ -38,7 +42,10 @@
   Determines the initial size of the sample buffer (crucial for
   real-time feedback latency).
 
-  @see MainWindow, ProcessorGraph
+  When started with "--graph-clock <ms>" or "--graph-clock-samples <n>", no audio
+  device is opened and the callbacks come from a GraphClock thread instead.
+
+  @see MainWindow, ProcessorGraph, GraphClock
 
 */
 
@@ -85,18 +92,84 @@ public:
     /** Sets the buffer size in samples.*/
     void setBufferSize(int);
 
+    /** Returns the fraction of the callback period spent processing (0 to 1).*/
+    double getCpuUsage();
+
+    /** Returns true if the graph is driven by a GraphClock rather than an audio device.*/
+    bool usesGraphClock();
+
     AudioDeviceManager deviceManager;
 
 private:
 
+    void initialiseAudioDevice();
+
     bool isPlaying;
 
     ScopedPointer<AudioProcessorPlayer> graphPlayer;
 
+    ScopedPointer<GraphClock> graphClock;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioComponent);
 
 };
 
+/**
+
+  Drives the ProcessorGraph from a dedicated high-priority thread, for machines
+  without sound hardware or when callbacks need a shorter, steadier period than
+  the audio device provides.
+
+  Either runs the graph on a fixed period, or as soon as every source's
+  DataBuffer holds at least a given number of samples.
+
+  @see AudioComponent
+
+*/
+
+class GraphClock : public Thread
+{
+public:
+    /** Creates a clock that runs the graph every periodMs milliseconds.*/
+    static GraphClock* createPeriodic(double periodMs);
+
+    /** Creates a clock that runs the graph whenever the sources have numSamples ready.*/
+    static GraphClock* createSampleTriggered(int numSamples);
+
+    ~GraphClock();
+
+    void setProcessor(AudioProcessorGraph* graph);
+
+    /** Sets the maximum number of samples handed to the graph per callback.*/
+    void setBlockSize(int size);
+    int getBlockSize();
+
+    /** Returns the nominal callback period in milliseconds.*/
+    double getPeriodMs();
+
+    /** Returns the fraction of the period spent inside processBlock (0 to 1).*/
+    double getCpuUsage();
+
+    void run();
+
+private:
+    GraphClock(double periodMs, int sampleThreshold);
+
+    bool sourcesAreReady();
+    void waitUntil(int64 ticks);
+
+    AudioProcessorGraph* graph;
+    Array<DataBuffer*> sourceBuffers;
+
+    double periodMs;
+    int sampleThreshold;
+    int blockSize;
+
+    Atomic<int> cpuUsagePermille;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GraphClock);
+};
+
 
 
 
@@ -0,0 +1,73 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BENCHMARK_H_2C7D41A9__
+#define __BENCHMARK_H_2C7D41A9__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  A timing run of one of the GUI's hot code paths on synthetic data.
+
+  Benchmarks are built into open-ephys-benchmarks (Builds/Linux/Makefile.benchmarks),
+  a console program that links the real processing code without the rest of
+  the application, so they run without hardware, a window or a signal chain.
+
+  Each benchmark is a static object, which registers itself when it is
+  constructed:
+
+  @code
+  static MyBenchmark myBenchmark;
+  @endcode
+
+  "open-ephys-benchmarks <name> [parameters]" runs one of them, and
+  "open-ephys-benchmarks all" runs all of them with their default parameters.
+
+*/
+
+class Benchmark
+{
+public:
+    Benchmark(const String& name, const String& description);
+    virtual ~Benchmark();
+
+    /** Runs the benchmark and prints its results.
+
+        The parameters are the command line arguments that follow the name.*/
+    virtual void run(const StringArray& parameters) = 0;
+
+    const String& getName() const { return name; }
+    const String& getDescription() const { return description; }
+
+    /** Returns every registered benchmark.*/
+    static Array<Benchmark*>& getBenchmarks();
+
+private:
+    String name;
+    String description;
+
+    JUCE_DECLARE_NON_COPYABLE(Benchmark);
+};
+
+#endif  // __BENCHMARK_H_2C7D41A9__
@@ -0,0 +1,85 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Benchmark.h"
+
+#include <iostream>
+
+Benchmark::Benchmark(const String& name_, const String& description_)
+    : name(name_), description(description_)
+{
+    getBenchmarks().add(this);
+}
+
+Benchmark::~Benchmark()
+{
+    getBenchmarks().removeFirstMatchingValue(this);
+}
+
+Array<Benchmark*>& Benchmark::getBenchmarks()
+{
+    static Array<Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+int main(int argc, char* argv[])
+{
+    StringArray parameters;
+
+    for (int i = 1; i < argc; i++)
+        parameters.add(argv[i]);
+
+    const Array<Benchmark*>& benchmarks = Benchmark::getBenchmarks();
+
+    if (parameters.size() == 0)
+    {
+        std::cout << "Usage: open-ephys-benchmarks all | <benchmark> [parameters]" << std::endl << std::endl;
+
+        for (int i = 0; i < benchmarks.size(); i++)
+            std::cout << "  " << benchmarks[i]->getName().paddedRight(' ', 10) << benchmarks[i]->getDescription() << std::endl;
+
+        return 0;
+    }
+
+    const String name = parameters[0];
+    parameters.remove(0);
+
+    bool found = false;
+
+    for (int i = 0; i < benchmarks.size(); i++)
+    {
+        if (name == "all" || name == benchmarks[i]->getName())
+        {
+            benchmarks[i]->run(parameters);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        std::cerr << "Unknown benchmark " << name << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Benchmark.h"
+#include "../Plugins/CAR/CARReference.h"
+
+#include <iostream>
+
+/**
+
+  Runs CARReference::process(), which does all of the CAR processor's work on
+  the samples, on noise, for every reference mode, with and without the
+  worker threads.
+
+  Parameters: channels=<n> and groupsize=<n> (each defaults to a few typical
+  values), blocksize=<samples> and blocks=<n>.
+
+*/
+
+class CARBenchmark : public Benchmark
+{
+public:
+    CARBenchmark()
+        : Benchmark ("car", "Common average reference: mean, median and trimmed mean")
+    {
+    }
+
+    void run (const StringArray& parameters) override
+    {
+        Array<int> channelCounts;
+        Array<int> groupSizes;
+        int blockSize = 1024;
+        int numBlocks = 50;
+
+        for (int i = 0; i < parameters.size(); ++i)
+        {
+            const String key = parameters[i].upToFirstOccurrenceOf ("=", false, false);
+            const String value = parameters[i].fromFirstOccurrenceOf ("=", false, false);
+
+            if (key == "channels")          channelCounts.add (value.getIntValue());
+            else if (key == "groupsize")    groupSizes.add (value.getIntValue());
+            else if (key == "blocksize")    blockSize = value.getIntValue();
+            else if (key == "blocks")       numBlocks = value.getIntValue();
+        }
+
+        if (channelCounts.size() == 0)
+        {
+            channelCounts.add (384);
+            channelCounts.add (1024);
+        }
+
+        if (groupSizes.size() == 0)
+        {
+            groupSizes.add (0);
+            groupSizes.add (96);
+        }
+
+        const char* modeNames[] = { "mean", "median", "trimmed mean" };
+        const double sampleRate = 30000.0;
+
+        CARReference reference;
+        reference.startWorkerThreads (SystemStats::getNumCpus() - 1);
+
+        Random random (1234);
+
+        std::cout << "CAR benchmark: " << blockSize << "-sample blocks, "
+                  << reference.getNumWorkerThreads() << " worker threads" << std::endl;
+
+        for (int c = 0; c < channelCounts.size(); ++c)
+        {
+            const int numChannels = channelCounts[c];
+
+            AudioSampleBuffer input (numChannels, blockSize);
+            AudioSampleBuffer buffer (numChannels, blockSize);
+
+            for (int n = 0; n < numChannels; ++n)
+                for (int i = 0; i < blockSize; ++i)
+                    input.setSample (n, i, (random.nextFloat() - 0.5f) * 200.0f);
+
+            Array<int> allChannels;
+            for (int n = 0; n < numChannels; ++n)
+                allChannels.add (n);
+
+            for (int g = 0; g < groupSizes.size(); ++g)
+            {
+                reference.setChannels (allChannels, allChannels, groupSizes[g], numChannels, blockSize);
+
+                const bool canThread = reference.getNumGroups() > 1 && reference.getNumWorkerThreads() > 0;
+
+                for (int mode = CARReference::MEAN_REFERENCE; mode <= CARReference::TRIMMED_MEAN_REFERENCE; ++mode)
+                {
+                    reference.setMode (static_cast<CARReference::Mode> (mode));
+
+                    for (int threaded = 0; threaded < (canThread ? 2 : 1); ++threaded)
+                    {
+                        reference.setUseWorkerThreads (threaded != 0);
+                        int64 ticks = 0;
+
+                        for (int block = 0; block < numBlocks; ++block)
+                        {
+                            for (int n = 0; n < numChannels; ++n)
+                                buffer.copyFrom (n, 0, input, n, 0, blockSize);
+
+                            const int64 start = Time::getHighResolutionTicks();
+                            reference.process (buffer.getArrayOfWritePointers(), blockSize, -1.0f);
+                            ticks += Time::getHighResolutionTicks() - start;
+                        }
+
+                        const double seconds = double (ticks) / double (Time::getHighResolutionTicksPerSecond());
+                        const double samplesPerSecond = double (blockSize) * numBlocks / seconds;
+
+                        std::cout << "  " << numChannels << " channels, " << reference.getNumGroups() << " group(s), "
+                                  << modeNames[mode] << (threaded ? ", threaded" : "") << ": "
+                                  << samplesPerSecond / sampleRate << "x real time at 30 kHz" << std::endl;
+                    }
+                }
+            }
+        }
+    }
+};
+
+static CARBenchmark carBenchmark;
@@ -0,0 +1,159 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Benchmark.h"
+#include "../Plugins/FilterNode/Dsp/Dsp.h"
+
+#include <iostream>
+
+/**
+
+  Filters noise with the FilterNode's two paths: a Butterworth band-pass
+  Dsp::Filter per channel, and one Dsp::BiquadBank for all of them. Both
+  are set up the way FilterNode::setFilterParameters() sets them up, with
+  the same 1024-sample smoothing of cutoff changes.
+
+  Parameters: channels=<n>, sources=<n> (the channels are split evenly over
+  this many data sources, which the bank never groups together),
+  rate=<Hz>, lowcut=<Hz>, highcut=<Hz>, blocksize=<samples> and blocks=<n>.
+
+*/
+
+class FilterBenchmark : public Benchmark
+{
+public:
+    FilterBenchmark()
+        : Benchmark("filter", "Per-channel band-pass filters against the BiquadBank")
+    {
+    }
+
+    void run(const StringArray& parameters) override
+    {
+        int numChannels = 128;
+        int numSources = 1;
+        double sampleRate = 30000.0;
+        double lowCut = 300.0;
+        double highCut = 6000.0;
+        int blockSize = 1024;
+        int numBlocks = 200;
+
+        for (int i = 0; i < parameters.size(); i++)
+        {
+            const String key = parameters[i].upToFirstOccurrenceOf("=", false, false);
+            const String value = parameters[i].fromFirstOccurrenceOf("=", false, false);
+
+            if (key == "channels")       numChannels = value.getIntValue();
+            else if (key == "sources")   numSources = value.getIntValue();
+            else if (key == "rate")      sampleRate = value.getDoubleValue();
+            else if (key == "lowcut")    lowCut = value.getDoubleValue();
+            else if (key == "highcut")   highCut = value.getDoubleValue();
+            else if (key == "blocksize") blockSize = value.getIntValue();
+            else if (key == "blocks")    numBlocks = value.getIntValue();
+        }
+
+        if (numChannels < 1 || numSources < 1 || blockSize < 1 || numBlocks < 1)
+        {
+            std::cerr << "Filter benchmark: invalid parameters" << std::endl;
+            return;
+        }
+
+        OwnedArray<Dsp::Filter> channelFilters;
+        Dsp::BiquadBank bank;
+        bank.setNumChannels(numChannels);
+
+        Dsp::Params params;
+        params[0] = sampleRate;
+        params[1] = 2;
+        params[2] = (highCut + lowCut)/2;
+        params[3] = highCut - lowCut;
+
+        Dsp::Butterworth::BandPass<2> design;
+        design.setup(2, params[0], params[2], params[3]);
+
+        for (int n = 0; n < numChannels; n++)
+        {
+            Dsp::Filter* filter = new Dsp::SmoothedFilterDesign
+                                  <Dsp::Butterworth::Design::BandPass<2>, 1, Dsp::DirectFormII>(1024);
+            filter->setParams(params);
+            channelFilters.add(filter);
+
+            bank.setChannelCoefficients(n, design, n * numSources / numChannels);
+            bank.setChannelEnabled(n, true);
+        }
+        bank.update();
+
+        AudioSampleBuffer channelBuffer(numChannels, blockSize);
+        AudioSampleBuffer bankBuffer(numChannels, blockSize);
+        HeapBlock<int> numSamples(numChannels);
+        Random random(1234);
+
+        int64 channelTicks = 0;
+        int64 bankTicks = 0;
+        float maxDifference = 0;
+
+        for (int block = 0; block < numBlocks; block++)
+        {
+            for (int n = 0; n < numChannels; n++)
+            {
+                numSamples[n] = blockSize;
+                float* samples = channelBuffer.getWritePointer(n);
+
+                for (int i = 0; i < blockSize; i++)
+                    samples[i] = (random.nextFloat() - 0.5f) * 200.0f;
+            }
+            for (int n = 0; n < numChannels; n++)
+                bankBuffer.copyFrom(n, 0, channelBuffer, n, 0, blockSize);
+
+            int64 start = Time::getHighResolutionTicks();
+
+            for (int n = 0; n < numChannels; n++)
+            {
+                float* ptr = channelBuffer.getWritePointer(n);
+                channelFilters[n]->process(blockSize, &ptr);
+            }
+
+            int64 middle = Time::getHighResolutionTicks();
+
+            bank.process(numSamples, bankBuffer.getArrayOfWritePointers());
+
+            int64 end = Time::getHighResolutionTicks();
+
+            channelTicks += middle - start;
+            bankTicks += end - middle;
+
+            for (int n = 0; n < numChannels; n++)
+                for (int i = 0; i < blockSize; i++)
+                    maxDifference = jmax(maxDifference, std::abs(channelBuffer.getSample(n, i) - bankBuffer.getSample(n, i)));
+        }
+
+        const double channelSamples = double(numChannels) * blockSize * numBlocks;
+        const double ticksPerSecond = double(Time::getHighResolutionTicksPerSecond());
+
+        std::cout << "Filter benchmark: " << numChannels << " channels in " << bank.getNumGroups() << " groups" << std::endl;
+        std::cout << "  per-channel filters (channels x samples/s): " << channelSamples * ticksPerSecond / channelTicks << std::endl;
+        std::cout << "  filter bank (channels x samples/s):         " << channelSamples * ticksPerSecond / bankTicks << std::endl;
+        std::cout << "  speedup: " << double(channelTicks) / bankTicks << ", max difference: " << maxDifference << std::endl;
+    }
+};
+
+static FilterBenchmark filterBenchmark;
@@ -0,0 +1,145 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Benchmark.h"
+#include "../Plugins/KWIKFormat/RecordEngine/HDF5FileFormat.h"
+
+#include <ctime>
+#include <iostream>
+
+/**
+
+  Writes band-limited noise to KWD files through KWDFile::writeRowData(),
+  the way the KWIK record engine writes continuous data, with the previous
+  row-by-row layout and with the chunked layouts the engine can be set to,
+  and prints the throughput, the CPU load and the size of each file.
+
+  Parameters: channels=<n>, blocksize=<samples> and blocks=<n>, and
+  chunklength=<samples>, chunkchannels=<n> and deflate=<level>, which set
+  the layout of the last run (the engine's defaults otherwise).
+
+*/
+
+class KWIKBenchmark : public Benchmark
+{
+public:
+    KWIKBenchmark()
+        : Benchmark ("kwik", "KWD continuous data writes: row writes, buffered chunks and compression")
+    {
+    }
+
+    void run (const StringArray& parameters) override
+    {
+        int numChannels = 64;
+        int blockSize = 1024;
+        int numBlocks = 300;
+        const float sampleRate = 30000.0f;
+
+        KWDSettings settings[4];
+        const char* names[4] = { "row writes (previous layout)", "buffered chunks",
+                                 "buffered, shuffle + deflate 1", "engine settings" };
+        settings[0].bufferWrites = false;
+        settings[2].deflateLevel = 1;
+
+        for (int i = 0; i < parameters.size(); ++i)
+        {
+            const String key = parameters[i].upToFirstOccurrenceOf ("=", false, false);
+            const String value = parameters[i].fromFirstOccurrenceOf ("=", false, false);
+
+            if (key == "channels")              numChannels = value.getIntValue();
+            else if (key == "blocksize")        blockSize = value.getIntValue();
+            else if (key == "blocks")           numBlocks = value.getIntValue();
+            else if (key == "chunklength")      settings[3].chunkLength = value.getIntValue();
+            else if (key == "chunkchannels")    settings[3].chunkChannels = value.getIntValue();
+            else if (key == "deflate")          settings[3].deflateLevel = value.getIntValue();
+        }
+
+        // band-limited noise compresses about as well as real recordings do
+        HeapBlock<int16> data (numChannels * blockSize * 8);
+        Random random (1234);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float value = 0;
+            for (int i = 0; i < blockSize * 8; ++i)
+            {
+                value = 0.9f * value + (random.nextFloat() - 0.5f) * 200.0f;
+                data[ch * blockSize * 8 + i] = int16 (value);
+            }
+        }
+
+        HDF5RecordingInfo info;
+        info.name = "KWIK benchmark";
+        info.start_time = 0;
+        info.start_sample = 0;
+        info.sample_rate = sampleRate;
+        info.bit_depth = 16;
+        info.multiSample = false;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            info.bitVolts.add (0.195f);
+            info.channelSampleRates.add (sampleRate);
+        }
+
+        File dir = File::getSpecialLocation (File::tempDirectory).getChildFile ("kwik_benchmark");
+        dir.createDirectory();
+        const double megabytes = double (numChannels) * blockSize * numBlocks * sizeof (int16) / (1024.0 * 1024.0);
+
+        std::cout << "KWIK benchmark: " << numChannels << " channels, " << numBlocks << " blocks of "
+                  << blockSize << " samples (" << megabytes << " MB)" << std::endl;
+
+        for (int i = 0; i < numElementsInArray (settings); ++i)
+        {
+            KWDFile file;
+            file.initFile (i, dir.getFullPathName() + File::separatorString + "experiment");
+            file.setSettings (settings[i]);
+
+            const double start = Time::getMillisecondCounterHiRes();
+            const std::clock_t cpuStart = std::clock();
+
+            file.open (numChannels);
+            file.startNewRecording (0, numChannels, &info);
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                const int offset = (block % 8) * blockSize;
+                for (int ch = 0; ch < numChannels; ++ch)
+                    file.writeRowData (data + ch * blockSize * 8 + offset, blockSize, ch);
+            }
+            file.stopRecording();
+            file.close();
+
+            const double seconds = (Time::getMillisecondCounterHiRes() - start) / 1000.0;
+            const double cpuSeconds = double (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+            File written (file.getFileName());
+
+            std::cout << "  " << names[i] << ": " << megabytes / seconds << " MB/s, "
+                      << 100.0 * cpuSeconds / seconds << "% CPU, "
+                      << written.getSize() / (1024 * 1024) << " MB on disk" << std::endl;
+
+            written.deleteFile();
+        }
+
+        dir.deleteRecursively();
+    }
+};
+
+static KWIKBenchmark kwikBenchmark;
@@ -0,0 +1,155 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Benchmark.h"
+#include "../Processors/DataThreads/DataBuffer.h"
+#include "../Processors/DataThreads/RhythmNode/RHD2000Decoder.h"
+#include "../Processors/DataThreads/RhythmNode/RHD2000Replay.h"
+
+#include <iostream>
+
+/**
+
+  Pushes replayed Rhythm USB blocks through RHD2000Decoder::decodeBlockToBuffer(),
+  the path RHD2000Thread::updateBuffer() takes for every block, as fast as possible.
+
+  Parameters: capture=<file> (written by the GUI started with --rhd-capture),
+  or a synthetic configuration with streams=<n>, chip=<id>, channels=<n>,
+  usb2 or usb3, and adc; then blocks=<n> and seconds=<s>.
+
+*/
+
+class RHD2000Benchmark : public Benchmark
+{
+public:
+    RHD2000Benchmark()
+        : Benchmark("rhd2000", "Rhythm USB block decoding into a DataBuffer")
+    {
+    }
+
+    void run(const StringArray& parameters) override
+    {
+        String captureFile;
+        int numStreams = 8;
+        int chipId = CHIP_ID_RHD2132;
+        int channels = 32;
+        bool usb3 = false;
+        bool adcs = false;
+        int numBlocks = 64;
+        double seconds = 5.0;
+
+        for (int i = 0; i < parameters.size(); i++)
+        {
+            const String key = parameters[i].upToFirstOccurrenceOf("=", false, false);
+            const String value = parameters[i].fromFirstOccurrenceOf("=", false, false);
+
+            if (key == "capture")       captureFile = value;
+            else if (key == "streams")  numStreams = value.getIntValue();
+            else if (key == "chip")     chipId = value.getIntValue();
+            else if (key == "channels") channels = value.getIntValue();
+            else if (key == "blocks")   numBlocks = value.getIntValue();
+            else if (key == "seconds")  seconds = value.getDoubleValue();
+            else if (key == "usb3")     usb3 = true;
+            else if (key == "usb2")     usb3 = false;
+            else if (key == "adc")      adcs = true;
+        }
+
+        RHD2000Replay replay;
+
+        if (captureFile.isNotEmpty())
+        {
+            if (!replay.loadCapture(File::getCurrentWorkingDirectory().getChildFile(captureFile)))
+                return;
+        }
+        else
+        {
+            Array<int> chipIds, channelsPerStream;
+
+            for (int stream = 0; stream < numStreams; stream++)
+            {
+                chipIds.add(chipId == CHIP_ID_RHD2164 && stream % 2 == 1 ? CHIP_ID_RHD2164_B : chipId);
+                channelsPerStream.add(channels);
+            }
+
+            replay.generateSyntheticBlocks(chipIds, channelsPerStream, adcs, usb3, numBlocks);
+        }
+
+        RHD2000Decoder decoder;
+        decoder.setConfiguration(replay.getChipIds(), replay.getChannelsPerStream(),
+                                 replay.getAdcsEnabled(), replay.getSamplesPerBlock());
+
+        const int numChannels = decoder.getNumChannels();
+
+        // drained the same way the SourceNode reads it
+        DataBuffer dataBuffer(numChannels, 10000);
+        AudioSampleBuffer readBuffer(numChannels, 10000);
+        HeapBlock<uint64> readEventCodes(10000);
+        uint64 readTimestamp;
+
+        std::cout << "RHD2000 decode benchmark: " << replay.getChannelsPerStream().size() << " streams, "
+                  << numChannels << " channels, " << (replay.isUSB3() ? "USB3" : "USB2") << ", "
+                  << replay.getSamplesPerBlock() << " samples and " << replay.getBlockSizeInBytes()
+                  << " bytes per block" << std::endl;
+
+        const int64 ticksPerSecond = Time::getHighResolutionTicksPerSecond();
+        const int64 endTicks = Time::getHighResolutionTicks() + int64(seconds * ticksPerSecond);
+
+        int64 decodeTicks = 0;
+        int64 maxBlockTicks = 0;
+        int64 totalBlocks = 0;
+        int64 totalSamples = 0;
+        int64 startTicks = Time::getHighResolutionTicks();
+
+        while (Time::getHighResolutionTicks() < endTicks)
+        {
+            const unsigned char* block = replay.getNextBlock();
+
+            const int64 blockStart = Time::getHighResolutionTicks();
+
+            const int numSamples = decoder.decodeBlockToBuffer(block, dataBuffer);
+
+            const int64 blockTicks = Time::getHighResolutionTicks() - blockStart;
+
+            decodeTicks += blockTicks;
+            maxBlockTicks = jmax(maxBlockTicks, blockTicks);
+            totalBlocks++;
+            totalSamples += numSamples;
+
+            if (dataBuffer.getNumSamples() > 5000)
+                dataBuffer.readAllFromBuffer(readBuffer, &readTimestamp, readEventCodes, readBuffer.getNumSamples());
+        }
+
+        const double wallTime = double(Time::getHighResolutionTicks() - startTicks) / ticksPerSecond;
+        const double decodeTime = double(decodeTicks) / ticksPerSecond;
+
+        std::cout << "  blocks:                 " << totalBlocks << std::endl;
+        std::cout << "  samples/s:              " << totalSamples / decodeTime << std::endl;
+        std::cout << "  channels x samples/s:   " << totalSamples * numChannels / decodeTime << std::endl;
+        std::cout << "  raw MB/s:               " << totalBlocks * replay.getBlockSizeInBytes() / decodeTime / 1e6 << std::endl;
+        std::cout << "  mean block latency (us): " << decodeTime / totalBlocks * 1e6 << std::endl;
+        std::cout << "  max block latency (us):  " << double(maxBlockTicks) / ticksPerSecond * 1e6 << std::endl;
+        std::cout << "  decode share of wall time: " << 100.0 * decodeTime / wallTime << "%" << std::endl;
+    }
+};
+
+static RHD2000Benchmark rhd2000Benchmark;
@@ -139,7 +139,7 @@ int getExperimentNumber()
 	return getProcessorGraph()->getRecordNode()->getExperimentNumber();
 }
 
-void writeSpike(SpikeObject& spike, int electrodeIndex)
+void writeSpike(const SpikeObject& spike, int electrodeIndex)
 {
     getProcessorGraph()->getRecordNode()->writeSpike(spike, electrodeIndex);
 }
@@ -98,7 +98,7 @@ PLUGIN_API int getExperimentNumber();
 
 /* Spike related methods. See record engine documentation */
 
-PLUGIN_API void writeSpike(SpikeObject& spike, int electrodeIndex);
+PLUGIN_API void writeSpike(const SpikeObject& spike, int electrodeIndex);
 PLUGIN_API void registerSpikeSource(GenericProcessor* processor);
 PLUGIN_API int addSpikeElectrode(SpikeRecordInfo* elec);
 };
@@ -24,6 +24,130 @@
 #include <stdio.h>
 #include "SpikeDetector.h"
 
+#include <limits>
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define SPIKEDETECTOR_SSE 1
+#endif
+
+#define NOISE_SEGMENT_SECONDS 2
+
+// the noise histogram spans this fraction of a channel's 16-bit range: 0.39 uV
+// bins from -200 to 200 uV for headstage channels (0.195 uV per bit)
+#define NOISE_RANGE_FRACTION (1.0f / 32)
+
+NoiseEstimator::NoiseEstimator()
+    : binWidth(0.5f), segmentSamples(1), currentSegment(0), windowSize(0)
+{
+    segmentCounts.calloc(numBins * numSegments);
+    windowCounts.calloc(numBins);
+
+    for (int i = 0; i < numSegments; i++)
+        segmentSizes[i] = 0;
+}
+
+void NoiseEstimator::reset(int segmentSamples_, float range)
+{
+    if (range > 0)
+        binWidth = range / numBins;
+
+    // segment counts are 16 bit
+    segmentSamples = jlimit(1, 65535, segmentSamples_);
+    currentSegment = 0;
+    windowSize = 0;
+
+    segmentCounts.clear(numBins * numSegments);
+    windowCounts.clear(numBins);
+
+    for (int i = 0; i < numSegments; i++)
+        segmentSizes[i] = 0;
+}
+
+void NoiseEstimator::addSamples(const float* samples, int numSamples)
+{
+    const float offset = binWidth * numBins / 2;
+    const float scale = 1.0f / binWidth;
+
+    while (numSamples > 0)
+    {
+        const int n = jmin(numSamples, segmentSamples - segmentSizes[currentSegment]);
+        uint16* segment = segmentCounts + currentSegment * numBins;
+
+        for (int i = 0; i < n; i++)
+        {
+            const int bin = jlimit(0, numBins - 1, int((samples[i] + offset) * scale));
+            segment[bin]++;
+            windowCounts[bin]++;
+        }
+
+        segmentSizes[currentSegment] += n;
+        windowSize += n;
+        samples += n;
+        numSamples -= n;
+
+        if (segmentSizes[currentSegment] == segmentSamples)
+        {
+            // the oldest segment makes room for the next one
+            currentSegment = (currentSegment + 1) % numSegments;
+            segment = segmentCounts + currentSegment * numBins;
+
+            for (int bin = 0; bin < numBins; bin++)
+                windowCounts[bin] -= segment[bin];
+
+            windowSize -= segmentSizes[currentSegment];
+            segmentSizes[currentSegment] = 0;
+            zeromem(segment, numBins * sizeof(uint16));
+        }
+    }
+}
+
+bool NoiseEstimator::isReady() const
+{
+    return windowSize >= uint32(segmentSamples);
+}
+
+float NoiseEstimator::getMedianAbsoluteDeviation() const
+{
+    if (windowSize == 0)
+        return 0;
+
+    const uint32 half = (windowSize + 1) / 2;
+
+    // the bin holding the median
+    int median = 0;
+    uint32 below = 0;
+
+    while (below + windowCounts[median] < half)
+        below += windowCounts[median++];
+
+    // the spread is below the resolution of the histogram
+    if (windowCounts[median] >= half)
+        return 0;
+
+    // widen a window around it until it holds half of the samples
+    int radius = 0;
+    uint32 inside = windowCounts[median];
+    uint32 previous = 0;
+
+    while (inside < half)
+    {
+        previous = inside;
+        radius++;
+
+        if (median - radius >= 0)
+            inside += windowCounts[median - radius];
+        if (median + radius < numBins)
+            inside += windowCounts[median + radius];
+    }
+
+    // interpolate within the last ring of bins
+    const float fraction = float(half - previous) / float(inside - previous);
+
+    return jmax(0.0f, (radius - 0.5f + fraction) * binWidth);
+}
+
 SpikeDetector::SpikeDetector()
     : GenericProcessor("Spike Detector"),
       overflowBuffer(2,100), dataBuffer(nullptr),
@@ -62,8 +186,6 @@ SpikeDetector::SpikeDetector()
         electrodeCounter.add(0);
     }
 
-    //spikeBuffer = new uint8_t[MAX_SPIKE_BUFFER_LEN]; // MAX_SPIKE_BUFFER_LEN defined in SpikeObject.h
-	spikeBuffer.malloc(MAX_SPIKE_BUFFER_LEN);
 
 }
 
@@ -145,6 +267,9 @@ bool SpikeDetector::addElectrode(int nChans, int electrodeID)
     newElectrode->postPeakSamples = 32;
     newElectrode->thresholds.malloc(nChans);
     newElectrode->isActive.malloc(nChans);
+    newElectrode->isAdaptive.malloc(nChans);
+    newElectrode->manualThresholds.malloc(nChans);
+    newElectrode->adaptiveMultipliers.malloc(nChans);
     newElectrode->channels.malloc(nChans);
     newElectrode->isMonitored = false;
 
@@ -153,6 +278,10 @@ bool SpikeDetector::addElectrode(int nChans, int electrodeID)
         *(newElectrode->channels+i) = firstChan+i;
         *(newElectrode->thresholds+i) = getDefaultThreshold();
         *(newElectrode->isActive+i) = true;
+        *(newElectrode->isAdaptive+i) = false;
+        *(newElectrode->manualThresholds+i) = getDefaultThreshold();
+        *(newElectrode->adaptiveMultipliers+i) = getDefaultAdaptiveMultiplier();
+        newElectrode->noiseEstimators.add(new NoiseEstimator());
     }
 
     if (electrodeID > 0) {
@@ -179,6 +308,12 @@ float SpikeDetector::getDefaultThreshold()
     return 50.0f;
 }
 
+float SpikeDetector::getDefaultAdaptiveMultiplier()
+{
+    // about 4 standard deviations of gaussian noise
+    return 6.0f;
+}
+
 StringArray SpikeDetector::getElectrodeNames()
 {
     StringArray names;
@@ -291,6 +426,34 @@ double SpikeDetector::getChannelThreshold(int electrodeNum, int channelNum)
     return *(electrodes[electrodeNum]->thresholds+channelNum);
 }
 
+void SpikeDetector::setChannelAdaptive(int electrodeNum, int channelNum, bool adaptive)
+{
+    currentElectrode = electrodeNum;
+    currentChannelIndex = channelNum;
+
+    if (adaptive)
+        setParameter(97, 1);
+    else
+        setParameter(97, 0);
+}
+
+bool SpikeDetector::isChannelAdaptive(int electrodeNum, int channelNum)
+{
+    return *(electrodes[electrodeNum]->isAdaptive+channelNum);
+}
+
+void SpikeDetector::setAdaptiveMultiplier(int electrodeNum, int channelNum, float multiplier)
+{
+    currentElectrode = electrodeNum;
+    currentChannelIndex = channelNum;
+    setParameter(96, multiplier);
+}
+
+double SpikeDetector::getAdaptiveMultiplier(int electrodeNum, int channelNum)
+{
+    return *(electrodes[electrodeNum]->adaptiveMultipliers+channelNum);
+}
+
 void SpikeDetector::setParameter(int parameterIndex, float newValue)
 {
     //editor->updateParameterButtons(parameterIndex);
@@ -298,6 +461,7 @@ void SpikeDetector::setParameter(int parameterIndex, float newValue)
     if (parameterIndex == 99 && currentElectrode > -1)
     {
         *(electrodes[currentElectrode]->thresholds+currentChannelIndex) = newValue;
+        *(electrodes[currentElectrode]->manualThresholds+currentChannelIndex) = newValue;
     }
     else if (parameterIndex == 98 && currentElectrode > -1)
     {
@@ -306,6 +470,19 @@ void SpikeDetector::setParameter(int parameterIndex, float newValue)
         else
             *(electrodes[currentElectrode]->isActive+currentChannelIndex) = true;
     }
+    else if (parameterIndex == 97 && currentElectrode > -1)
+    {
+        *(electrodes[currentElectrode]->isAdaptive+currentChannelIndex) = (newValue != 0.0f);
+
+        // back to the user's threshold
+        if (newValue == 0.0f)
+            *(electrodes[currentElectrode]->thresholds+currentChannelIndex) =
+                *(electrodes[currentElectrode]->manualThresholds+currentChannelIndex);
+    }
+    else if (parameterIndex == 96 && currentElectrode > -1)
+    {
+        *(electrodes[currentElectrode]->adaptiveMultipliers+currentChannelIndex) = newValue;
+    }
 }
 
 
@@ -320,6 +497,17 @@ bool SpikeDetector::enable()
     for (int i = 0; i < electrodes.size(); i++)
         useOverflowBuffer.add(false);
 
+    for (int i = 0; i < electrodes.size(); i++)
+    {
+        for (int j = 0; j < electrodes[i]->numChannels; j++)
+        {
+            const float range = 65536.0f * channels[*(electrodes[i]->channels+j)]->bitVolts;
+
+            electrodes[i]->noiseEstimators[j]->reset(int(getSampleRate()) * NOISE_SEGMENT_SECONDS,
+                                                     range * NOISE_RANGE_FRACTION);
+        }
+    }
+
     return true;
 }
 
@@ -339,14 +527,7 @@ void SpikeDetector::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int p
 
     // std::cout << "Adding spike event for index " << peakIndex << std::endl;
 
-    s->eventType = SPIKE_EVENT_CODE;
-
-    int numBytes = packSpike(s,                        // SpikeObject
-                             spikeBuffer,              // uint8_t*
-                             MAX_SPIKE_BUFFER_LEN);    // int
-
-    if (numBytes > 0)
-        eventBuffer.addEvent(spikeBuffer, numBytes, peakIndex);
+    spikeEvents.addSpikeEvent(eventBuffer, s, peakIndex);
 
     //std::cout << "Adding spike" << std::endl;
 }
@@ -384,43 +565,43 @@ void SpikeDetector::addWaveformToSpikeObject(SpikeObject* s,
     s->gain[currentChannel] = (int)(1.0f / channels[chan]->bitVolts)*1000;
     s->threshold[currentChannel] = (int) *(electrodes[electrodeNumber]->thresholds+currentChannel); // / channels[chan]->bitVolts * 1000;
 
-    // cycle through buffer
-
     if (isChannelActive(electrodeNumber, currentChannel))
     {
+        // the waveform starts one sample earlier, as the peak index is the one after the minimum
+        const int firstIndex = peakIndex - electrodes[electrodeNumber]->prePeakSamples - 1;
+        const float bitVolts = channels[chan]->bitVolts;
 
-        for (int sample = 0; sample < spikeLength; sample++)
+        if (firstIndex >= 0 && firstIndex + spikeLength <= dataBuffer->getNumSamples())
         {
+            const float* source = dataBuffer->getReadPointer(chan, firstIndex);
 
-            // warning -- be careful of bitvolts conversion
-            s->data[currentIndex] = uint16(getNextSample(*(electrodes[electrodeNumber]->channels+currentChannel)) / channels[chan]->bitVolts + 32768);
-
-            currentIndex++;
-            sampleIndex++;
-
-            //std::cout << currentIndex << std::endl;
-
+            for (int sample = 0; sample < spikeLength; sample++)
+            {
+                // warning -- be careful of bitvolts conversion
+                s->data[currentIndex] = uint16(source[sample] / bitVolts + 32768);
+                currentIndex++;
+            }
+        }
+        else
+        {
+            // the waveform reaches into the previous buffer
+            for (int sample = 0; sample < spikeLength; sample++)
+            {
+                s->data[currentIndex] = uint16(getSample(chan, firstIndex + sample) / bitVolts + 32768);
+                currentIndex++;
+            }
         }
     }
     else
     {
         for (int sample = 0; sample < spikeLength; sample++)
         {
-
             // insert a blank spike if the
             s->data[currentIndex] = 0;
             currentIndex++;
-            sampleIndex++;
-
-            //std::cout << currentIndex << std::endl;
-
         }
     }
 
-
-    sampleIndex -= spikeLength; // reset sample index
-
-
 }
 
 void SpikeDetector::handleEvent(int eventType, MidiMessage& event, int sampleNum)
@@ -444,117 +625,96 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
     SimpleElectrode* electrode;
     dataBuffer = &buffer;
 
-    checkForEvents(events); // need to find any timestamp events before extracting spikes
+    spikeEvents.clear();
 
-    //std::cout << dataBuffer.getMagnitude(0,nSamples) << std::endl;
+    checkForEvents(events); // need to find any timestamp events before extracting spikes
 
     for (int i = 0; i < electrodes.size(); i++)
     {
 
-        //  std::cout << "ELECTRODE " << i << std::endl;
-
         electrode = electrodes[i];
 
-        // refresh buffer index for this electrode
-        sampleIndex = electrode->lastBufferIndex - 1; // subtract 1 to account for
-        // increment at start of getNextSample()
-
         int nSamples = getNumSamples(*electrode->channels);
 
-        // cycle through samples
-        while (samplesAvailable(nSamples))
+        updateAdaptiveThresholds(electrode, nSamples);
+
+        // samples are scanned from where the last buffer left off, up to half the
+        // overflow buffer before the end, so that there is room for the peak
+        int scanIndex = electrode->lastBufferIndex;
+        const int lastScanIndex = nSamples - overflowBufferSize/2 + 1;
+
+        // first pass: the next threshold crossing of each channel
+        int nextCrossing[MAX_NUMBER_OF_SPIKE_CHANNELS];
+
+        for (int chan = 0; chan < electrode->numChannels; chan++)
+        {
+            if (*(electrode->isActive+chan))
+                nextCrossing[chan] = findThresholdCrossing(*(electrode->channels+chan), scanIndex,
+                                                           lastScanIndex, *(electrode->thresholds+chan));
+            else
+                nextCrossing[chan] = lastScanIndex + 1;
+        }
+
+        // second pass: extract a spike at the earliest crossing, then look
+        // for the next crossing after it
+        while (scanIndex <= lastScanIndex)
         {
+            int triggerChannel = 0;
+
+            for (int chan = 1; chan < electrode->numChannels; chan++)
+            {
+                if (nextCrossing[chan] < nextCrossing[triggerChannel])
+                    triggerChannel = chan;
+            }
+
+            if (nextCrossing[triggerChannel] > lastScanIndex)
+            {
+                scanIndex = lastScanIndex + 1;
+                break;
+            }
+
+            int peakIndex = findPeak(*(electrode->channels+triggerChannel),
+                                     nextCrossing[triggerChannel],
+                                     electrode->postPeakSamples);
+
+            SpikeObject* newSpike = spikeEvents.getNewSpike();
+            newSpike->timestamp = 0; //getTimestamp(currentChannel) + peakIndex;
+            newSpike->timestamp_software = -1;
+            newSpike->source = i;
+            newSpike->nChannels = electrode->numChannels;
+            newSpike->sortedId = 0;
+            newSpike->electrodeID = electrode->electrodeID;
+            newSpike->channel = 0;
+            newSpike->samplingFrequencyHz = sampleRateForElectrode;
+
+            currentIndex = 0;
+
+            // package spikes;
+            for (int channel = 0; channel < electrode->numChannels; channel++)
+            {
+
+                addWaveformToSpikeObject(newSpike,
+                                         peakIndex,
+                                         i,
+                                         channel);
+
+            }
+
+            addSpikeEvent(newSpike, events, peakIndex);
+
+            // advance the sample index
+            scanIndex = peakIndex + electrode->postPeakSamples + 1;
 
-            sampleIndex++;
-            // cycle through channels
             for (int chan = 0; chan < electrode->numChannels; chan++)
             {
-                // std::cout << "  channel " << chan << std::endl;
-                if (*(electrode->isActive+chan))
-                {
-                    int currentChannel = *(electrode->channels+chan);
+                if (nextCrossing[chan] < scanIndex)
+                    nextCrossing[chan] = findThresholdCrossing(*(electrode->channels+chan), scanIndex,
+                                                               lastScanIndex, *(electrode->thresholds+chan));
+            }
 
-                    if (-getNextSample(currentChannel) > *(electrode->thresholds+chan)) // trigger spike
-                    {
-                        //std::cout << "Spike detected on electrode " << i << std::endl;
-                        // find the peak
-                        int peakIndex = sampleIndex;
-
-                        while (-getCurrentSample(currentChannel) <
-                               -getNextSample(currentChannel) &&
-                               sampleIndex < peakIndex + electrode->postPeakSamples)
-                        {
-                            sampleIndex++;
-                        }
-
-                        peakIndex = sampleIndex;
-                        sampleIndex -= (electrode->prePeakSamples+1);
-                        
-//                        uint8_t     eventType;
-//                        int64_t    timestamp;
-//                        int64_t    timestamp_software;
-//                        uint16_t    source; // used internally, the index of the electrode in the electrode array
-//                        uint16_t    nChannels;
-//                        uint16_t    nSamples;
-//                        uint16_t    sortedId;   // sorted unit ID (or 0 if unsorted)
-//                        uint16_t    electrodeID; // unique electrode ID (regardless electrode position in the array)
-//                        uint16_t    channel; // the channel in which threshold crossing was detected (index in channel array, not absolute channel number).
-//                        uint8_t     color[3];
-//                        float       pcProj[2];
-//                        uint16_t    samplingFrequencyHz;
-//                        uint16_t    data[MAX_NUMBER_OF_SPIKE_CHANNELS* MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES];
-//                        float       gain[MAX_NUMBER_OF_SPIKE_CHANNELS];
-//                        uint16_t    threshold[MAX_NUMBER_OF_SPIKE_CHANNELS];
-
-                        SpikeObject newSpike;
-                        newSpike.timestamp = 0; //getTimestamp(currentChannel) + peakIndex;
-                        newSpike.timestamp_software = -1;
-                        newSpike.source = i;
-                        newSpike.nChannels = electrode->numChannels;
-                        newSpike.sortedId = 0;
-                        newSpike.electrodeID = electrode->electrodeID;
-                        newSpike.channel = 0;
-                        newSpike.samplingFrequencyHz = sampleRateForElectrode;
-
-                        currentIndex = 0;
-
-                        // package spikes;
-                        for (int channel = 0; channel < electrode->numChannels; channel++)
-                        {
-
-                            addWaveformToSpikeObject(&newSpike,
-                                                     peakIndex,
-                                                     i,
-                                                     channel);
-
-                            // if (*(electrode->isActive+currentChannel))
-                            // {
-
-                            //     createSpikeEvent(peakIndex,       // peak index
-                            //                      i,               // electrodeNumber
-                            //                      currentChannel,  // channel number
-                            //                      events);         // event buffer
-
-
-                            // } // end if channel is active
-
-                        }
-
-                        //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
-                        addSpikeEvent(&newSpike, events, peakIndex);
-
-                        // advance the sample index
-                        sampleIndex = peakIndex + electrode->postPeakSamples;
-
-                        break; // quit spike "for" loop
-                    } // end spike trigger
-
-                } // end if channel is active
-            } // end cycle through channels on electrode
-
-        } // end cycle through samples
-
-        electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
+        } // end cycle through spikes
+
+        electrode->lastBufferIndex = jmax(scanIndex - 1, lastScanIndex) - nSamples; // should be negative
 
         //jassert(electrode->lastBufferIndex < 0);
 
@@ -581,95 +741,149 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
 
     } // end cycle through electrodes
 
-    // copy end of this buffer into the overflow buffer
-
-    //std::cout << "Copying buffer" << std::endl;
-    // std::cout << "nSamples: " << nSamples;
-    //std::cout << "overflowBufferSize:" << overflowBufferSize;
+}
 
-    //std::cout << "sourceStartSample = " << nSamples-overflowBufferSize << std::endl;
-    // std::cout << "numSamples = " << overflowBufferSize << std::endl;
-    // std::cout << "buffer size = " << buffer.getNumSamples() << std::endl;
+void SpikeDetector::updateAdaptiveThresholds(SimpleElectrode* electrode, int nSamples)
+{
+    for (int chan = 0; chan < electrode->numChannels; chan++)
+    {
+        if (!*(electrode->isAdaptive+chan) || !*(electrode->isActive+chan))
+            continue;
 
-    
+        NoiseEstimator* estimator = electrode->noiseEstimators[chan];
+        estimator->addSamples(dataBuffer->getReadPointer(*(electrode->channels+chan)), nSamples);
 
+        if (!estimator->isReady())
+            continue;
 
+        // a flat or clipped channel has no spread to go by, so it keeps its last
+        // threshold, which starts out as the manual one
+        const float mad = estimator->getMedianAbsoluteDeviation();
 
+        // the threshold travels with every spike, so the spike display follows it
+        if (mad > 0)
+            *(electrode->thresholds+chan) = jmax(double(estimator->getBinWidth()),
+                                                 *(electrode->adaptiveMultipliers+chan) * mad);
+    }
 }
 
-float SpikeDetector::getNextSample(int& chan)
+float SpikeDetector::getSample(int chan, int index) const
 {
-
-
-
-    //if (useOverflowBuffer)
-    //{
-    if (sampleIndex < 0)
+    if (index < 0)
     {
-        // std::cout << "  sample index " << sampleIndex << "from overflowBuffer" << std::endl;
-        int ind = overflowBufferSize + sampleIndex;
+        int ind = overflowBufferSize + index;
 
-        if (ind < overflowBuffer.getNumSamples())
-            return *overflowBuffer.getWritePointer(chan, ind);
+        if (ind >= 0 && ind < overflowBuffer.getNumSamples())
+            return *overflowBuffer.getReadPointer(chan, ind);
         else
             return 0;
-
     }
     else
     {
-        //  useOverflowBuffer = false;
-        // std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
-
-        if (sampleIndex < dataBuffer->getNumSamples())
-            return *dataBuffer->getWritePointer(chan, sampleIndex);
+        if (index < dataBuffer->getNumSamples())
+            return *dataBuffer->getReadPointer(chan, index);
         else
             return 0;
     }
-    //} else {
-    //    std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
-    //     return *dataBuffer.getWritePointer(chan, sampleIndex);
-    //}
-
 }
 
-float SpikeDetector::getCurrentSample(int& chan)
+/** Returns the index of the first of numSamples samples that is below
+    threshold, or numSamples if there is none. */
+static int findFirstSampleBelow(const float* samples, int numSamples, float threshold)
 {
+    int i = 0;
 
-    // if (useOverflowBuffer)
-    // {
-    //     return *overflowBuffer.getWritePointer(chan, overflowBufferSize + sampleIndex - 1);
-    // } else {
-    //     return *dataBuffer.getWritePointer(chan, sampleIndex - 1);
-    // }
+#if SPIKEDETECTOR_SSE
+    // most blocks have no crossing at all, so test 16 samples at a time
+    const __m128 t = _mm_set1_ps(threshold);
 
-    if (sampleIndex < 1)
+    for (; i + 16 <= numSamples; i += 16)
     {
-        //std::cout << "  sample index " << sampleIndex << "from overflowBuffer" << std::endl;
-        return *overflowBuffer.getWritePointer(chan, overflowBufferSize + sampleIndex - 1);
+        const __m128 a = _mm_cmplt_ps(_mm_loadu_ps(samples + i), t);
+        const __m128 b = _mm_cmplt_ps(_mm_loadu_ps(samples + i + 4), t);
+        const __m128 c = _mm_cmplt_ps(_mm_loadu_ps(samples + i + 8), t);
+        const __m128 d = _mm_cmplt_ps(_mm_loadu_ps(samples + i + 12), t);
+
+        if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(a, b), _mm_or_ps(c, d))) != 0)
+            break;
     }
-    else
+#endif
+
+    for (; i < numSamples; i++)
     {
-        //  useOverflowBuffer = false;
-        // std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
-        return *dataBuffer->getWritePointer(chan, sampleIndex - 1);
+        if (samples[i] < threshold)
+            return i;
     }
-    //} else {
 
+    return numSamples;
 }
 
-
-bool SpikeDetector::samplesAvailable(int nSamples)
+int SpikeDetector::findThresholdCrossing(int chan, int first, int last, double threshold) const
 {
+    // -x > threshold is tested in double precision; the smallest float that
+    // is not below -threshold gives the same result with a float comparison
+    const double limit = -threshold;
+    float floatLimit = float(limit);
+
+    if (double(floatLimit) < limit)
+        floatLimit = nextafterf(floatLimit, std::numeric_limits<float>::max());
+
+    int index = first;
 
-    if (sampleIndex > nSamples - overflowBufferSize/2)
+    // samples that are not in either buffer
+    for (; index < -overflowBufferSize && index <= last; index++)
     {
-        return false;
+        if (getSample(chan, index) < floatLimit)
+            return index;
     }
-    else
+
+    // the end of the previous buffer
+    if (index < 0 && index <= last)
+    {
+        const int end = jmin(0, last + 1);
+        const float* samples = overflowBuffer.getReadPointer(chan, overflowBufferSize + index);
+        const int n = findFirstSampleBelow(samples, end - index, floatLimit);
+
+        if (n < end - index)
+            return index + n;
+
+        index = end;
+    }
+
+    // the current buffer
+    if (index <= last)
+    {
+        const int end = jmin(last + 1, dataBuffer->getNumSamples());
+
+        if (index < end)
+        {
+            const int n = findFirstSampleBelow(dataBuffer->getReadPointer(chan, index), end - index, floatLimit);
+
+            if (n < end - index)
+                return index + n;
+
+            index = end;
+        }
+
+        // past the end of the buffer, samples read as zero
+        if (index <= last && 0.0f < floatLimit)
+            return index;
+    }
+
+    return last + 1;
+}
+
+int SpikeDetector::findPeak(int chan, int crossingIndex, int postPeakSamples) const
+{
+    int index = crossingIndex;
+
+    while (-getSample(chan, index - 1) < -getSample(chan, index) &&
+           index < crossingIndex + postPeakSamples)
     {
-        return true;
+        index++;
     }
 
+    return index;
 }
 
 
@@ -689,8 +903,10 @@ void SpikeDetector::saveCustomParametersToXml(XmlElement* parentElement)
         {
             XmlElement* channelNode = electrodeNode->createNewChildElement("SUBCHANNEL");
             channelNode->setAttribute("ch",*(electrodes[i]->channels+j));
-            channelNode->setAttribute("thresh",*(electrodes[i]->thresholds+j));
+            channelNode->setAttribute("thresh",*(electrodes[i]->manualThresholds+j));
             channelNode->setAttribute("isActive",*(electrodes[i]->isActive+j));
+            channelNode->setAttribute("isAdaptive",*(electrodes[i]->isAdaptive+j));
+            channelNode->setAttribute("adaptiveMultiplier",*(electrodes[i]->adaptiveMultipliers+j));
 
         }
     }
@@ -740,6 +956,9 @@ void SpikeDetector::loadCustomParametersFromXml()
                         setChannel(electrodeIndex, channelIndex, channelNode->getIntAttribute("ch"));
                         setChannelThreshold(electrodeIndex, channelIndex, channelNode->getDoubleAttribute("thresh"));
                         setChannelActive(electrodeIndex, channelIndex, channelNode->getBoolAttribute("isActive"));
+                        setChannelAdaptive(electrodeIndex, channelIndex, channelNode->getBoolAttribute("isAdaptive", false));
+                        setAdaptiveMultiplier(electrodeIndex, channelIndex,
+                                              channelNode->getDoubleAttribute("adaptiveMultiplier", getDefaultAdaptiveMultiplier()));
                     }
                 }
 
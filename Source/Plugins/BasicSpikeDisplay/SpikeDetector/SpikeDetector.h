@@ -29,6 +29,63 @@
 
 #include <SpikeLib.h>
 
+/**
+
+  Estimates the median absolute deviation (MAD) of a channel's noise over a
+  sliding window of a few seconds.
+
+  Samples are counted in a histogram for each segment of the window, and
+  the histogram of the whole window is updated with every new sample and
+  when the oldest segment expires, so adding a sample costs O(1). The MAD
+  is read from the window histogram to within a fraction of a bin. The
+  histogram spans a fixed fraction of the channel's range, so the bins
+  follow the channel's units and resolution.
+
+  @see SpikeDetector
+
+*/
+
+class NoiseEstimator
+{
+public:
+    NoiseEstimator();
+
+    /** Clears the window, made of segments of segmentSamples samples each,
+        and spreads the histogram bins over -range/2 to range/2. */
+    void reset(int segmentSamples, float range);
+
+    /** Adds a block of samples to the window. */
+    void addSamples(const float* samples, int numSamples);
+
+    /** Returns true once the window holds at least one segment's worth of samples. */
+    bool isReady() const;
+
+    /** Returns the median absolute deviation of the samples in the window,
+        or 0 if half of them fall in a single bin. */
+    float getMedianAbsoluteDeviation() const;
+
+    /** Returns the width of a histogram bin, the resolution of the MAD. */
+    float getBinWidth() const { return binWidth; }
+
+private:
+    enum
+    {
+        numBins = 1024,
+        numSegments = 5
+    };
+
+    HeapBlock<uint16> segmentCounts;    // one histogram per segment
+    HeapBlock<uint32> windowCounts;     // sum of the segment histograms
+    int segmentSizes[numSegments];
+
+    float binWidth;
+    int segmentSamples;
+    int currentSegment;
+    uint32 windowSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoiseEstimator);
+};
+
 struct SimpleElectrode
 {
 
@@ -45,6 +102,13 @@ struct SimpleElectrode
     HeapBlock<double> thresholds;
     HeapBlock<bool> isActive;
 
+    /** Channels whose threshold follows a multiple of their noise MAD; the
+        threshold set by the user is kept for when they stop following it */
+    HeapBlock<bool> isAdaptive;
+    HeapBlock<double> manualThresholds;
+    HeapBlock<double> adaptiveMultipliers;
+    OwnedArray<NoiseEstimator> noiseEstimators;
+
 };
 
 class SpikeDetectorEditor;
@@ -151,6 +215,16 @@ public:
 
     double getChannelThreshold(int electrodeNum, int channelNum);
 
+    /** Makes a channel's threshold follow a multiple of its noise MAD. */
+    void setChannelAdaptive(int electrodeNum, int channelNum, bool adaptive);
+
+    bool isChannelAdaptive(int electrodeNum, int channelNum);
+
+    /** Sets the multiple of the MAD used as an adaptive threshold. */
+    void setAdaptiveMultiplier(int electrodeNum, int channelNum, float multiplier);
+
+    double getAdaptiveMultiplier(int electrodeNum, int channelNum);
+
     void saveCustomParametersToXml(XmlElement* parentElement);
     void loadCustomParametersFromXml();
 
@@ -160,15 +234,26 @@ private:
 
     float getDefaultThreshold();
 
-    int overflowBufferSize;
+    float getDefaultAdaptiveMultiplier();
 
-    int sampleIndex;
+    /** Updates the adaptive thresholds of an electrode with a new block of samples. */
+    void updateAdaptiveThresholds(SimpleElectrode* electrode, int nSamples);
+
+    int overflowBufferSize;
 
     Array<int> electrodeCounter;
 
-    float getNextSample(int& chan);
-    float getCurrentSample(int& chan);
-    bool samplesAvailable(int nSamples);
+    /** Returns a sample of the current buffer; negative indexes are read from
+        the end of the previous buffer, kept in the overflow buffer. */
+    float getSample(int chan, int index) const;
+
+    /** Returns the first index from first to last (inclusive) where a channel
+        crosses below -threshold, or last + 1 if it never does. */
+    int findThresholdCrossing(int chan, int first, int last, double threshold) const;
+
+    /** Follows the signal down from a threshold crossing, for at most
+        postPeakSamples, and returns the index after its minimum. */
+    int findPeak(int chan, int crossingIndex, int postPeakSamples) const;
 
     Array<bool> useOverflowBuffer;
 
@@ -176,8 +261,8 @@ private:
     int currentChannelIndex;
     int currentIndex;
 
-   // uint8_t* spikeBuffer;///[256];
-	HeapBlock<uint8_t> spikeBuffer;
+    /** Spikes detected in the current block, read in place downstream */
+    SpikeEventBuffer spikeEvents;
     int64 timestamp;
 
     OwnedArray<SimpleElectrode> electrodes;
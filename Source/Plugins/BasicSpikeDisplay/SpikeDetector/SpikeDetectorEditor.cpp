@@ -104,6 +104,25 @@ SpikeDetectorEditor::SpikeDetectorEditor(GenericProcessor* parentNode, bool useD
     e3->setBounds(130,110,70,10);
     electrodeEditorButtons.add(e3);
 
+    ElectrodeEditorButton* e4 = new ElectrodeEditorButton("ADAPT",font);
+    e4->setClickingTogglesState(true);
+    e4->addListener(this);
+    addAndMakeVisible(e4);
+    e4->setBounds(255,110,40,10);
+    electrodeEditorButtons.add(e4);
+
+    // multiple of the noise MAD that ADAPT sets the thresholds to
+    lastMultiplierString = String(6.0f, 1);
+    multiplierValue = new Label("Multiplier", lastMultiplierString);
+    multiplierValue->setFont(Font("Small Text", 10, Font::plain));
+    multiplierValue->setBounds(276,92,24,15);
+    multiplierValue->setEditable(true);
+    multiplierValue->addListener(this);
+    multiplierValue->setColour(Label::textColourId, Colours::white);
+    multiplierValue->setColour(Label::backgroundColourId, Colours::grey);
+    multiplierValue->setTooltip("Adaptive threshold, in multiples of the noise MAD");
+    addAndMakeVisible(multiplierValue);
+
     thresholdSlider = new ThresholdSlider(font);
     thresholdSlider->setBounds(200,35,75,75);
     addAndMakeVisible(thresholdSlider);
@@ -115,7 +134,7 @@ SpikeDetectorEditor::SpikeDetectorEditor(GenericProcessor* parentNode, bool useD
     thresholdLabel = new Label("Name","Threshold");
     font.setHeight(10);
     thresholdLabel->setFont(font);
-    thresholdLabel->setBounds(202, 105, 95, 15);
+    thresholdLabel->setBounds(202, 105, 50, 15);
     thresholdLabel->setColour(Label::textColourId, Colours::grey);
     addAndMakeVisible(thresholdLabel);
 
@@ -190,9 +209,19 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
             SpikeDetector* processor = (SpikeDetector*) getProcessor();
 
+            const int electrodeIndex = electrodeList->getSelectedItemIndex();
+            const int channelIndex = electrodeButtons.indexOf((ElectrodeButton*) button);
+
+            // only shows the threshold, which may be an adaptive one
             thresholdSlider->setActive(true);
-            thresholdSlider->setValue(processor->getChannelThreshold(electrodeList->getSelectedItemIndex(),
-                                                                     electrodeButtons.indexOf((ElectrodeButton*) button)));
+            thresholdSlider->setValue(processor->getChannelThreshold(electrodeIndex, channelIndex),
+                                      dontSendNotification);
+
+            electrodeEditorButtons[3]->setToggleState(processor->isChannelAdaptive(electrodeIndex, channelIndex),
+                                                      dontSendNotification);
+
+            lastMultiplierString = String(processor->getAdaptiveMultiplier(electrodeIndex, channelIndex), 1);
+            multiplierValue->setText(lastMultiplierString, dontSendNotification);
         }
         else
         {
@@ -363,6 +392,29 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
         return;
     }
+    else if (button == electrodeEditorButtons[3])   // ADAPT
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+        int electrodeNum = electrodeList->getSelectedItemIndex();
+
+        if (electrodeNum < 0)
+        {
+            button->setToggleState(false, dontSendNotification);
+            return;
+        }
+
+        // while editing, only the selected channel follows the noise level
+        for (int i = 0; i < electrodeButtons.size(); i++)
+        {
+            if (!electrodeEditorButtons[0]->getToggleState() || electrodeButtons[i]->getToggleState())
+                processor->setChannelAdaptive(electrodeNum, i, button->getToggleState());
+        }
+
+        // turning it off brings back the manual thresholds
+        updateThresholdDisplay(electrodeNum);
+
+        return;
+    }
     else if (button == electrodeEditorButtons[2])   // DELETE
     {
         if (acquisitionIsActive)
@@ -471,6 +523,33 @@ void SpikeDetectorEditor::removeElectrode(int index)
 
 void SpikeDetectorEditor::labelTextChanged(Label* label)
 {
+    if (label == multiplierValue)
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+        int electrodeNum = electrodeList->getSelectedItemIndex();
+
+        Value val = label->getTextValue();
+        double requestedValue = double(val.getValue());
+
+        if (requestedValue < 1 || requestedValue > 50)
+        {
+            CoreServices::sendStatusMessage("Value out of range.");
+            label->setText(lastMultiplierString, dontSendNotification);
+            return;
+        }
+
+        lastMultiplierString = label->getText();
+
+        // while editing, only the selected channel is changed, as with ADAPT
+        for (int i = 0; i < electrodeButtons.size() && electrodeNum > -1; i++)
+        {
+            if (!electrodeEditorButtons[0]->getToggleState() || electrodeButtons[i]->getToggleState())
+                processor->setAdaptiveMultiplier(electrodeNum, i, requestedValue);
+        }
+
+        return;
+    }
+
     if (label->getText().equalsIgnoreCase("1") && isPlural)
     {
         for (int n = 1; n < electrodeTypes->getNumItems()+1; n++)
@@ -566,15 +645,12 @@ void SpikeDetectorEditor::drawElectrodeButtons(int ID)
     int column = 0;
 
     Array<int> activeChannels;
-    Array<double> thresholds;
 
     for (int i = 0; i < numChannels; i++)
     {
         ElectrodeButton* button = new ElectrodeButton(processor->getChannel(ID,i)+1);
         electrodeButtons.add(button);
 
-        thresholds.add(processor->getChannelThreshold(ID,i));
-
         if (electrodeEditorButtons[0]->getToggleState())
         {
             button->setToggleState(false, dontSendNotification);
@@ -604,5 +680,30 @@ void SpikeDetectorEditor::drawElectrodeButtons(int ID)
     }
 
     channelSelector->setActiveChannels(activeChannels);
+    updateThresholdDisplay(ID);
+}
+
+void SpikeDetectorEditor::updateThresholdDisplay(int ID)
+{
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+    int numChannels = processor->getNumChannels(ID);
+
+    Array<double> thresholds;
+    bool isAdaptive = numChannels > 0;
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        thresholds.add(processor->getChannelThreshold(ID,i));
+        isAdaptive = isAdaptive && processor->isChannelAdaptive(ID,i);
+    }
+
     thresholdSlider->setValues(thresholds);
+    electrodeEditorButtons[3]->setToggleState(isAdaptive, dontSendNotification);
+
+    if (numChannels > 0)
+    {
+        lastMultiplierString = String(processor->getAdaptiveMultiplier(ID,0), 1);
+        multiplierValue->setText(lastMultiplierString, dontSendNotification);
+    }
 }
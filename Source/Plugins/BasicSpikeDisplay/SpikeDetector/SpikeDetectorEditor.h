@@ -70,10 +70,15 @@ private:
 
     void drawElectrodeButtons(int);
 
+    /** Shows the thresholds and the adaptive state of the electrode's channels. */
+    void updateThresholdDisplay(int ID);
+
     ComboBox* electrodeTypes;
     ComboBox* electrodeList;
     Label* numElectrodes;
     Label* thresholdLabel;
+    Label* multiplierValue;
+    String lastMultiplierString;
     TriangleButton* upButton;
     TriangleButton* downButton;
     UtilityButton* plusButton;
@@ -26,11 +26,14 @@
 #include "CAR.h"
 #include "CAREditor.h"
 
-
 CAR::CAR()
     : GenericProcessor ("Common Avg Ref") //, threshold(200.0), state(true)
+    , m_groupsNeedUpdate    (true)
+    , m_groupsNumChannels   (0)
+    , m_groupsNumSamples    (0)
+    , m_groupSize           (0)
+    , m_useWorkerThreads    (true)
 {
-    m_avgBuffer = AudioSampleBuffer (1, 10000); // 1-dimensional buffer to hold the avg
 }
 
 
@@ -59,8 +62,27 @@ void CAR::setGainLevel (float newGain)
 }
 
 
+bool CAR::enable()
+{
+    if (m_useWorkerThreads)
+        m_reference.startWorkerThreads (SystemStats::getNumCpus() - 1);
+
+    return GenericProcessor::enable();
+}
+
+
+bool CAR::disable()
+{
+    m_reference.stopWorkerThreads();
+
+    return GenericProcessor::disable();
+}
+
+
 void CAR::process (AudioSampleBuffer& buffer, MidiBuffer& events)
 {
+    const ScopedLock myScopedLock (objectLock);
+
     const int numSamples            = buffer.getNumSamples();
     const int numReferenceChannels  = m_referenceChannels.size();
     const int numAffectedChannels   = m_affectedChannels.size();
@@ -72,34 +94,48 @@ void CAR::process (AudioSampleBuffer& buffer, MidiBuffer& events)
         return;
     }
 
-    m_avgBuffer.clear();
-
-    for (int i = 0; i < numReferenceChannels; ++i)
+    if (m_groupsNeedUpdate
+        || m_groupsNumChannels != buffer.getNumChannels()
+        || m_groupsNumSamples < numSamples)
     {
-        m_avgBuffer.addFrom (0,                         // destChannel
-                             0,                         // destStartSample
-                             buffer,                    // source
-                             m_referenceChannels[i],    // sourceChannel
-                             0,                         // sourceStartSample
-                             numSamples,                // numSamples
-                             1.0f);                     // gain to apply
-    }
+        m_reference.setChannels (m_referenceChannels, m_affectedChannels,
+                                 m_groupSize, buffer.getNumChannels(), numSamples);
 
-    m_avgBuffer.applyGain (1.0f / float (numReferenceChannels));
+        m_groupsNeedUpdate  = false;
+        m_groupsNumChannels = buffer.getNumChannels();
+        m_groupsNumSamples  = numSamples;
+    }
 
     m_gainLevel.updateTarget();
     const float gain = -1.0f * m_gainLevel.getNextValue() / 100.f;
 
-    for (int i = 0; i < numAffectedChannels; ++i)
-    {
-        buffer.addFrom (m_affectedChannels[i],  // destChannel
-                        0,                      // destStartSample
-                        m_avgBuffer,            // source
-                        0,                      // sourceChannel
-                        0,                      // sourceStartSample
-                        numSamples,             // numSamples
-                        gain);                  // gain to apply
-    }
+    m_reference.process (buffer.getArrayOfWritePointers(), numSamples, gain);
+}
+
+
+void CAR::setReferenceMode (ReferenceMode newMode)
+{
+    const ScopedLock myScopedLock (objectLock);
+
+    m_reference.setMode (newMode);
+}
+
+
+void CAR::setGroupSize (int newGroupSize)
+{
+    const ScopedLock myScopedLock (objectLock);
+
+    m_groupSize = jmax (0, newGroupSize);
+    m_groupsNeedUpdate = true;
+}
+
+
+void CAR::setUseWorkerThreads (bool shouldUseWorkerThreads)
+{
+    const ScopedLock myScopedLock (objectLock);
+
+    m_useWorkerThreads = shouldUseWorkerThreads;
+    m_reference.setUseWorkerThreads (shouldUseWorkerThreads);
 }
 
 
@@ -108,6 +144,7 @@ void CAR::setReferenceChannels (const Array<int>& newReferenceChannels)
     const ScopedLock myScopedLock (objectLock);
 
     m_referenceChannels = Array<int> (newReferenceChannels);
+    m_groupsNeedUpdate = true;
 }
 
 
@@ -116,23 +153,31 @@ void CAR::setAffectedChannels (const Array<int>& newAffectedChannels)
     const ScopedLock myScopedLock (objectLock);
 
     m_affectedChannels = Array<int> (newAffectedChannels);
+    m_groupsNeedUpdate = true;
 }
 
 
 void CAR::setReferenceChannelState (int channel, bool newState)
 {
+    const ScopedLock myScopedLock (objectLock);
+
     if (! newState)
         m_referenceChannels.removeFirstMatchingValue (channel);
     else
         m_referenceChannels.addIfNotAlreadyThere (channel);
+
+    m_groupsNeedUpdate = true;
 }
 
 
 void CAR::setAffectedChannelState (int channel, bool newState)
 {
+    const ScopedLock myScopedLock (objectLock);
+
     if (! newState)
         m_affectedChannels.removeFirstMatchingValue (channel);
     else
         m_affectedChannels.add (channel);
-}
 
+    m_groupsNeedUpdate = true;
+}
@@ -30,12 +30,21 @@
 #endif
 
 #include <ProcessorHeaders.h>
+#include "CARReference.h"
 
 /**
 
     This is a simple filter that subtracts the average of all other channels from 
     each channel. The gain parameter allows you to subtract a percentage of the total avg.
 
+    Besides the mean, the reference can be the per-sample median or interquartile mean
+    of the reference channels, which are not pulled by a few channels with large spikes
+    or artifacts. With a group size set, channels are split into groups of consecutive
+    channels (e.g. one per shank), and each affected channel is referenced only against
+    the reference channels of its own group. Groups are evaluated on worker threads
+    when there are enough of them to share. The reference itself is computed by a
+    CARReference.
+
     See Ludwig et al. 2009 Using a common average reference to improve cortical
     neuron recordings from microelectrode arrays. J. Neurophys, 2009 for a detailed
     discussion
@@ -46,6 +55,8 @@
 class CAR : public GenericProcessor
 {
 public:
+    typedef CARReference::Mode ReferenceMode;
+
     /** The class constructor, used to initialize any members. */
     CAR();
 
@@ -78,9 +89,25 @@ public:
     /** Sets the new gain level that will be used in the processor */
     void setGainLevel (float newGain);
 
+    /** Starts the worker threads. */
+    bool enable() override;
+
+    /** Stops the worker threads. */
+    bool disable() override;
+
     /** Creates the CAREditor. */
     AudioProcessorEditor* createEditor() override;
 
+    ReferenceMode getReferenceMode() const      { return m_reference.getMode(); }
+    void setReferenceMode (ReferenceMode newMode);
+
+    /** Number of consecutive channels in each group, or 0 for a single group. */
+    int getGroupSize() const                    { return m_groupSize; }
+    void setGroupSize (int newGroupSize);
+
+    /** Lets the groups be evaluated in parallel on a pool of worker threads. */
+    void setUseWorkerThreads (bool shouldUseWorkerThreads);
+
     Array<int> getReferenceChannels() const     { return m_referenceChannels; }
     Array<int> getAffectedChannels()  const     { return m_affectedChannels; }
 
@@ -94,7 +121,13 @@ public:
 private:
     LinearSmoothedValueAtomic<float> m_gainLevel;
 
-    AudioSampleBuffer m_avgBuffer;
+    CARReference m_reference;
+    bool m_groupsNeedUpdate;
+    int m_groupsNumChannels;
+    int m_groupsNumSamples;
+
+    int m_groupSize;
+    bool m_useWorkerThreads;
 
     /** We should add this for safety to prevent any app crashes or invalid data processing.
         Since we use m_referenceChannels and m_affectedChannels arrays in the process() function,
@@ -36,6 +36,8 @@ CAREditor::CAREditor (GenericProcessor* parentProcessor, bool useDefaultParamete
     , m_currentChannelsView          (REFERENCE_CHANNELS)
     , m_channelSelectorButtonManager (new LinearButtonGroupManager)
     , m_gainSlider                   (new ParameterSlider (0.0, 100.0, 100.0, Font("Default", 13.f, Font::plain)))
+    , m_referenceModeSelector        (new ComboBox ("Reference mode"))
+    , m_groupSizeSelector            (new ComboBox ("Group size"))
 {
     TextButton* referenceChannelsButton = new TextButton ("Reference", "Switch to reference channels");
     referenceChannelsButton->setClickingTogglesState (true);
@@ -67,6 +69,23 @@ CAREditor::CAREditor (GenericProcessor* parentProcessor, bool useDefaultParamete
     m_gainSlider->addListener (this);
     addAndMakeVisible (m_gainSlider);
 
+    m_referenceModeSelector->addItem ("Mean",          CARReference::MEAN_REFERENCE + 1);
+    m_referenceModeSelector->addItem ("Median",        CARReference::MEDIAN_REFERENCE + 1);
+    m_referenceModeSelector->addItem ("Trimmed mean",  CARReference::TRIMMED_MEAN_REFERENCE + 1);
+    m_referenceModeSelector->setSelectedId (CARReference::MEAN_REFERENCE + 1, dontSendNotification);
+    m_referenceModeSelector->setTooltip ("Statistic of the reference channels that is subtracted");
+    m_referenceModeSelector->addListener (this);
+    addAndMakeVisible (m_referenceModeSelector);
+
+    const int groupSizes[] = { 16, 32, 64, 96, 128 };
+    m_groupSizeSelector->addItem ("All", 1);
+    for (int i = 0; i < numElementsInArray (groupSizes); ++i)
+        m_groupSizeSelector->addItem (String (groupSizes[i]) + " ch", groupSizes[i] + 1);
+    m_groupSizeSelector->setSelectedId (1, dontSendNotification);
+    m_groupSizeSelector->setTooltip ("Reference each group of consecutive channels separately");
+    m_groupSizeSelector->addListener (this);
+    addAndMakeVisible (m_groupSizeSelector);
+
     channelSelector->paramButtonsToggledByDefault (false);
 
     setDesiredWidth (280);
@@ -96,6 +115,9 @@ void CAREditor::resized()
 {
     m_channelSelectorButtonManager->setBounds (110, 50, 150, 36);
 
+    m_referenceModeSelector->setBounds (110, 92, 85, 20);
+    m_groupSizeSelector->setBounds     (200, 92, 60, 20);
+
     m_gainSlider->setBounds (15, 30, 80, 80);
 
     GenericEditor::resized();
@@ -145,3 +167,44 @@ void CAREditor::sliderEvent (Slider* sliderWhichValueHasChanged)
 
     processor->setGainLevel ( (float)sliderWhichValueHasChanged->getValue());
 }
+
+
+void CAREditor::comboBoxChanged (ComboBox* comboBoxThatHasChanged)
+{
+    auto processor = static_cast<CAR*> (getProcessor());
+
+    if (comboBoxThatHasChanged->getSelectedId() == 0)
+        return;
+
+    if (comboBoxThatHasChanged == m_referenceModeSelector)
+    {
+        processor->setReferenceMode (static_cast<CAR::ReferenceMode> (m_referenceModeSelector->getSelectedId() - 1));
+    }
+    else if (comboBoxThatHasChanged == m_groupSizeSelector)
+    {
+        processor->setGroupSize (m_groupSizeSelector->getSelectedId() - 1);
+    }
+}
+
+
+void CAREditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "CAREditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("ReferenceMode",  m_referenceModeSelector->getSelectedId() - 1);
+    values->setAttribute ("GroupSize",      m_groupSizeSelector->getSelectedId() - 1);
+}
+
+
+void CAREditor::loadCustomParameters (XmlElement* xml)
+{
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            m_referenceModeSelector->setSelectedId (xmlNode->getIntAttribute ("ReferenceMode", CARReference::MEAN_REFERENCE) + 1, sendNotificationSync);
+            m_groupSizeSelector->setSelectedId (xmlNode->getIntAttribute ("GroupSize", 0) + 1, sendNotificationSync);
+        }
+    }
+}
@@ -35,6 +35,7 @@ class ParameterSlider;
    @see CAR
 */
 class CAREditor : public GenericEditor
+                , public ComboBox::Listener
 {
 public:
     CAREditor (GenericProcessor* parentProcessor, bool useDefaultParameterEditors);
@@ -48,12 +49,19 @@ public:
     // ==========================================================
     void buttonClicked (Button* buttonThatWasClicked) override;
 
+    // ComboBox::Listener methods
+    // ==========================================================
+    void comboBoxChanged (ComboBox* comboBoxThatHasChanged) override;
+
     // GenericEditor methods
     // =========================================================
     /** This methods is called when any sliders that we are listen for change their values */
     void sliderEvent (Slider* sliderWhichValueHasChanged) override;
     void channelChanged (int channel, bool newState) override;
 
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
 
 private:
     enum ChannelsType
@@ -67,6 +75,12 @@ private:
     ScopedPointer<LinearButtonGroupManager> m_channelSelectorButtonManager;
     ScopedPointer<ParameterSlider>          m_gainSlider;
 
+    /** Mean, median or trimmed mean reference */
+    ScopedPointer<ComboBox> m_referenceModeSelector;
+
+    /** Channels per reference group; the item ID is the group size plus one */
+    ScopedPointer<ComboBox> m_groupSizeSelector;
+
     // LookAndFeel
     SharedResourcePointer<MaterialButtonLookAndFeel> m_materialButtonLookAndFeel;
 
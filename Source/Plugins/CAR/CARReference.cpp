@@ -0,0 +1,260 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+
+#include "CARReference.h"
+
+/** Number of samples transposed at a time for the median and trimmed mean */
+#define CAR_TILE_SAMPLES 32
+
+/** Fraction of the reference values dropped at each end for the trimmed mean */
+#define CAR_TRIM_FRACTION 0.25f
+
+
+/**
+    Evaluates every numJobs-th group of a block on a worker thread.
+*/
+class CARReferenceJob : public ThreadPoolJob
+{
+public:
+    CARReferenceJob (CARReference& reference, int index)
+        : ThreadPoolJob ("CAR group job " + String (index))
+        , m_reference   (reference)
+        , m_channels    (nullptr)
+        , m_first       (0)
+        , m_step        (1)
+        , m_numSamples  (0)
+        , m_gain        (0)
+    {
+    }
+
+    void prepare (float* const* channels, int first, int step, int numSamples, float gain)
+    {
+        m_channels   = channels;
+        m_first      = first;
+        m_step       = step;
+        m_numSamples = numSamples;
+        m_gain       = gain;
+    }
+
+    JobStatus runJob() override
+    {
+        for (int i = m_first; i < m_reference.m_groups.size(); i += m_step)
+            m_reference.processGroup (*m_reference.m_groups.getUnchecked (i), m_channels, m_numSamples, m_gain);
+
+        return jobHasFinished;
+    }
+
+private:
+    CARReference& m_reference;
+    float* const* m_channels;
+    int m_first;
+    int m_step;
+    int m_numSamples;
+    float m_gain;
+};
+
+
+CARReference::CARReference()
+    : m_mode                (MEAN_REFERENCE)
+    , m_useWorkerThreads    (true)
+{
+}
+
+
+CARReference::~CARReference()
+{
+    stopWorkerThreads();
+}
+
+
+void CARReference::startWorkerThreads (int numWorkers)
+{
+    if (numWorkers <= 0 || m_threadPool != nullptr)
+        return;
+
+    m_threadPool = new ThreadPool (numWorkers);
+
+    for (int i = 0; i < numWorkers; ++i)
+        m_groupJobs.add (new CARReferenceJob (*this, i));
+}
+
+
+void CARReference::stopWorkerThreads()
+{
+    m_threadPool = nullptr;
+    m_groupJobs.clear();
+}
+
+
+void CARReference::process (float* const* channels, int numSamples, float gain)
+{
+    const int numJobs = m_useWorkerThreads ? jmax (0, jmin (m_groupJobs.size(), m_groups.size() - 1)) : 0;
+
+    for (int i = 0; i < numJobs; ++i)
+    {
+        m_groupJobs[i]->prepare (channels, i + 1, numJobs + 1, numSamples, gain);
+        m_threadPool->addJob (m_groupJobs[i], false);
+    }
+
+    // this thread takes its share of the groups too
+    for (int i = 0; i < m_groups.size(); i += numJobs + 1)
+        processGroup (*m_groups[i], channels, numSamples, gain);
+
+    for (int i = 0; i < numJobs; ++i)
+        m_threadPool->waitForJobToFinish (m_groupJobs[i], -1);
+}
+
+
+void CARReference::processGroup (ReferenceGroup& group, float* const* channels, int numSamples, float gain)
+{
+    if (m_mode == MEAN_REFERENCE)
+        computeMeanReference (group, channels, numSamples);
+    else
+        computeRobustReference (group, channels, numSamples);
+
+    if (gain == 0.0f)
+        return;
+
+    for (int i = 0; i < group.affectedChannels.size(); ++i)
+    {
+        FloatVectorOperations::addWithMultiply (channels[group.affectedChannels.getUnchecked (i)],
+                                                group.reference, gain, numSamples);
+    }
+}
+
+
+void CARReference::computeMeanReference (ReferenceGroup& group, float* const* channels, int numSamples)
+{
+    const int numReferenceChannels = group.referenceChannels.size();
+
+    FloatVectorOperations::copy (group.reference, channels[group.referenceChannels.getUnchecked (0)], numSamples);
+
+    for (int i = 1; i < numReferenceChannels; ++i)
+        FloatVectorOperations::add (group.reference, channels[group.referenceChannels.getUnchecked (i)], numSamples);
+
+    FloatVectorOperations::multiply (group.reference, 1.0f / float (numReferenceChannels), numSamples);
+}
+
+
+void CARReference::computeRobustReference (ReferenceGroup& group, float* const* channels, int numSamples)
+{
+    const int numReferenceChannels = group.referenceChannels.size();
+
+    // values kept by the trimmed mean, and the median position
+    const int trim  = int (numReferenceChannels * CAR_TRIM_FRACTION);
+    const int first = trim;
+    const int last  = numReferenceChannels - trim;
+    const int half  = numReferenceChannels / 2;
+
+    for (int start = 0; start < numSamples; start += CAR_TILE_SAMPLES)
+    {
+        const int tileSamples = jmin (CAR_TILE_SAMPLES, numSamples - start);
+
+        // transpose a tile: a short run of every channel is read contiguously, and
+        // the tile stays in cache while the values of each sample are selected
+        for (int c = 0; c < numReferenceChannels; ++c)
+        {
+            const float* source = channels[group.referenceChannels.getUnchecked (c)] + start;
+            float* dest = group.tile + c;
+
+            for (int i = 0; i < tileSamples; ++i)
+                dest[i * numReferenceChannels] = source[i];
+        }
+
+        for (int i = 0; i < tileSamples; ++i)
+        {
+            float* values = group.tile + i * numReferenceChannels;
+            float* valuesEnd = values + numReferenceChannels;
+
+            if (m_mode == MEDIAN_REFERENCE)
+            {
+                std::nth_element (values, values + half, valuesEnd);
+                float median = values[half];
+
+                // with an even count, average the two middle values
+                if (numReferenceChannels % 2 == 0)
+                    median = 0.5f * (median + *std::max_element (values, values + half));
+
+                group.reference[start + i] = median;
+            }
+            else
+            {
+                if (first > 0)
+                {
+                    std::nth_element (values, values + first, valuesEnd);
+                    std::nth_element (values + first, values + last, valuesEnd);
+                }
+
+                float sum = 0.0f;
+                for (int k = first; k < last; ++k)
+                    sum += values[k];
+
+                group.reference[start + i] = sum / float (last - first);
+            }
+        }
+    }
+}
+
+
+void CARReference::setChannels (const Array<int>& referenceChannels,
+                                const Array<int>& affectedChannels,
+                                int groupSize, int numChannels, int maxSamples)
+{
+    m_groups.clear();
+
+    const int numGroups = (groupSize > 0) ? (numChannels + groupSize - 1) / groupSize : 1;
+
+    for (int g = 0; g < numGroups; ++g)
+        m_groups.add (new ReferenceGroup());
+
+    for (int i = 0; i < referenceChannels.size(); ++i)
+    {
+        const int channel = referenceChannels[i];
+        if (channel >= 0 && channel < numChannels)
+            m_groups[(groupSize > 0) ? channel / groupSize : 0]->referenceChannels.add (channel);
+    }
+
+    for (int i = 0; i < affectedChannels.size(); ++i)
+    {
+        const int channel = affectedChannels[i];
+        if (channel >= 0 && channel < numChannels)
+            m_groups[(groupSize > 0) ? channel / groupSize : 0]->affectedChannels.add (channel);
+    }
+
+    // only groups with both reference and affected channels have work to do
+    for (int g = m_groups.size(); --g >= 0;)
+    {
+        ReferenceGroup* group = m_groups[g];
+
+        if (group->referenceChannels.size() == 0 || group->affectedChannels.size() == 0)
+        {
+            m_groups.remove (g);
+            continue;
+        }
+
+        group->reference.malloc (maxSamples);
+        group->tile.malloc (CAR_TILE_SAMPLES * group->referenceChannels.size());
+    }
+}
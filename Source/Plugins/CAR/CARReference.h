@@ -0,0 +1,123 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CARREFERENCE_H_INCLUDED
+#define CARREFERENCE_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+class CARReferenceJob;
+
+/**
+
+    Computes the common reference of groups of channels and applies it to the
+    affected channels of each group.
+
+    This is the part of the CAR processor that works on the samples. It doesn't
+    depend on the processor or the signal chain, so it can also be timed on its own
+    (see the "car" benchmark of open-ephys-benchmarks).
+
+    The reference is the per-sample mean, median or interquartile mean of the
+    reference channels. Groups are evaluated on worker threads when there are
+    enough of them to share.
+
+    @see CAR
+
+*/
+
+class CARReference
+{
+public:
+    enum Mode
+    {
+        MEAN_REFERENCE = 0,
+        MEDIAN_REFERENCE,
+        TRIMMED_MEAN_REFERENCE
+    };
+
+    CARReference();
+    ~CARReference();
+
+    Mode getMode() const                        { return m_mode; }
+    void setMode (Mode newMode)                 { m_mode = newMode; }
+
+    /** Splits the reference and affected channels into groups of groupSize consecutive
+        channels, or a single group if groupSize is 0, for blocks of up to maxSamples. */
+    void setChannels (const Array<int>& referenceChannels,
+                      const Array<int>& affectedChannels,
+                      int groupSize, int numChannels, int maxSamples);
+
+    /** Returns the number of groups that have both reference and affected channels. */
+    int getNumGroups() const                    { return m_groups.size(); }
+
+    /** Starts a pool of worker threads, which share the groups with the thread calling process(). */
+    void startWorkerThreads (int numWorkers);
+
+    void stopWorkerThreads();
+
+    int getNumWorkerThreads() const             { return m_groupJobs.size(); }
+
+    /** Lets process() use the worker threads, if they have been started. */
+    void setUseWorkerThreads (bool shouldUseWorkerThreads)  { m_useWorkerThreads = shouldUseWorkerThreads; }
+
+    /** Adds gain times the reference of each group to its affected channels. */
+    void process (float* const* channels, int numSamples, float gain);
+
+
+private:
+    friend class CARReferenceJob;
+
+    /** Affected channels and the reference channels they are referenced against. */
+    struct ReferenceGroup
+    {
+        Array<int> referenceChannels;
+        Array<int> affectedChannels;
+
+        /** The reference signal of the current block */
+        HeapBlock<float> reference;
+
+        /** A tile of reference samples, transposed so that the values of all
+            reference channels at one sample are contiguous */
+        HeapBlock<float> tile;
+    };
+
+    /** Computes the reference of one group and applies it to its affected channels. */
+    void processGroup (ReferenceGroup& group, float* const* channels, int numSamples, float gain);
+
+    void computeMeanReference   (ReferenceGroup& group, float* const* channels, int numSamples);
+    void computeRobustReference (ReferenceGroup& group, float* const* channels, int numSamples);
+
+    OwnedArray<ReferenceGroup> m_groups;
+
+    Mode m_mode;
+
+    bool m_useWorkerThreads;
+    OwnedArray<CARReferenceJob> m_groupJobs;
+    ScopedPointer<ThreadPool> m_threadPool;
+
+    // ==================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CARReference);
+};
+
+
+#endif  // CARREFERENCE_H_INCLUDED
@@ -25,10 +25,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ChannelMappingNode.h"
 #include "ChannelMappingEditor.h"
 
+#define REFERENCE_CHUNK_SIZE 256
 
 
 ChannelMappingNode::ChannelMappingNode()
-    : GenericProcessor("Channel Map"), channelBuffer(1,10000)
+    : GenericProcessor("Channel Map"), remapPlanIsDirty(true), remapPlanNumChannels(0),
+      channelBuffer(1,10000)
 {
     referenceArray.resize(1024); // make room for 1024 channels
     channelArray.resize(1024);
@@ -64,8 +66,7 @@ AudioProcessorEditor* ChannelMappingNode::createEditor()
 
 void ChannelMappingNode::updateSettings()
 {
-    if (getNumInputs() > 0)
-        channelBuffer.setSize(getNumInputs(), 10000);
+    remapPlanIsDirty = true;
 
 	if (editorIsConfigured)
 	{
@@ -120,51 +121,187 @@ void ChannelMappingNode::setParameter(int parameterIndex, float newValue)
         channelArray.set(currentChannel, (int) newValue);
     }
 
+    remapPlanIsDirty = true;
 }
 
-void ChannelMappingNode::process(AudioSampleBuffer& buffer,
-                                 MidiBuffer& midiMessages)
+void ChannelMappingNode::updateRemapPlan(int numInputChannels, int numSamples)
 {
-    int j=0;
-    int i=0;
-    int realChan;
+    const int numOutputs = jmin(settings.numOutputs, numInputChannels);
 
-    // use copy constructor to set the data to refer to
-    channelBuffer = buffer;
+    Array<int> sourceOf;
+    Array<int> referenceOf;
 
-   // buffer.clear();
-
-    while (j < settings.numOutputs)
+    int i = 0;
+    while (sourceOf.size() < numOutputs && i < channelArray.size())
     {
-        realChan = channelArray[i];
-        if ((realChan < channelBuffer.getNumChannels()) && (enabledChannelArray[realChan]))
+        int realChan = channelArray[i];
+        if ((realChan < numInputChannels) && (enabledChannelArray[realChan]))
         {
-            // copy it back into the buffer according to the channel mapping
-            buffer.copyFrom(j, // destChannel
-                           0, // destStartSample
-                           channelBuffer.getReadPointer(realChan), // source
-                           getNumSamples(j), // numSamples
-                           1.0f // gain to apply to source (positive for original signal)
-                          );
-
-            // now do the referencing
+            int reference = -1;
             if ((referenceArray[realChan] > -1) && (referenceChannels[referenceArray[realChan]] > -1)
-                && (referenceChannels[referenceArray[realChan]] < channelBuffer.getNumChannels()))
+                && (referenceChannels[referenceArray[realChan]] < numInputChannels)
+                && (referenceChannels[referenceArray[realChan]] < channels.size()))
             {
-                buffer.addFrom(j, // destChannel
-                               0, // destStartSample
-                               channelBuffer, // source
-							   channels[referenceChannels[referenceArray[realChan]]]->index-1, // sourceChannel
-                               0, // sourceStartSample
-                               getNumSamples(j), // numSamples
-                               -1.0f // gain to apply to source (negative for reference)
-                              );
+                reference = channels[referenceChannels[referenceArray[realChan]]]->index - 1;
+                if (reference >= numInputChannels)
+                    reference = -1;
             }
-            j++;
+            sourceOf.add(realChan);
+            referenceOf.add(reference);
         }
         i++;
+    }
+    while (sourceOf.size() < numOutputs)
+    {
+        sourceOf.add(-1);
+        referenceOf.add(-1);
+    }
+
+    // group the outputs by reference, so each reference is saved once
+    referenceGroups.clear();
+    for (int j = 0; j < numOutputs; j++)
+    {
+        if (referenceOf[j] < 0)
+            continue;
+
+        int g = 0;
+        while (g < referenceGroups.size() && referenceGroups[g]->sourceChannel != referenceOf[j])
+            g++;
+
+        if (g == referenceGroups.size())
+        {
+            ReferenceGroup* group = new ReferenceGroup();
+            group->sourceChannel = referenceOf[j];
+            referenceGroups.add(group);
+        }
+        referenceGroups[g]->outputChannels.add(j);
+    }
+
+    // order the moves so that no channel is overwritten before it has been read
+    channelMoves.clearQuick();
+
+    HeapBlock<int> readers(numInputChannels, true);
+    HeapBlock<bool> moved(numInputChannels, true);
+    Array<int> ready;
+
+    for (int j = 0; j < numOutputs; j++)
+    {
+        if (sourceOf[j] >= 0 && sourceOf[j] != j)
+            readers[sourceOf[j]]++;
+    }
+
+    for (int j = 0; j < numOutputs; j++)
+    {
+        if (sourceOf[j] >= 0 && sourceOf[j] != j && readers[j] == 0)
+            ready.add(j);
+    }
+
+    while (ready.size() > 0)
+    {
+        int j = ready.getLast();
+        ready.removeLast();
+
+        ChannelMove move = { j, sourceOf[j], j };
+        channelMoves.add(move);
+        moved[j] = true;
+
+        int source = sourceOf[j];
+        if (--readers[source] == 0 && source < numOutputs && sourceOf[source] >= 0
+            && sourceOf[source] != source && !moved[source])
+            ready.add(source);
+    }
+
+    // what is left are cycles, which go through the scratch channel
+    for (int j = 0; j < numOutputs; j++)
+    {
+        if (sourceOf[j] < 0 || sourceOf[j] == j || moved[j])
+            continue;
+
+        int last = j;
+        while (sourceOf[last] != j)
+            last = sourceOf[last];
+
+        ChannelMove save = { -1, j, last };
+        channelMoves.add(save);
 
+        int current = j;
+        while (current != last)
+        {
+            ChannelMove move = { current, sourceOf[current], current };
+            channelMoves.add(move);
+            moved[current] = true;
+            current = sourceOf[current];
+        }
+
+        ChannelMove restore = { last, -1, last };
+        channelMoves.add(restore);
+        moved[last] = true;
     }
 
+    channelBuffer.setSize(1 + referenceGroups.size(), jmax(numSamples, 10000));
+    outputNumSamples.malloc(jmax(1, numOutputs));
+
+    remapPlanNumChannels = numInputChannels;
+    remapPlanIsDirty = false;
 }
 
+void ChannelMappingNode::process(AudioSampleBuffer& buffer,
+                                 MidiBuffer& midiMessages)
+{
+    if (remapPlanIsDirty || remapPlanNumChannels != buffer.getNumChannels()
+        || channelBuffer.getNumSamples() < buffer.getNumSamples())
+        updateRemapPlan(buffer.getNumChannels(), buffer.getNumSamples());
+
+    const int numOutputs = jmin(settings.numOutputs, buffer.getNumChannels());
+
+    for (int j = 0; j < numOutputs; j++)
+        outputNumSamples[j] = getNumSamples(j);
+
+    // save the references before the permutation overwrites them
+    for (int g = 0; g < referenceGroups.size(); g++)
+    {
+        const ReferenceGroup* group = referenceGroups[g];
+
+        int nSamples = 0;
+        for (int k = 0; k < group->outputChannels.size(); k++)
+            nSamples = jmax(nSamples, outputNumSamples[group->outputChannels[k]]);
+
+        channelBuffer.copyFrom(g + 1, 0, buffer, group->sourceChannel, 0, nSamples);
+    }
+
+    // permute the channels in place
+    for (int m = 0; m < channelMoves.size(); m++)
+    {
+        const ChannelMove& move = channelMoves.getReference(m);
+
+        const float* source = (move.sourceChannel < 0) ? channelBuffer.getReadPointer(0)
+                                                       : buffer.getReadPointer(move.sourceChannel);
+        float* dest = (move.destChannel < 0) ? channelBuffer.getWritePointer(0)
+                                             : buffer.getWritePointer(move.destChannel);
+
+        FloatVectorOperations::copy(dest, source, outputNumSamples[move.outputChannel]);
+    }
+
+    // subtract each reference from all of its channels, one cache-sized chunk at a time
+    for (int g = 0; g < referenceGroups.size(); g++)
+    {
+        const ReferenceGroup* group = referenceGroups[g];
+        const float* reference = channelBuffer.getReadPointer(g + 1);
+
+        int nSamples = 0;
+        for (int k = 0; k < group->outputChannels.size(); k++)
+            nSamples = jmax(nSamples, outputNumSamples[group->outputChannels[k]]);
+
+        for (int start = 0; start < nSamples; start += REFERENCE_CHUNK_SIZE)
+        {
+            for (int k = 0; k < group->outputChannels.size(); k++)
+            {
+                const int j = group->outputChannels[k];
+                const int n = jmin(REFERENCE_CHUNK_SIZE, outputNumSamples[j] - start);
+
+                if (n > 0)
+                    FloatVectorOperations::subtract(buffer.getWritePointer(j, start), reference + start, n);
+            }
+        }
+    }
+}
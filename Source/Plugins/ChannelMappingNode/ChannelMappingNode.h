@@ -61,6 +61,26 @@ public:
 
 private:
 
+    /** Compiles the channel, reference and enabled arrays into the moves and
+        reference groups applied by process() */
+    void updateRemapPlan(int numInputChannels, int numSamples);
+
+    /** Copies one channel over another; channel -1 is the scratch channel
+        used to break permutation cycles */
+    struct ChannelMove
+    {
+        int destChannel;
+        int sourceChannel;
+        int outputChannel; // output whose sample count is copied
+    };
+
+    /** Output channels referenced against the same input channel */
+    struct ReferenceGroup
+    {
+        int sourceChannel;
+        Array<int> outputChannels;
+    };
+
     Array<int> referenceArray;
     Array<int> referenceChannels;
     Array<int> channelArray;
@@ -68,6 +88,13 @@ private:
 
     bool editorIsConfigured;
 
+    Array<ChannelMove> channelMoves;
+    OwnedArray<ReferenceGroup> referenceGroups;
+    bool remapPlanIsDirty;
+    int remapPlanNumChannels;
+    HeapBlock<int> outputNumSamples;
+
+    /** Channel 0 is the scratch channel, then a copy of each reference */
     AudioSampleBuffer channelBuffer;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelMappingNode);
@@ -11,6 +11,8 @@
 #include "EventBroadcaster.h"
 #include "EventBroadcasterEditor.h"
 
+#include <SpikeLib.h>
+
 std::shared_ptr<void> EventBroadcaster::getZMQContext() {
     // Note: C++11 guarantees that initialization of static local variables occurs exactly once, even
     // if multiple threads attempt to initialize the same static local variable concurrently.
@@ -98,19 +100,34 @@ void EventBroadcaster::handleEvent(int eventType, MidiMessage& event, int sample
     const uint8_t* buffer = event.getRawData();
     uint8_t type = buffer[0];
     int64_t timestamp;
+
+#ifdef ZEROMQ
+    int bufferSize = event.getRawDataSize();
+    uint8_t spikeBuffer[MAX_SPIKE_BUFFER_LEN];
+#endif
     
     switch (type) {
         case TTL:
         case MESSAGE:
         case BINARY_MSG: {
             uint8_t nodeID = buffer[1];
-            timestamp = timestamps.at(nodeID) + samplePosition;
+            timestamp = getSourceTimestamp(nodeID) + samplePosition;
             break;
         }
             
-        case SPIKE:
-            std::copy_n(buffer + 1, sizeof(timestamp), reinterpret_cast<uint8_t *>(&timestamp));
+        case SPIKE: {
+            // spikes travel between processors as descriptors, but are broadcast packed
+            const SpikeObject* spike = getSpikeFromEvent(event);
+            if (spike == nullptr)
+                return;
+
+#ifdef ZEROMQ
+            bufferSize = packSpike(spike, spikeBuffer, MAX_SPIKE_BUFFER_LEN);
+            buffer = spikeBuffer;
+#endif
+            timestamp = spike->timestamp;
             break;
+        }
             
         default:
             // Don't broadcast other event types
@@ -122,7 +139,7 @@ void EventBroadcaster::handleEvent(int eventType, MidiMessage& event, int sample
 #ifdef ZEROMQ
     if (-1 == zmq_send(zmqSocket.get(), &type, sizeof(type), ZMQ_SNDMORE) ||
         -1 == zmq_send(zmqSocket.get(), &timestampSeconds, sizeof(timestampSeconds), ZMQ_SNDMORE) ||
-        -1 == zmq_send(zmqSocket.get(), buffer + 1, event.getRawDataSize() - 1, 0) /* Omit event type */)
+        -1 == zmq_send(zmqSocket.get(), buffer + 1, bufferSize - 1, 0) /* Omit event type */)
     {
         std::cout << "Failed to send message: " << zmq_strerror(zmq_errno()) << std::endl;
     }
@@ -220,6 +220,29 @@ void BiquadBase::applyScale(double scale)
     m_b2 *= scale;
 }
 
+void BiquadBase::setInterpolated(const BiquadBase& from, const BiquadBase& to, double t)
+{
+    m_a0 = from.m_a0 + t * (to.m_a0 - from.m_a0);
+    m_a1 = from.m_a1 + t * (to.m_a1 - from.m_a1);
+    m_a2 = from.m_a2 + t * (to.m_a2 - from.m_a2);
+    m_b0 = from.m_b0 + t * (to.m_b0 - from.m_b0);
+    m_b1 = from.m_b1 + t * (to.m_b1 - from.m_b1);
+    m_b2 = from.m_b2 + t * (to.m_b2 - from.m_b2);
+}
+
+void BiquadBase::copyStagesTo(std::vector<BiquadBase>& stages) const
+{
+    stages.assign(1, *this);
+}
+
+void BiquadBase::setInterpolatedStages(const std::vector<BiquadBase>& from,
+                                       const std::vector<BiquadBase>& to,
+                                       double t)
+{
+    assert(from.size() == 1 && to.size() == 1);
+    setInterpolated(from[0], to[0], t);
+}
+
 //------------------------------------------------------------------------------
 
 Biquad::Biquad()
@@ -96,6 +96,17 @@ public:
         return m_b2*m_a0;
     }
 
+    // Sets each coefficient linearly between those of two biquads,
+    // with t going from 0 to 1.
+    void setInterpolated(const BiquadBase& from, const BiquadBase& to, double t);
+
+    // Used by SmoothedFilterDesign to interpolate between two designs,
+    // see Cascade::copyStagesTo().
+    void copyStagesTo(std::vector<BiquadBase>& stages) const;
+    void setInterpolatedStages(const std::vector<BiquadBase>& from,
+                               const std::vector<BiquadBase>& to,
+                               double t);
+
     // Process a block of samples in the given form
     template <class StateType, typename Sample>
     void process(int numSamples, Sample* dest, StateType& state) const
@@ -0,0 +1,332 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Common.h"
+#include "BiquadBank.h"
+#include "MathSupplement.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define DSP_BIQUADBANK_SSE2 1
+#endif
+
+namespace Dsp
+{
+
+// One biquad stage over n interleaved samples of all the lanes. The
+// operations are done in the same order as in DirectFormII::process1.
+static void processStage(double* block, int n, const double* c, double* state, double& ac, bool alternate)
+{
+#if DSP_BIQUADBANK_SSE2
+    const __m128d a1 = _mm_set1_pd(c[0]);
+    const __m128d a2 = _mm_set1_pd(c[1]);
+    const __m128d b0 = _mm_set1_pd(c[2]);
+    const __m128d b1 = _mm_set1_pd(c[3]);
+    const __m128d b2 = _mm_set1_pd(c[4]);
+
+    const int numVectors = BiquadBank::Lanes / 2;
+    __m128d v1[numVectors];
+    __m128d v2[numVectors];
+
+    for (int k = 0; k < numVectors; ++k)
+    {
+        v1[k] = _mm_loadu_pd(state + 2*k);
+        v2[k] = _mm_loadu_pd(state + BiquadBank::Lanes + 2*k);
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        double* io = block + i * BiquadBank::Lanes;
+
+        if (alternate)
+            ac = -ac;
+        const __m128d vsa = _mm_set1_pd(ac);
+
+        for (int k = 0; k < numVectors; ++k)
+        {
+            const __m128d in = _mm_loadu_pd(io + 2*k);
+            const __m128d w = _mm_add_pd(_mm_sub_pd(_mm_sub_pd(in, _mm_mul_pd(a1, v1[k])), _mm_mul_pd(a2, v2[k])), vsa);
+            const __m128d out = _mm_add_pd(_mm_add_pd(_mm_mul_pd(b0, w), _mm_mul_pd(b1, v1[k])), _mm_mul_pd(b2, v2[k]));
+
+            v2[k] = v1[k];
+            v1[k] = w;
+            _mm_storeu_pd(io + 2*k, out);
+        }
+    }
+
+    for (int k = 0; k < numVectors; ++k)
+    {
+        _mm_storeu_pd(state + 2*k, v1[k]);
+        _mm_storeu_pd(state + BiquadBank::Lanes + 2*k, v2[k]);
+    }
+#else
+    const double a1 = c[0];
+    const double a2 = c[1];
+    const double b0 = c[2];
+    const double b1 = c[3];
+    const double b2 = c[4];
+
+    double* v1 = state;
+    double* v2 = state + BiquadBank::Lanes;
+
+    for (int i = 0; i < n; ++i)
+    {
+        double* io = block + i * BiquadBank::Lanes;
+
+        if (alternate)
+            ac = -ac;
+
+        for (int lane = 0; lane < BiquadBank::Lanes; ++lane)
+        {
+            const double w   = io[lane] - a1*v1[lane] - a2*v2[lane] + ac;
+            const double out =       b0*w + b1*v1[lane] + b2*v2[lane];
+
+            v2[lane] = v1[lane];
+            v1[lane] = w;
+            io[lane] = out;
+        }
+    }
+#endif
+}
+
+BiquadBank::BiquadBank()
+    : m_hasPendingGroups(false), m_block(BlockSize * Lanes)
+{
+}
+
+void BiquadBank::setNumChannels(int numChannels)
+{
+    m_channels.clear();
+    m_channels.resize(numChannels);
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        m_channels[i].groupKey = 0;
+        m_channels[i].enabled = false;
+    }
+
+    m_groups.clear();
+    m_pendingGroups.clear();
+    m_hasPendingGroups = false;
+}
+
+void BiquadBank::setChannelCoefficients(int channel, Cascade& cascade, int groupKey)
+{
+    m_channels[channel].groupKey = groupKey;
+
+    std::vector<double>& c = m_channels[channel].coefficients;
+    c.resize(5 * cascade.getNumStages());
+
+    for (int i = 0; i < cascade.getNumStages(); ++i)
+    {
+        const Biquad& stage = cascade[i];
+        c[5*i]     = stage.m_a1;
+        c[5*i + 1] = stage.m_a2;
+        c[5*i + 2] = stage.m_b0;
+        c[5*i + 3] = stage.m_b1;
+        c[5*i + 4] = stage.m_b2;
+    }
+}
+
+void BiquadBank::setChannelEnabled(int channel, bool enabled)
+{
+    m_channels[channel].enabled = enabled;
+}
+
+void BiquadBank::update()
+{
+    prepareUpdate();
+    commitUpdate();
+}
+
+void BiquadBank::prepareUpdate()
+{
+    // also frees the groups replaced by the last commit
+    m_pendingGroups.clear();
+
+    for (size_t i = 0; i < m_channels.size(); ++i)
+    {
+        const ChannelSettings& channel = m_channels[i];
+
+        if (!channel.enabled || channel.coefficients.empty())
+            continue;
+
+        size_t g = 0;
+        while (g < m_pendingGroups.size() && (m_pendingGroups[g].groupKey != channel.groupKey
+                                              || m_pendingGroups[g].coefficients != channel.coefficients))
+            ++g;
+
+        if (g == m_pendingGroups.size())
+        {
+            Group group;
+            group.numStages = int(channel.coefficients.size() / 5);
+            group.groupKey = channel.groupKey;
+            group.coefficients = channel.coefficients;
+            group.vsa = anti_denormal_vsa;
+            m_pendingGroups.push_back(group);
+        }
+
+        m_pendingGroups[g].channels.push_back(int(i));
+    }
+
+    // where every channel is in the running groups
+    std::vector<int> runningGroup(m_channels.size(), -1);
+    std::vector<int> runningPosition(m_channels.size(), -1);
+
+    for (size_t g = 0; g < m_groups.size(); ++g)
+    {
+        for (size_t i = 0; i < m_groups[g].channels.size(); ++i)
+        {
+            runningGroup[m_groups[g].channels[i]] = int(g);
+            runningPosition[m_groups[g].channels[i]] = int(i);
+        }
+    }
+
+    for (size_t g = 0; g < m_pendingGroups.size(); ++g)
+    {
+        Group& group = m_pendingGroups[g];
+        const int numLaneGroups = (int(group.channels.size()) + Lanes - 1) / Lanes;
+        group.state.assign(numLaneGroups * group.numStages * 2 * Lanes, 0.0);
+        group.sourceGroups.assign(group.channels.size(), -1);
+        group.sourcePositions.assign(group.channels.size(), -1);
+
+        for (size_t i = 0; i < group.channels.size(); ++i)
+        {
+            const int source = runningGroup[group.channels[i]];
+
+            // new coefficients of the same order continue from the old state
+            if (source >= 0 && m_groups[source].numStages == group.numStages)
+            {
+                group.sourceGroups[i] = source;
+                group.sourcePositions[i] = runningPosition[group.channels[i]];
+            }
+        }
+    }
+
+    m_hasPendingGroups = true;
+}
+
+void BiquadBank::commitUpdate()
+{
+    if (!m_hasPendingGroups)
+        return;
+
+    const double vsa = m_groups.empty() ? anti_denormal_vsa : m_groups.back().vsa;
+
+    for (size_t g = 0; g < m_pendingGroups.size(); ++g)
+    {
+        Group& group = m_pendingGroups[g];
+        group.vsa = vsa;
+
+        for (size_t i = 0; i < group.channels.size(); ++i)
+        {
+            if (group.sourceGroups[i] < 0)
+                continue;
+
+            const Group& source = m_groups[group.sourceGroups[i]];
+            const int sourceLane = group.sourcePositions[i] % Lanes;
+            const double* from = &source.state[(group.sourcePositions[i] / Lanes) * source.numStages * 2 * Lanes];
+
+            const int lane = int(i) % Lanes;
+            double* to = &group.state[(int(i) / Lanes) * group.numStages * 2 * Lanes];
+
+            for (int v = 0; v < 2 * group.numStages; ++v)
+                to[v * Lanes + lane] = from[v * Lanes + sourceLane];
+        }
+    }
+
+    m_groups.swap(m_pendingGroups);
+    m_hasPendingGroups = false;
+}
+
+void BiquadBank::reset()
+{
+    for (size_t g = 0; g < m_groups.size(); ++g)
+    {
+        std::fill(m_groups[g].state.begin(), m_groups[g].state.end(), 0.0);
+        m_groups[g].vsa = anti_denormal_vsa;
+    }
+}
+
+void BiquadBank::process(const int* numSamplesPerChannel, float* const* arrayOfChannels)
+{
+    for (size_t g = 0; g < m_groups.size(); ++g)
+    {
+        Group& group = m_groups[g];
+        const int numSamples = numSamplesPerChannel[group.channels[0]];
+        const int numLaneGroups = (int(group.channels.size()) + Lanes - 1) / Lanes;
+
+        for (int laneGroup = 0; laneGroup < numLaneGroups; ++laneGroup)
+            processLanes(group, laneGroup, numSamples, arrayOfChannels);
+
+        // the denormal prevention current alternates once per sample
+        if (numSamples % 2 != 0)
+            group.vsa = -group.vsa;
+    }
+}
+
+void BiquadBank::processLanes(Group& group, int laneGroup, int numSamples, float* const* arrayOfChannels)
+{
+    const int firstChannel = laneGroup * Lanes;
+    const int numLanes = std::min(int(Lanes), int(group.channels.size()) - firstChannel);
+    double* const block = &m_block[0];
+    double* const state = &group.state[laneGroup * group.numStages * 2 * Lanes];
+
+    double vsa = group.vsa;
+
+    for (int start = 0; start < numSamples; start += BlockSize)
+    {
+        const int n = std::min(int(BlockSize), numSamples - start);
+
+        // interleave the lanes; unused lanes filter a copy of the first one, since
+        // silence would decay into denormals
+        for (int lane = 0; lane < Lanes; ++lane)
+        {
+            const int channel = group.channels[firstChannel + (lane < numLanes ? lane : 0)];
+            const float* src = arrayOfChannels[channel] + start;
+
+            for (int i = 0; i < n; ++i)
+                block[i * Lanes + lane] = src[i];
+        }
+
+        for (int s = 0; s < group.numStages; ++s)
+        {
+            // only the first stage gets the denormal prevention current
+            double ac = s == 0 ? vsa : 0;
+
+            processStage(block, n, &group.coefficients[5*s], &state[2*s*Lanes], ac, s == 0);
+
+            if (s == 0)
+                vsa = ac;
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            float* dest = arrayOfChannels[group.channels[firstChannel + lane]] + start;
+            for (int i = 0; i < n; ++i)
+                dest[i] = static_cast<float>(block[i * Lanes + lane]);
+        }
+    }
+}
+
+}
@@ -0,0 +1,142 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DSPFILTERS_BIQUADBANK_H
+#define DSPFILTERS_BIQUADBANK_H
+
+#include <vector>
+
+#include "Common.h"
+#include "Cascade.h"
+
+namespace Dsp
+{
+
+/*
+ * Filters many channels with biquad cascades, in Direct Form II.
+ *
+ * Channels that use exactly the same coefficients, and that were given the
+ * same group key (channels from one data source, which always have the same
+ * number of samples in a block), are put in a group, and each group is processed Lanes channels at a time: the samples of
+ * those channels are interleaved into a small block, and every stage
+ * runs over all the lanes of a sample in one inner loop. The recursion
+ * of each channel stays sequential, but the lanes are independent, so
+ * the compiler turns the inner loop into SIMD instructions. Blocks are
+ * short enough to stay in the L1 cache across all the stages.
+ *
+ * The arithmetic is the same as that of DirectFormII with a Cascade,
+ * in double precision and with the same denormal prevention, so the
+ * output matches the per-channel filters.
+ *
+ * Call update() after changing the coefficients or enabled channels;
+ * the state of channels that keep the same number of stages is carried over.
+ * While another thread is filtering, use prepareUpdate() instead, then
+ * commitUpdate() with that thread held off: only the commit touches the
+ * running groups, and it doesn't allocate.
+ *
+ */
+class BiquadBank
+{
+public:
+    enum
+    {
+        Lanes = 8,          // channels processed together
+        BlockSize = 64      // samples per cache block
+    };
+
+    BiquadBank();
+
+    // Sets the number of channels, all of them disabled.
+    void setNumChannels(int numChannels);
+
+    int getNumChannels() const
+    {
+        return int(m_channels.size());
+    }
+
+    // Copies the coefficients of a cascade for one channel.
+    void setChannelCoefficients(int channel, Cascade& cascade, int groupKey = 0);
+
+    // Disabled channels are left untouched by process().
+    void setChannelEnabled(int channel, bool enabled);
+
+    // Rebuilds the groups after the channel settings have changed.
+    void update();
+
+    // Builds the new groups for the current channel settings, without
+    // touching the ones process() is using.
+    void prepareUpdate();
+
+    // Swaps in the groups built by prepareUpdate(), carrying the state over.
+    // The channel settings must not change in between.
+    void commitUpdate();
+
+    // Clears the state of every channel.
+    void reset();
+
+    // Filters every enabled channel in place. numSamples holds the number
+    // of samples of each channel.
+    void process(const int* numSamples, float* const* arrayOfChannels);
+
+    int getNumGroups() const
+    {
+        return int(m_groups.size());
+    }
+
+private:
+    struct ChannelSettings
+    {
+        std::vector<double> coefficients;   // a1, a2, b0, b1, b2 per stage
+        int groupKey;
+        bool enabled;
+    };
+
+    struct Group
+    {
+        int numStages;
+        int groupKey;
+        std::vector<double> coefficients;
+        std::vector<int> channels;
+
+        // v1[Lanes], v2[Lanes] per stage, for each set of Lanes channels
+        std::vector<double> state;
+        double vsa;
+
+        // where the state of each channel comes from when the group is
+        // committed: a running group and position in it, or -1
+        std::vector<int> sourceGroups;
+        std::vector<int> sourcePositions;
+    };
+
+    void processLanes(Group& group, int laneGroup, int numSamples, float* const* arrayOfChannels);
+
+    std::vector<ChannelSettings> m_channels;
+    std::vector<Group> m_groups;
+    std::vector<Group> m_pendingGroups;     // built by prepareUpdate(), or replaced by commitUpdate()
+    bool m_hasPendingGroups;
+    std::vector<double> m_block;
+};
+
+}
+
+#endif
@@ -111,6 +111,16 @@ public:
         return m_stageArray[index];
     }
 
+    // Copies the coefficients of every stage.
+    void copyStagesTo(std::vector<BiquadBase>& stages) const;
+
+    // Sets the stages linearly between two sets of coefficients with the
+    // same number of stages, with t going from 0 to 1. This is much cheaper
+    // than a new design for every sample of a parameter transition.
+    void setInterpolatedStages(const std::vector<BiquadBase>& from,
+                               const std::vector<BiquadBase>& to,
+                               double t);
+
 public:
     // Calculate filter response at the given normalized frequency.
     complex_t response(double normalizedFrequency) const;
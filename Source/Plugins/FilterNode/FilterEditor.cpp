@@ -74,6 +74,14 @@ FilterEditor::FilterEditor(GenericProcessor* parentNode, bool useDefaultParamete
     applyFilterOnADC->setTooltip("When this button is off, ADC channels will not be filtered");
     addAndMakeVisible(applyFilterOnADC);
 
+    useFilterBank = new UtilityButton("BANK",Font("Default", 10, Font::plain));
+    useFilterBank->addListener(this);
+    useFilterBank->setBounds(90,42,40,18);
+    useFilterBank->setClickingTogglesState(true);
+    useFilterBank->setToggleState(true, dontSendNotification);
+    useFilterBank->setTooltip("When this button is on, channels with the same cutoffs are filtered together by a vectorized filter bank");
+    addAndMakeVisible(useFilterBank);
+
     applyFilterOnChan = new UtilityButton("+CH",Font("Default", 10, Font::plain));
     applyFilterOnChan->addListener(this);
     applyFilterOnChan->setBounds(95,95,30,18);
@@ -181,6 +189,11 @@ void FilterEditor::buttonEvent(Button* button)
         fn->setApplyOnADC(applyFilterOnADC->getToggleState());
 
     }
+    else if (button == useFilterBank)
+    {
+        FilterNode* fn = (FilterNode*) getProcessor();
+        fn->setParameter(3, useFilterBank->getToggleState() ? 1.0f : 0.0f);
+    }
     else if (button == applyFilterOnChan)
     {
         FilterNode* fn = (FilterNode*) getProcessor();
@@ -210,6 +223,7 @@ void FilterEditor::saveCustomParameters(XmlElement* xml)
     textLabelValues->setAttribute("HighCut",lastHighCutString);
     textLabelValues->setAttribute("LowCut",lastLowCutString);
     textLabelValues->setAttribute("ApplyToADC",	applyFilterOnADC->getToggleState());
+    textLabelValues->setAttribute("FilterBank", useFilterBank->getToggleState());
 }
 
 void FilterEditor::loadCustomParameters(XmlElement* xml)
@@ -222,6 +236,7 @@ void FilterEditor::loadCustomParameters(XmlElement* xml)
             highCutValue->setText(xmlNode->getStringAttribute("HighCut"),dontSendNotification);
             lowCutValue->setText(xmlNode->getStringAttribute("LowCut"),dontSendNotification);
             applyFilterOnADC->setToggleState(xmlNode->getBoolAttribute("ApplyToADC",false), sendNotification);
+            useFilterBank->setToggleState(xmlNode->getBoolAttribute("FilterBank",true), sendNotification);
         }
     }
 
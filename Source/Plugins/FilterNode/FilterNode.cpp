@@ -25,8 +25,12 @@
 #include "FilterNode.h"
 #include "FilterEditor.h"
 
+// cutoff changes are smoothed over this many samples (about 30 ms at 30 kHz)
+#define FILTER_TRANSITION_SAMPLES 1024
+
 FilterNode::FilterNode()
-    : GenericProcessor("Bandpass Filter"), defaultLowCut(300.0f), defaultHighCut(6000.0f)
+    : GenericProcessor("Bandpass Filter"), defaultLowCut(300.0f), defaultHighCut(6000.0f),
+      useFilterBank(true)
 
 {
 
@@ -141,6 +145,12 @@ void FilterNode::updateSettings()
         highCuts.clear();
         shouldFilterChannel.clear();
 
+        {
+            const ScopedLock sl(filterBankLock);
+            filterBank.setNumChannels(numInputs);
+            filterBankSamples.calloc(jmax(1, numInputs));
+        }
+
         for (int n = 0; n < getNumInputs(); n++)
         {
 
@@ -151,7 +161,7 @@ void FilterNode::updateSettings()
                         <2>,								 	// order
                         1,										// number of channels (must be const)
                         Dsp::DirectFormII>						// realization
-                        (1));
+                        (FILTER_TRANSITION_SAMPLES));
 
 
             //Parameter& p1 =  parameters.getReference(0);
@@ -184,6 +194,7 @@ void FilterNode::updateSettings()
 
     }
 
+    // also rebuilds the filter bank groups
     setApplyOnADC(applyOnADC);
 
 }
@@ -214,8 +225,34 @@ void FilterNode::setFilterParameters(double lowCut, double highCut, int chan)
     params[3] = highCut - lowCut; // bandwidth
 
     if (filters.size() > chan)
+    {
+        // process() may be part way through a transition of this filter
+        const ScopedLock sl(filterBankLock);
         filters[chan]->setParams(params);
+    }
+
+    setFilterBankParameters(lowCut, highCut, chan);
+}
 
+void FilterNode::setFilterBankParameters(double lowCut, double highCut, int chan)
+{
+    if (chan >= filterBank.getNumChannels())
+        return;
+
+    Dsp::Butterworth::BandPass<2> design;
+    design.setup(2, channels[chan]->sampleRate, (highCut + lowCut)/2, highCut - lowCut);
+
+    // process() only uses the groups, so the channel settings can change without the lock
+    filterBank.setChannelCoefficients(chan, design, channels[chan]->sourceNodeId);
+    filterBank.setChannelEnabled(chan, shouldFilterChannel[chan]);
+}
+
+void FilterNode::updateFilterBank()
+{
+    filterBank.prepareUpdate();
+
+    const ScopedLock sl(filterBankLock);
+    filterBank.commitUpdate();
 }
 
 void FilterNode::setParameter(int parameterIndex, float newValue)
@@ -243,11 +280,12 @@ void FilterNode::setParameter(int parameterIndex, float newValue)
         setFilterParameters(lowCuts[currentChannel],
                             highCuts[currentChannel],
                             currentChannel);
+        updateFilterBank();
 
         editor->updateParameterButtons(parameterIndex);
 
     }
-    else   // change channel bypass state
+    else if (parameterIndex == 2)  // change channel bypass state
     {
         if (newValue == 0)
         {
@@ -258,13 +296,47 @@ void FilterNode::setParameter(int parameterIndex, float newValue)
             shouldFilterChannel.set(currentChannel, true);
         }
 
+        if (currentChannel >= 0 && currentChannel < filterBank.getNumChannels())
+        {
+            filterBank.setChannelEnabled(currentChannel, shouldFilterChannel[currentChannel]);
+            updateFilterBank();
+        }
+    }
+    else   // switch between the filter bank and the per-channel filters
+    {
+        const ScopedLock sl(filterBankLock);
+
+        useFilterBank = newValue != 0;
+
+        // whichever path takes over starts from silence
+        if (useFilterBank)
+            filterBank.reset();
+        else
+            for (int n = 0; n < filters.size(); n++)
+                filters[n]->reset();
     }
 }
 
+bool FilterNode::getFilterBankState()
+{
+    return useFilterBank;
+}
+
 void FilterNode::process(AudioSampleBuffer& buffer,
                          MidiBuffer& midiMessages)
 {
 
+    const ScopedLock sl(filterBankLock);
+
+    if (useFilterBank && filterBank.getNumChannels() == getNumOutputs())
+    {
+        for (int n = 0; n < getNumOutputs(); n++)
+            filterBankSamples[n] = getNumSamples(n);
+
+        filterBank.process(filterBankSamples, buffer.getArrayOfWritePointers());
+        return;
+    }
+
     for (int n = 0; n < getNumOutputs(); n++)
     {
         if (shouldFilterChannel[n])
@@ -283,14 +355,15 @@ void FilterNode::setApplyOnADC(bool state)
     {
         if (channels[n]->getType() == ADC_CHANNEL || channels[n]->getType() == AUX_CHANNEL)
         {
-            setCurrentChannel(n);
+            shouldFilterChannel.set(n, state);
 
-            if (state)
-                setParameter(2,1.0);
-            else
-                setParameter(2,0.0);
+            if (n < filterBank.getNumChannels())
+                filterBank.setChannelEnabled(n, state);
         }
     }
+
+    // one regrouping for all of the channels
+    updateFilterBank();
 }
 
 void FilterNode::saveCustomChannelParametersToXml(XmlElement* channelInfo, int channelNumber, bool isEventChannel)
@@ -328,6 +401,7 @@ void FilterNode::loadCustomChannelParametersFromXml(XmlElement* channelInfo, boo
                 setFilterParameters(lowCuts[channelNum],
                                     highCuts[channelNum],
                                     channelNum);
+                updateFilterBank();
 
             }
         }
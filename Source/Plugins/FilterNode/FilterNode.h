@@ -33,6 +33,12 @@
 
   The user can select the low- and high-frequency cutoffs.
 
+  By default, channels are filtered by a Dsp::BiquadBank, which processes
+  all channels sharing the same cutoffs together with SIMD instructions.
+  The per-channel filters can still be selected in the editor. The
+  "filter" benchmark of open-ephys-benchmarks compares the speed of both
+  paths.
+
   @see GenericProcessor, FilterEditor
 
 */
@@ -66,6 +72,9 @@ public:
     void loadCustomChannelParametersFromXml(XmlElement* channelInfo, bool isEventChannel);
 
     void setApplyOnADC(bool state);
+
+    bool getFilterBankState();
+
 private:
 
     Array<double> lowCuts, highCuts;
@@ -76,7 +85,20 @@ private:
     double defaultLowCut;
     double defaultHighCut;
 
+    /** Filters the channels when useFilterBank is set; guarded by filterBankLock */
+    Dsp::BiquadBank filterBank;
+    HeapBlock<int> filterBankSamples;
+    bool useFilterBank;
+
+    /** Held by process(), and while the filter bank or the per-channel filters change */
+    CriticalSection filterBankLock;
+
     void setFilterParameters(double, double, int);
+    void setFilterBankParameters(double lowCut, double highCut, int chan);
+
+    /** Regroups the filter bank channels after their settings have changed.
+        The new groups are built before taking filterBankLock. */
+    void updateFilterBank();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterNode);
 
@@ -29,7 +29,8 @@ using namespace H5;
 
 #define PROCESS_ERROR std::cerr << "KwikFilesource exception: " << error.getCDetailMsg() << std::endl
 
-KWIKFileSource::KWIKFileSource() : samplePos(0), skipRecordEngineCheck(false)
+KWIKFileSource::KWIKFileSource() : samplePos(0), chunkSize(1), cacheClock(0),
+    cacheHits(0), cacheMisses(0), skipRecordEngineCheck(false)
 {
 }
 
@@ -170,10 +171,36 @@ void KWIKFileSource::fillRecordInfo()
 void KWIKFileSource::updateActiveRecord()
 {
     samplePos=0;
+    chunkCache.clear();
+    cacheHits = 0;
+    cacheMisses = 0;
+
     try
     {
         String path = "/recordings/" + String(availableDataSets[activeRecord]) + "/data";
         dataSet = new DataSet(sourceFile->openDataSet(path.toUTF8()));
+
+        // cache whole chunks along the sample axis, as they are laid out in the file
+        DSetCreatPropList prop = dataSet->getCreatePlist();
+        hsize_t chunk[2] = {2048, 1};
+
+        if (prop.getLayout() == H5D_CHUNKED)
+            prop.getChunk(2,chunk);
+
+        chunkSize = jmax(1, int(chunk[0]));
+
+        int nChannels = jmax(1, getActiveNumChannels());
+        int numChunks = jmax(KWIK_MIN_CACHED_CHUNKS, int(KWIK_CHUNK_CACHE_SIZE / (int64(chunkSize) * nChannels * 2)));
+
+        for (int i=0; i < numChunks; i++)
+        {
+            CachedChunk* c = new CachedChunk();
+            c->index = -1;
+            c->numSamples = 0;
+            c->lastUsed = 0;
+            c->data.malloc(chunkSize * nChannels);
+            chunkCache.add(c);
+        }
     }
     catch (FileIException error)
     {
@@ -192,49 +219,100 @@ void KWIKFileSource::seekTo(int64 sample)
 
 int KWIKFileSource::readData(int16* buffer, int nSamples)
 {
-    DataSpace fSpace,mSpace;
-    int samplesToRead;
     int nChannels = getActiveNumChannels();
-    hsize_t dim[3],offset[3];
+    int samplesToRead = int(jmin(int64(nSamples), getActiveNumSamples() - samplePos));
+    int samplesRead = 0;
 
-    if (samplePos + nSamples > getActiveNumSamples())
+    // the dataset holds the samples of all channels interleaved, like the buffer
+    while (samplesRead < samplesToRead)
     {
-        samplesToRead = getActiveNumSamples() - samplePos;
+        const CachedChunk* c = getChunk(samplePos / chunkSize);
+        if (c == nullptr)
+            break;
+
+        int offset = int(samplePos % chunkSize);
+        int n = jmin(samplesToRead - samplesRead, c->numSamples - offset);
+        if (n <= 0)
+            break;
+
+        memcpy(buffer + samplesRead*nChannels, c->data + offset*nChannels, n*nChannels*sizeof(int16));
+
+        samplesRead += n;
+        samplePos += n;
     }
-    else
+
+    return samplesRead;
+}
+
+const KWIKFileSource::CachedChunk* KWIKFileSource::getChunk(int64 index)
+{
+    cacheClock++;
+
+    CachedChunk* victim = nullptr;
+
+    for (int i=0; i < chunkCache.size(); i++)
     {
-        samplesToRead = nSamples;
+        CachedChunk* c = chunkCache.getUnchecked(i);
+
+        if (c->index == index)
+        {
+            c->lastUsed = cacheClock;
+            cacheHits++;
+            return c;
+        }
+
+        if (victim == nullptr || c->index < 0 || (victim->index >= 0 && c->lastUsed < victim->lastUsed))
+            victim = c;
     }
 
+    if (victim == nullptr)
+        return nullptr;
+
+    cacheMisses++;
+
+    DataSpace fSpace,mSpace;
+    int nChannels = getActiveNumChannels();
+    hsize_t dim[2],offset[2];
+
     try
     {
         fSpace = dataSet->getSpace();
-        dim[0] = samplesToRead;
+        dim[0] = jmin(int64(chunkSize), getActiveNumSamples() - index*chunkSize);
         dim[1] = nChannels;
-        dim[2] = 1;
-        offset[0] = samplePos;
+        offset[0] = index*chunkSize;
         offset[1] = 0;
-        offset[2] = 0;
 
         fSpace.selectHyperslab(H5S_SELECT_SET,dim,offset);
         mSpace = DataSpace(2,dim);
 
-        dataSet->read(buffer,PredType::NATIVE_INT16,mSpace,fSpace);
-        samplePos += samplesToRead;
-        return samplesToRead;
+        victim->index = -1;
+        dataSet->read(victim->data.getData(),PredType::NATIVE_INT16,mSpace,fSpace);
 
+        victim->index = index;
+        victim->numSamples = int(dim[0]);
+        victim->lastUsed = cacheClock;
+        return victim;
     }
     catch (DataSetIException error)
     {
         PROCESS_ERROR;
-        return 0;
+        return nullptr;
     }
     catch (DataSpaceIException error)
     {
         PROCESS_ERROR;
-        return 0;
+        return nullptr;
     }
-    return 0;
+}
+
+int64 KWIKFileSource::getCacheHits() const
+{
+    return cacheHits;
+}
+
+int64 KWIKFileSource::getCacheMisses() const
+{
+    return cacheMisses;
 }
 
 void KWIKFileSource::processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples)
@@ -249,6 +327,24 @@ void KWIKFileSource::processChannelData(int16* inBuffer, float* outBuffer, int c
 
 }
 
+void KWIKFileSource::processAllChannelData(int16* inBuffer, float** outBuffers, int64 numSamples)
+{
+    int n = getActiveNumChannels();
+    HeapBlock<float> bitVolts(n);
+
+    for (int j=0; j < n; j++)
+        bitVolts[j] = getChannelInfo(j).bitVolts;
+
+    // one pass over the interleaved samples, instead of one per channel
+    for (int i=0; i < numSamples; i++)
+    {
+        const int16* frame = inBuffer + n*i;
+
+        for (int j=0; j < n; j++)
+            outBuffers[j][i] = frame[j] * bitVolts[j];
+    }
+}
+
 bool KWIKFileSource::isReady()
 {
 	//HDF5 is by default not thread-safe, so we must warn the user.
@@ -29,6 +29,10 @@
 #define MIN_KWIK_VERSION 2
 #define MAX_KWIK_VERSION 2
 
+// memory used by the chunk cache of the active recording, in bytes
+#define KWIK_CHUNK_CACHE_SIZE (16*1024*1024)
+#define KWIK_MIN_CACHED_CHUNKS 4
+
 class HDF5RecordingData;
 namespace H5
 {
@@ -49,9 +53,30 @@ public:
 
     void processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples) override;
 
+    void processAllChannelData(int16* inBuffer, float** outBuffers, int64 numSamples) override;
+
 	bool isReady() override;
 
+    /** Number of reads served from the chunk cache since the active record was set. */
+    int64 getCacheHits() const;
+
+    /** Number of chunks read from the file since the active record was set. */
+    int64 getCacheMisses() const;
+
 private:
+    /** Samples of all channels for one aligned range of chunkSize rows of the dataset. */
+    struct CachedChunk
+    {
+        int64 index;
+        int numSamples;
+        uint32 lastUsed;
+        HeapBlock<int16> data;
+    };
+
+    /** Returns a chunk from the cache, reading it from the file in place of
+        the least recently used one if needed. Returns nullptr on read errors. */
+    const CachedChunk* getChunk(int64 index);
+
     ScopedPointer<H5::H5File> sourceFile;
     ScopedPointer<H5::DataSet> dataSet;
     bool Open(File file) override;
@@ -59,6 +84,13 @@ private:
     void updateActiveRecord() override;
     int64 samplePos;
     Array<int> availableDataSets;
+
+    OwnedArray<CachedChunk> chunkCache;
+    int chunkSize;
+    uint32 cacheClock;
+    int64 cacheHits;
+    int64 cacheMisses;
+
 	bool skipRecordEngineCheck;
 };
 
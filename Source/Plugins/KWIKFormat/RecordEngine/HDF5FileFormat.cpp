@@ -55,7 +55,8 @@ using namespace H5;
 
 //HDF5FileBase
 
-HDF5FileBase::HDF5FileBase() : readyToOpen(false), opened(false)
+HDF5FileBase::HDF5FileBase() : readyToOpen(false), chunkCacheSize(0),
+    chunkLength(CHUNK_XSIZE), chunkChannels(0), opened(false)
 {
     Exception::dontPrint();
 };
@@ -99,9 +100,16 @@ int HDF5FileBase::open(bool newfile, int nChans)
     try
     {
 		FileAccPropList props = FileAccPropList::DEFAULT;
-		if (nChans > 0)
+		if (chunkCacheSize > 0)
 		{
-			props.setCache(0, 1667, 2 * 8 * 2 * CHUNK_XSIZE * nChans, 1);
+			props.setCache(0, 1667, chunkCacheSize, 1);
+		}
+		else if (nChans > 0)
+		{
+			//whole chunks of every channel, with the channels rounded up to the chunks covering them
+			const int chunkChans = (chunkChannels > 0 && chunkChannels < nChans) ? chunkChannels : nChans;
+			const size_t cachedChans = size_t((nChans + chunkChans - 1) / chunkChans) * chunkChans;
+			props.setCache(0, 1667, 2 * 8 * 2 * size_t(jmax(1, chunkLength)) * cachedChans, 1);
 			//std::cout << "opening HDF5 " << getFileName() << " with nchans: " << nChans << std::endl;
 		}
 
@@ -346,7 +354,8 @@ HDF5RecordingData* HDF5FileBase::createDataSet(DataTypes type, int sizeX, int si
     return createDataSet(type,3,size,chunks,path);
 }
 
-HDF5RecordingData* HDF5FileBase::createDataSet(DataTypes type, int dimension, int* size, int* chunking, String path)
+HDF5RecordingData* HDF5FileBase::createDataSet(DataTypes type, int dimension, int* size, int* chunking, String path,
+                                                int deflateLevel, bool shuffle)
 {
     ScopedPointer<DataSet> data;
     DSetCreatPropList prop;
@@ -380,6 +389,14 @@ HDF5RecordingData* HDF5FileBase::createDataSet(DataTypes type, int dimension, in
         DataSpace dSpace(dimension,dims,max_dims);
         prop.setChunk(dimension,chunk_dims);
 
+        //filters are applied in the order they are added, so the shuffle goes first
+        if (deflateLevel > 0 && H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0)
+        {
+            if (shuffle && H5Zfilter_avail(H5Z_FILTER_SHUFFLE) > 0)
+                prop.setShuffle();
+            prop.setDeflate(jmin(deflateLevel,9));
+        }
+
         data = new DataSet(file->createDataSet(path.toUTF8(),H5type,dSpace,prop));
         return new HDF5RecordingData(data.release());
     }
@@ -398,6 +415,11 @@ HDF5RecordingData* HDF5FileBase::createDataSet(DataTypes type, int dimension, in
         error.printError();
         return nullptr;
     }
+    catch (PropListIException error)
+    {
+        error.printError();
+        return nullptr;
+    }
 
 
 }
@@ -629,6 +651,23 @@ int HDF5RecordingData::writeDataRow(int yPos, int xDataSize, HDF5FileBase::DataT
     return 0;
 }
 
+int HDF5RecordingData::writeDataRows(int xDataSize, HDF5FileBase::DataTypes type, void* data)
+{
+    if (dimension != 2) return -4;
+
+    for (int i = 0; i < rowXPos.size(); i++)
+    {
+        if (rowXPos[i] != xPos) return -2;
+    }
+
+    int ret = writeDataBlock(xDataSize,type,data);
+    if (ret) return ret;
+
+    for (int i = 0; i < rowXPos.size(); i++)
+        rowXPos.set(i,xPos);
+    return 0;
+}
+
 void HDF5RecordingData::getRowXPositions(Array<uint32>& rows)
 {
     rows.clear();
@@ -637,12 +676,18 @@ void HDF5RecordingData::getRowXPositions(Array<uint32>& rows)
 
 //KWD File
 
-KWDFile::KWDFile(int processorNumber, String basename) : HDF5FileBase()
+KWDSettings::KWDSettings()
+    : chunkLength(CHUNK_XSIZE), chunkChannels(0), deflateLevel(0),
+      shuffle(true), cacheSizeMB(0), bufferWrites(true)
+{
+}
+
+KWDFile::KWDFile(int processorNumber, String basename) : HDF5FileBase(), rowBufferLength(0)
 {
     initFile(processorNumber, basename);
 }
 
-KWDFile::KWDFile() : HDF5FileBase()
+KWDFile::KWDFile() : HDF5FileBase(), rowBufferLength(0)
 {
 }
 
@@ -660,6 +705,15 @@ void KWDFile::initFile(int processorNumber, String basename)
     readyToOpen=true;
 }
 
+void KWDFile::setSettings(const KWDSettings& newSettings)
+{
+    if (isOpen()) return;
+    settings = newSettings;
+    chunkCacheSize = size_t(jmax(0,settings.cacheSizeMB)) * 1024 * 1024;
+    chunkLength = settings.chunkLength;
+    chunkChannels = settings.chunkChannels;
+}
+
 void KWDFile::startNewRecording(int recordingNumber, int nChannels, HDF5RecordingInfo* info)
 {
     this->recordingNumber = recordingNumber;
@@ -693,10 +747,23 @@ void KWDFile::startNewRecording(int recordingNumber, int nChannels, HDF5Recordin
 	else
 		std::cerr << "Error creating sample rates data set" << std::endl;
 
-    recdata = createDataSet(I16,0,nChannels,CHUNK_XSIZE,recordPath+"/data");
+    int size[2] = {0, nChannels};
+    int chunks[2] = {jmax(1,settings.chunkLength), 0};
+    if (settings.chunkChannels > 0 && settings.chunkChannels < nChannels)
+        chunks[1] = settings.chunkChannels;
+    recdata = createDataSet(I16,2,size,chunks,recordPath+"/data",settings.deflateLevel,settings.shuffle);
     if (!recdata.get())
         std::cerr << "Error creating data set" << std::endl;
 
+    rowBufferLength = settings.bufferWrites ? chunks[0] : 0;
+    if (rowBufferLength > 0)
+    {
+        rowBuffers.malloc(rowBufferLength * nChannels);
+        blockBuffer.malloc(rowBufferLength * nChannels);
+    }
+    rowBufferSamples.clearQuick();
+    rowBufferSamples.insertMultiple(0,0,nChannels);
+
 	tsData = createDataSet(I64, 0, nChannels, TIMESTAMP_CHUNK_SIZE, recordPath + "/application_data/timestamps");
 	if (!tsData.get())
 		std::cerr << "Error creating timestamps data set" << std::endl;
@@ -708,6 +775,7 @@ void KWDFile::stopRecording()
 {
     Array<uint32> samples;
     String path = String("/recordings/")+String(recordingNumber)+String("/data");
+    flushRowBuffers();
     recdata->getRowXPositions(samples);
 
     CHECK_ERROR(setAttributeArray(U32,samples.getRawDataPointer(),samples.size(),path,"valid_samples"));
@@ -735,7 +803,7 @@ void KWDFile::writeRowData(int16* data, int nSamples)
     {
         curChan=0;
     }
-    CHECK_ERROR(recdata->writeDataRow(curChan,nSamples,I16,data));
+    writeRowData(data,nSamples,curChan);
     curChan++;
 }
 
@@ -743,11 +811,72 @@ void KWDFile::writeRowData(int16* data, int nSamples, int channel)
 {
 	if (channel >= 0 && channel < nChannels)
 	{
-		CHECK_ERROR(recdata->writeDataRow(channel, nSamples, I16, data));
 		curChan = channel;
+		if (rowBufferLength > 0)
+		{
+			int& buffered = rowBufferSamples.getReference(channel);
+			if (buffered + nSamples > rowBufferLength)
+			{
+				//a chunk's worth of samples has been gathered, usually for every channel
+				flushRowBuffers();
+			}
+			if (nSamples <= rowBufferLength)
+			{
+				memcpy(rowBuffers + channel*rowBufferLength + buffered, data, nSamples*sizeof(int16));
+				buffered += nSamples;
+				return;
+			}
+		}
+		CHECK_ERROR(recdata->writeDataRow(channel, nSamples, I16, data));
 	}
 }
 
+void KWDFile::flushRowBuffers()
+{
+    if (rowBufferLength <= 0 || recdata == nullptr) return;
+
+    const int nSamples = rowBufferSamples[0];
+    bool sameLength = true;
+    for (int i = 1; i < nChannels; i++)
+    {
+        if (rowBufferSamples[i] != nSamples)
+        {
+            sameLength = false;
+            break;
+        }
+    }
+
+    int ret = -2;
+    if (sameLength)
+    {
+        if (nSamples > 0)
+        {
+            for (int i = 0; i < nSamples; i++)
+            {
+                for (int ch = 0; ch < nChannels; ch++)
+                    blockBuffer[i*nChannels + ch] = rowBuffers[ch*rowBufferLength + i];
+            }
+            ret = recdata->writeDataRows(nSamples,I16,blockBuffer);
+            CHECK_ERROR(ret && ret != -2);
+        }
+        else
+            ret = 0;
+    }
+
+    //rows that have drifted apart are written one by one
+    if (ret == -2)
+    {
+        for (int ch = 0; ch < nChannels; ch++)
+        {
+            if (rowBufferSamples[ch] > 0)
+                CHECK_ERROR(recdata->writeDataRow(ch,rowBufferSamples[ch],I16,rowBuffers + ch*rowBufferLength));
+        }
+    }
+
+    for (int ch = 0; ch < nChannels; ch++)
+        rowBufferSamples.set(ch,0);
+}
+
 void KWDFile::writeTimestamps(int64* ts, int nTs, int channel)
 {
 	if (channel >= 0 && channel < nChannels)
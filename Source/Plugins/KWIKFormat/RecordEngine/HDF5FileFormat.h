@@ -46,6 +46,19 @@ struct HDF5RecordingInfo
     bool multiSample;
 };
 
+/** Layout of the continuous data in KWD files, and how it is written. */
+struct KWDSettings
+{
+    KWDSettings();
+
+    int chunkLength;    // samples per chunk
+    int chunkChannels;  // channels per chunk, 0 for all of them
+    int deflateLevel;   // 0 leaves the data uncompressed
+    bool shuffle;       // shuffle the bytes of each chunk before deflating it
+    int cacheSizeMB;    // HDF5 chunk cache, 0 to size it from the chunk shape
+    bool bufferWrites;  // gather whole chunks of every channel before writing them
+};
+
 class HDF5FileBase
 {
 public:
@@ -80,11 +93,20 @@ protected:
     HDF5RecordingData* createDataSet(DataTypes type, int sizeX, int sizeY, int sizeZ, int chunkX, String path);
     HDF5RecordingData* createDataSet(DataTypes type, int sizeX, int sizeY, int sizeZ, int chunkX, int chunkY, String path);
 
+    //create an extendable dataset, optionally compressed
+    HDF5RecordingData* createDataSet(DataTypes type, int dimension, int* size, int* chunking, String path,
+                                     int deflateLevel = 0, bool shuffle = false);
+
     bool readyToOpen;
 
+    /** Size of the HDF5 chunk cache in bytes, or 0 to size it from the chunk shape below. */
+    size_t chunkCacheSize;
+
+    /** Chunk shape of the continuous data, in samples and in channels (0 for all of them). */
+    int chunkLength;
+    int chunkChannels;
+
 private:
-    //create an extendable dataset
-    HDF5RecordingData* createDataSet(DataTypes type, int dimension, int* size, int* chunking, String path);
     int open(bool newfile, int nChans);
     ScopedPointer<H5::H5File> file;
     bool opened;
@@ -103,6 +125,10 @@ public:
 
     int writeDataRow(int yPos, int xDataSize, HDF5FileBase::DataTypes type, void* data);
 
+    /** Appends xDataSize samples to every row of a 2d dataset in a single write.
+        The data is interleaved, and all rows must have the same length. */
+    int writeDataRows(int xDataSize, HDF5FileBase::DataTypes type, void* data);
+
     void getRowXPositions(Array<uint32>& rows);
 
 private:
@@ -123,6 +149,7 @@ public:
     KWDFile();
     virtual ~KWDFile();
     void initFile(int processorNumber, String basename);
+    void setSettings(const KWDSettings& newSettings);
     void startNewRecording(int recordingNumber, int nChannels, HDF5RecordingInfo* info);
     void stopRecording();
     void writeBlockData(int16* data, int nSamples);
@@ -135,6 +162,10 @@ protected:
     int createFileStructure();
 
 private:
+    /** Writes out the samples gathered by writeRowData(), as a single block if every
+        channel has the same number of them.*/
+    void flushRowBuffers();
+
     int recordingNumber;
     int nChannels;
     int curChan;
@@ -143,6 +174,12 @@ private:
     ScopedPointer<HDF5RecordingData> recdata;
 	ScopedPointer<HDF5RecordingData> tsData;
 
+    KWDSettings settings;
+    HeapBlock<int16> rowBuffers;
+    HeapBlock<int16> blockBuffer;
+    Array<int> rowBufferSamples;
+    int rowBufferLength;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KWDFile);
 };
 
@@ -144,6 +144,7 @@ void HDF5Recording::openFiles(File rootFolder, int experimentNumber, int recordi
     {
 		if ((!fileArray[i]->isOpen()) && (fileArray[i]->isReadyToOpen()))
 		{
+			fileArray[i]->setSettings(kwdSettings);
 			fileArray[i]->open(channelsPerProcessor[i]);
 		}
         if (fileArray[i]->isOpen())
@@ -269,8 +270,31 @@ void HDF5Recording::startAcquisition()
     spikesFile = new KWXFile();
 }
 
+void HDF5Recording::setParameter(EngineParameter& parameter)
+{
+    intParameter(0, kwdSettings.chunkLength);
+    intParameter(1, kwdSettings.chunkChannels);
+    intParameter(2, kwdSettings.deflateLevel);
+    boolParameter(3, kwdSettings.shuffle);
+    intParameter(4, kwdSettings.cacheSizeMB);
+    boolParameter(5, kwdSettings.bufferWrites);
+}
+
 RecordEngineManager* HDF5Recording::getEngineManager()
 {
     RecordEngineManager* man = new RecordEngineManager("KWIK","Kwik",&(engineFactory<HDF5Recording>));
+    EngineParameter* param;
+    param = new EngineParameter(EngineParameter::INT, 0, "Samples per chunk", 2048, 64, 65536);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 1, "Channels per chunk (0 for all)", 0, 0, 1024);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 2, "Deflate level (0 for none)", 0, 0, 9);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::BOOL, 3, "Shuffle before deflating", true);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 4, "Chunk cache size in MB (0 for automatic)", 0, 0, 1024);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::BOOL, 5, "Write whole chunks", true);
+    man->addParameter(param);
     return man;
 }
\ No newline at end of file
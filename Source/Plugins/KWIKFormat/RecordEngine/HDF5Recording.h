@@ -44,10 +44,10 @@ public:
 	void resetChannels() override;
 	void startAcquisition() override;
 	void endChannelBlock(bool lastBlock) override;
+	void setParameter(EngineParameter& parameter) override;
 
     static RecordEngineManager* getEngineManager();
 private:
-
     int processorIndex;
 
     Array<int> processorMap;
@@ -69,6 +69,8 @@ private:
 
     bool hasAcquired;
 
+    KWDSettings kwdSettings;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5Recording);
 };
 
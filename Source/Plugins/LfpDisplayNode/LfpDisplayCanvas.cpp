@@ -698,6 +698,7 @@ void LfpDisplayCanvas::updateScreenBuffer()
         float ratio = sampleRate[channel] * timebase / float(getWidth() - leftmargin - scrollBarThickness); // samples / pixel
         // this number is crucial: converting from samples to values (in px) for the screen buffer
         int valuesNeeded = (int) float(nSamples) / ratio; // N pixels needed for this update
+        int pyramidLevel = processor->getPyramidLevel(ratio); // summaries that fit within one pixel
 
         if (sbi + valuesNeeded > maxSamples)  // crop number of samples to fit canvas width
         {
@@ -729,56 +730,22 @@ void LfpDisplayCanvas::updateScreenBuffer()
                     float alpha = (float) subSampleOffset;
                     float invAlpha = 1.0f - alpha;
 
-                    screenBuffer->clear(channel, sbi, 1);
-                    screenBufferMin->clear(channel, sbi, 1);
-                    screenBufferMean->clear(channel, sbi, 1);
-                    screenBufferMax->clear(channel, sbi, 1);
-
                      dbi %= displayBufferSize; // just to be sure
 
                     // interpolate between two samples with invAlpha and alpha
-                    screenBuffer->addFrom(channel, // destChannel
-                                          sbi, // destStartSample
-                                          displayBuffer->getReadPointer(channel, dbi), // source
-                                          1, // numSamples
-                                          invAlpha*gain); // gain
-
-
-                    screenBuffer->addFrom(channel, // destChannel
-                                          sbi, // destStartSample
-                                          displayBuffer->getReadPointer(channel, nextPos), // source
-                                          1, // numSamples
-                                          alpha*gain); // gain
-
-                    // same thing again, but this time add the min,mean, and max of all samples in current pixel
-                    float sample_min   =  1000000;
-                    float sample_max   = -1000000;
-                    float sample_mean  =  0;
-                    int c = 0;
-                    int nextpix = (dbi +(int)ratio) % displayBufferSize; //  position to next pixels index
-                    
-                    for (int j = dbi; j < nextpix; j++)
-                    {
-                        float sample_current = displayBuffer->getSample(channel, j);
-                        sample_mean = sample_mean + sample_current;
-
-                        if (sample_min>sample_current)
-                        {
-                            sample_min=sample_current;
-                        }
-
-                        if (sample_max<sample_current)
-                        {
-                            sample_max=sample_current;
-                        }
-                        c++;
-
-                    }
-
-                    sample_mean = sample_mean/c;
-                    screenBufferMean->addSample(channel, sbi, sample_mean*gain);
-                    screenBufferMin->addSample(channel, sbi, sample_min*gain);
-                    screenBufferMax->addSample(channel, sbi, sample_max*gain);
+                    screenBuffer->setSample(channel, sbi,
+                                            (invAlpha*displayBuffer->getSample(channel, dbi) +
+                                             alpha*displayBuffer->getSample(channel, nextPos))*gain);
+
+                    // the min, mean, and max of all samples in current pixel, read from the
+                    // processor's pyramid so this costs the same for any timebase
+                    float sample_min, sample_mean, sample_max;
+                    processor->getSampleRange(channel, pyramidLevel, dbi, (int) ratio,
+                                              sample_min, sample_mean, sample_max);
+
+                    screenBufferMean->setSample(channel, sbi, sample_mean*gain);
+                    screenBufferMin->setSample(channel, sbi, sample_min*gain);
+                    screenBufferMax->setSample(channel, sbi, sample_max*gain);
                 
                 sbi++;
                 }
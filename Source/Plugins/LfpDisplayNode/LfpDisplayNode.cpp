@@ -93,7 +93,10 @@ void LfpDisplayNode::updateSettings()
 
 bool LfpDisplayNode::resizeBuffer()
 {
+    // keep the buffer a whole number of the coarsest pyramid values long
+    const int pyramidBlock = 1 << (LFP_PYRAMID_LEVELS * LFP_PYRAMID_BITS);
     int nSamples = (int) getSampleRate()*bufferLength;
+    nSamples = (nSamples + pyramidBlock - 1) / pyramidBlock * pyramidBlock;
     int nInputs = getNumInputs();
 
     std::cout << "Resizing buffer. Samples: " << nSamples << ", Inputs: " << nInputs << std::endl;
@@ -102,6 +105,23 @@ bool LfpDisplayNode::resizeBuffer()
     {
         abstractFifo.setTotalSize(nSamples);
         displayBuffer->setSize(nInputs + numEventChannels, nSamples); // add extra channels for TTLs
+
+        pyramidMin.clear();
+        pyramidMax.clear();
+        pyramidMean.clear();
+
+        for (int level = 1; level <= LFP_PYRAMID_LEVELS; level++)
+        {
+            const int levelSamples = nSamples >> (level * LFP_PYRAMID_BITS);
+
+            pyramidMin.add(new AudioSampleBuffer(nInputs + numEventChannels, levelSamples));
+            pyramidMax.add(new AudioSampleBuffer(nInputs + numEventChannels, levelSamples));
+            pyramidMean.add(new AudioSampleBuffer(nInputs + numEventChannels, levelSamples));
+            pyramidMin.getLast()->clear();
+            pyramidMax.getLast()->clear();
+            pyramidMean.getLast()->clear();
+        }
+
         return true;
     }
     else
@@ -134,6 +154,117 @@ bool LfpDisplayNode::disable()
     return true;
 }
 
+void LfpDisplayNode::updatePyramid(int chan, int startSample, int numSamples)
+{
+    const int bufferSize = displayBuffer->getNumSamples();
+
+    if (pyramidMin.size() == 0 || numSamples <= 0)
+        return;
+
+    numSamples = jmin(numSamples, bufferSize);
+
+    if (startSample + numSamples <= bufferSize)
+    {
+        updatePyramidSegment(chan, startSample, startSample + numSamples);
+    }
+    else
+    {
+        updatePyramidSegment(chan, startSample, bufferSize);
+        updatePyramidSegment(chan, 0, startSample + numSamples - bufferSize);
+    }
+}
+
+void LfpDisplayNode::updatePyramidSegment(int chan, int start, int end)
+{
+    const int childCount = 1 << LFP_PYRAMID_BITS;
+
+    for (int level = 1; level <= LFP_PYRAMID_LEVELS; level++)
+    {
+        const int shift = level * LFP_PYRAMID_BITS;
+        const int childShift = shift - LFP_PYRAMID_BITS;
+
+        const float* srcMin = (level == 1) ? displayBuffer->getReadPointer(chan) : pyramidMin[level - 2]->getReadPointer(chan);
+        const float* srcMax = (level == 1) ? displayBuffer->getReadPointer(chan) : pyramidMax[level - 2]->getReadPointer(chan);
+        const float* srcMean = (level == 1) ? displayBuffer->getReadPointer(chan) : pyramidMean[level - 2]->getReadPointer(chan);
+
+        float* destMin = pyramidMin[level - 1]->getWritePointer(chan);
+        float* destMax = pyramidMax[level - 1]->getWritePointer(chan);
+        float* destMean = pyramidMean[level - 1]->getWritePointer(chan);
+
+        // the last value only covers what has been written so far; the rest of it is
+        // older data, and gets included once the next block has overwritten it
+        const int lastWrittenChild = (end - 1) >> childShift;
+
+        for (int i = start >> shift; i <= (end - 1) >> shift; i++)
+        {
+            const int firstChild = i << LFP_PYRAMID_BITS;
+            const int lastChild = jmin(firstChild + childCount - 1, lastWrittenChild);
+
+            float minValue = srcMin[firstChild];
+            float maxValue = srcMax[firstChild];
+            float sum = srcMean[firstChild];
+
+            for (int c = firstChild + 1; c <= lastChild; c++)
+            {
+                minValue = jmin(minValue, srcMin[c]);
+                maxValue = jmax(maxValue, srcMax[c]);
+                sum += srcMean[c];
+            }
+
+            destMin[i] = minValue;
+            destMax[i] = maxValue;
+            destMean[i] = sum / float(lastChild - firstChild + 1);
+        }
+    }
+}
+
+int LfpDisplayNode::getPyramidLevel(float samplesPerPixel) const
+{
+    int level = 0;
+
+    while (level < pyramidMin.size() && float(1 << ((level + 1) * LFP_PYRAMID_BITS)) <= samplesPerPixel)
+        level++;
+
+    return level;
+}
+
+void LfpDisplayNode::getSampleRange(int chan, int level, int startSample, int numSamples,
+                                    float& minValue, float& meanValue, float& maxValue) const
+{
+    const int bufferSize = displayBuffer->getNumSamples();
+    const int shift = level * LFP_PYRAMID_BITS;
+
+    const float* srcMin = (level == 0) ? displayBuffer->getReadPointer(chan) : pyramidMin[level - 1]->getReadPointer(chan);
+    const float* srcMax = (level == 0) ? displayBuffer->getReadPointer(chan) : pyramidMax[level - 1]->getReadPointer(chan);
+    const float* srcMean = (level == 0) ? displayBuffer->getReadPointer(chan) : pyramidMean[level - 1]->getReadPointer(chan);
+
+    int pos = startSample % bufferSize;
+    int remaining = jlimit(1, bufferSize, numSamples);
+    float sum = 0;
+    int count = 0;
+
+    minValue = srcMin[pos >> shift];
+    maxValue = srcMax[pos >> shift];
+
+    while (remaining > 0)
+    {
+        const int end = jmin(bufferSize, pos + remaining);
+
+        for (int i = pos >> shift; i <= (end - 1) >> shift; i++)
+        {
+            minValue = jmin(minValue, srcMin[i]);
+            maxValue = jmax(maxValue, srcMax[i]);
+            sum += srcMean[i];
+            count++;
+        }
+
+        remaining -= end - pos;
+        pos = 0;
+    }
+
+    meanValue = sum / float(count);
+}
+
 void LfpDisplayNode::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
@@ -162,7 +293,7 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
         int eventSourceNodeId = *(dataptr+5);
 
-        int nSamples = numSamples.at(eventSourceNodeId);
+        int nSamples = getNumSourceSamples(eventSourceNodeId);
 
         int samplesToFill = nSamples - eventTime;
 
@@ -223,6 +354,8 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
         }
 
+        updatePyramid(channelForEventSource[eventSourceNodeId], bufferIndex, samplesToFill);
+
 
         // 	std::cout << "ttlState: " << ttlState << std::endl;
 
@@ -249,7 +382,7 @@ void LfpDisplayNode::initializeEventChannels()
 
         int samplesLeft = displayBuffer->getNumSamples() - index;
 
-        int nSamples = numSamples.at(eventSourceNodes[i]);
+        int nSamples = getNumSourceSamples(eventSourceNodes[i]);
 
 
 
@@ -289,6 +422,8 @@ void LfpDisplayNode::initializeEventChannels()
 
             displayBufferIndex.set(chan, extraSamples);
         }
+
+        updatePyramid(chan, index, nSamples);
     }   
 }
 
@@ -307,6 +442,7 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
     {
          int samplesLeft = displayBuffer->getNumSamples() - displayBufferIndex[chan];
          int nSamples = getNumSamples(chan);
+         int startIndex = displayBufferIndex[chan];
 
         if (nSamples < samplesLeft)
         {
@@ -341,6 +477,8 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
 
             displayBufferIndex.set(chan, extraSamples);
         }
+
+        updatePyramid(chan, startIndex, nSamples);
     }
 
 }
@@ -29,11 +29,19 @@
 
 class DataViewport;
 
+#define LFP_PYRAMID_LEVELS 6 // the coarsest level summarizes 4096 samples
+#define LFP_PYRAMID_BITS 2   // each level decimates the previous one by 4
+
 /**
 
   Holds data in a displayBuffer to be used by the LfpDisplayCanvas
   for rendering continuous data streams.
 
+  Alongside the displayBuffer, a pyramid of min, max and mean values is
+  updated as samples arrive. Level k holds one value for every 4^k samples
+  of the displayBuffer, so the canvas can summarize the samples behind a
+  pixel by reading a few values, whatever the timebase.
+
   @see GenericProcessor, LfpDisplayEditor, LfpDisplayCanvas
 
 */
@@ -78,6 +86,16 @@ public:
 		return &displayMutex;
 	}
 
+    /** Returns the coarsest pyramid level whose values summarize no more than
+        samplesPerPixel samples. Level 0 is the displayBuffer itself.*/
+    int getPyramidLevel(float samplesPerPixel) const;
+
+    /** Finds the min, mean and max of numSamples displayBuffer samples of a channel,
+        from startSample on, using the values of the given pyramid level. The range is
+        rounded out to whole values of that level. Call it holding the mutex. */
+    void getSampleRange(int chan, int level, int startSample, int numSamples,
+                        float& minValue, float& meanValue, float& maxValue) const;
+
 private:
 
     void initializeEventChannels();
@@ -102,6 +120,15 @@ private:
 
     bool resizeBuffer();
 
+    /** Updates the pyramid values covering numSamples samples of a channel that were
+        just written from startSample on, wrapping around the end of the displayBuffer. */
+    void updatePyramid(int chan, int startSample, int numSamples);
+    void updatePyramidSegment(int chan, int start, int end);
+
+    OwnedArray<AudioSampleBuffer> pyramidMin; // one buffer per level, from level 1
+    OwnedArray<AudioSampleBuffer> pyramidMax;
+    OwnedArray<AudioSampleBuffer> pyramidMean;
+
 	CriticalSection displayMutex;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplayNode);
@@ -164,7 +164,7 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
         int eventSourceNodeId = *(dataptr+5);
 
-        int nSamples = numSamples.at(eventSourceNodeId);
+        int nSamples = getNumSourceSamples(eventSourceNodeId);
 
         int samplesToFill = nSamples - eventTime;
 
@@ -251,7 +251,7 @@ void LfpDisplayNode::initializeEventChannels()
 
         int samplesLeft = displayBuffer->getNumSamples() - index;
 
-        int nSamples = numSamples.at(eventSourceNodes[i]);
+        int nSamples = getNumSourceSamples(eventSourceNodes[i]);
 
 
 
@@ -590,15 +590,16 @@ void BoxUnit::updateWaveform(SpikeObject* so)
 
 /***********************************************/
 
-SpikeSortBoxes::SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_,PCAcomputingThread* pth, int numch, double SamplingRate, int WaveFormLength)
+SpikeSortBoxes::SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_, int numch, double SamplingRate, int WaveFormLength)
 {
     uniqueIDgenerator = uniqueIDgenerator_;
-    computingThread = pth;
     pc1 = pc2 = nullptr;
+    unitsChanged = true;
+    compiledSamples = 0;
+    compiledSampleRate = 0;
     bufferSize = 200;
     spikeBufferIndex = -1;
     bPCAcomputed = false;
-    bPCAJobSubmitted = false;
     bPCAjobFinished = false;
     selectedUnit = -1;
     selectedBox = -1;
@@ -612,6 +613,8 @@ SpikeSortBoxes::SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_,PCAcomputin
 
     pc1 = new float[numChannels * waveformLength];
     pc2 = new float[numChannels * waveformLength];
+    pca.reset(numChannels * waveformLength);
+    waveform.resize(numChannels * waveformLength);
     for (int n = 0; n < bufferSize; n++)
     {
         SpikeObject so;
@@ -630,6 +633,8 @@ void SpikeSortBoxes::resizeWaveform(int numSamples)
     delete pc2;
     pc1 = new float[numChannels * waveformLength];
     pc2 = new float[numChannels * waveformLength];
+    pca.reset(numChannels * waveformLength);
+    waveform.resize(numChannels * waveformLength);
     spikeBuffer.clear();
     for (int n = 0; n < bufferSize; n++)
     {
@@ -638,7 +643,7 @@ void SpikeSortBoxes::resizeWaveform(int numSamples)
         spikeBuffer.add(so);
     }
     bPCAcomputed = false;
-    spikeBufferIndex = 0;
+    spikeBufferIndex = -1;
     for (int k=0; k<pcaUnits.size(); k++)
     {
         pcaUnits[k].resizeWaveform(waveformLength);
@@ -667,6 +672,7 @@ void SpikeSortBoxes::loadCustomParametersFromXml(XmlElement* electrodeNode)
 
             pcaUnits.clear();
             boxUnits.clear();
+            unitsChanged = true;
 
             forEachXmlChildElement(*spikesortNode, UnitNode)
             {
@@ -688,6 +694,7 @@ void SpikeSortBoxes::loadCustomParametersFromXml(XmlElement* electrodeNode)
 
                     pc1 = new float[waveformLength*numChannels];
                     pc2 = new float[waveformLength*numChannels];
+                    std::vector<float> mean(waveformLength*numChannels, 0.0f);
                     int dimcounter = 0;
                     forEachXmlChildElement(*UnitNode, dimNode)
                     {
@@ -695,9 +702,20 @@ void SpikeSortBoxes::loadCustomParametersFromXml(XmlElement* electrodeNode)
                         {
                             pc1[dimcounter]=dimNode->getDoubleAttribute("pc1");
                             pc2[dimcounter]=dimNode->getDoubleAttribute("pc2");
+                            mean[dimcounter]=dimNode->getDoubleAttribute("mean");
                             dimcounter++;
                         }
                     }
+
+                    // continue from the saved estimate, weighted as the spikes it
+                    // came from (settings saved without a count weigh as a full buffer)
+                    pca.reset(waveformLength*numChannels);
+                    waveform.resize(waveformLength*numChannels);
+                    if (bPCAcomputed)
+                        pca.setState(&mean[0], pc1, pc2,
+                                     UnitNode->getDoubleAttribute("eigenvalue1"),
+                                     UnitNode->getDoubleAttribute("eigenvalue2"),
+                                     UnitNode->getIntAttribute("numSamples", bufferSize));
                 }
 
                 if (UnitNode->hasTagName("BOXUNIT"))
@@ -778,12 +796,19 @@ void SpikeSortBoxes::saveCustomParametersToXml(XmlElement* electrodeNode)
 
     pcaNode->setAttribute("PCAjobFinished", bPCAjobFinished);
     pcaNode->setAttribute("PCAcomputed", bPCAcomputed);
+    pcaNode->setAttribute("numSamples", pca.getNumSamples());
+    pcaNode->setAttribute("eigenvalue1", pca.getEigenvalue(0));
+    pcaNode->setAttribute("eigenvalue2", pca.getEigenvalue(1));
+
+    std::vector<float> mean(numChannels*waveformLength);
+    pca.getMean(&mean[0]);
 
     for (int k=0; k<numChannels*waveformLength; k++)
     {
         XmlElement* dimNode = pcaNode->createNewChildElement("PCA_DIM");
         dimNode->setAttribute("pc1",pc1[k]);
         dimNode->setAttribute("pc2",pc2[k]);
+        dimNode->setAttribute("mean",mean[k]);
     }
 
     for (int boxUnitIter=0; boxUnitIter<boxUnits.size(); boxUnitIter++)
@@ -855,42 +880,71 @@ void SpikeSortBoxes::getSelectedUnitAndBox(int& unitID, int& boxid)
 
 void SpikeSortBoxes::projectOnPrincipalComponents(SpikeObject* so)
 {
-    SpikeObject copySpike = *so;
     spikeBufferIndex++;
     spikeBufferIndex %= bufferSize;
-    spikeBuffer.set(spikeBufferIndex, copySpike);
-    if (bPCAjobFinished)
+    spikeBuffer.set(spikeBufferIndex, *so);
+
+    const int dim = so->nChannels * so->nSamples;
+
+    if (dim != int(waveform.size()))
+        return;
+
+    for (int k = 0; k < dim; k++)
+        waveform[k] = spikeDataIndexToMicrovolts(so, k);
+
+    pca.update(&waveform[0]);
+    pca.getComponents(pc1, pc2);
+
+    // the display range is set once the buffer is full of spikes
+    if ((!bPCAcomputed && pca.getNumSamples() >= bufferSize) || bRePCA)
     {
-        bPCAcomputed = true;
+        if (pca.getNumSamples() >= bufferSize)
+        {
+            bRePCA = false;
+            updatePCArange();
+            bPCAcomputed = true;
+            bPCAjobFinished = true;
+        }
     }
 
     if (bPCAcomputed)
     {
         so->pcProj[0] = so->pcProj[1] = 0;
-        for (int k=0; k<so->nChannels*so->nSamples; k++)
-        {
-            float v = spikeDataIndexToMicrovolts(so, k);
-            so->pcProj[0] += pc1[k]* v;
-            so->pcProj[1] += pc2[k]* v;
-        }
-        if (so->pcProj[0] > 1e5 || so->pcProj[0] < -1e5 || so->pcProj[1] > 1e5 || so->pcProj[1] < -1e5)
+        for (int k = 0; k < dim; k++)
         {
-            //int dbg = 1;
+            so->pcProj[0] += pc1[k] * waveform[k];
+            so->pcProj[1] += pc2[k] * waveform[k];
         }
     }
-    else
+}
+
+void SpikeSortBoxes::updatePCArange()
+{
+    // project the buffered spikes to find the display range
+    float min1 = 1e10, min2 = 1e10, max1 = -1e10, max2 = -1e10;
+
+    for (int j = 0; j < spikeBuffer.size(); j++)
     {
-        // add a spike object to the buffer.
-        // if we have enough spikes, start the PCA computation thread.
-        if ((spikeBufferIndex == bufferSize -1 && !bPCAcomputed && !bPCAJobSubmitted) || bRePCA)
+        SpikeObject& spike = spikeBuffer.getReference(j);
+        float sum1 = 0, sum2 = 0;
+
+        for (int k = 0; k < spike.nChannels * spike.nSamples; k++)
         {
-            bPCAJobSubmitted = true;
-            bRePCA = false;
-            // submit a new job to compute the spike buffer.
-            PCAjob job(spikeBuffer,pc1,pc2, &pc1min, &pc2min, &pc1max, &pc2max, &bPCAjobFinished);
-            computingThread->addPCAjob(job);
+            const float v = spikeDataIndexToMicrovolts(&spike, k);
+            sum1 += v * pc1[k];
+            sum2 += v * pc2[k];
         }
+
+        min1 = jmin(min1, sum1);
+        min2 = jmin(min2, sum2);
+        max1 = jmax(max1, sum1);
+        max2 = jmax(max2, sum2);
     }
+
+    pc1min = min1 - 1.5 * (max1-min1);
+    pc2min = min2 - 1.5 * (max2-min2);
+    pc1max = max1 + 1.5 * (max1-min1);
+    pc2max = max2 + 1.5 * (max2-min2);
 }
 
 void SpikeSortBoxes::getPCArange(float& p1min,float& p2min, float& p1max,  float& p2max)
@@ -921,14 +975,14 @@ bool SpikeSortBoxes::isPCAfinished()
 }
 void SpikeSortBoxes::RePCA()
 {
-    bPCAcomputed = false;
-    bPCAJobSubmitted = false;
+    // the components are always up to date, so only the range is refitted
     bRePCA = true;
 }
 
 void SpikeSortBoxes::addPCAunit(PCAUnit unit)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     //StartCriticalSection();
     pcaUnits.push_back(unit);
     //EndCriticalSection();
@@ -939,6 +993,7 @@ void SpikeSortBoxes::addPCAunit(PCAUnit unit)
 int SpikeSortBoxes::addBoxUnit(int channel)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     //StartCriticalSection();
     int unusedID = uniqueIDgenerator->generateUniqueID(); //generateUnitID();
     BoxUnit unit(unusedID, generateLocalID());
@@ -961,6 +1016,7 @@ void  SpikeSortBoxes::EndCriticalSection()
 int SpikeSortBoxes::addBoxUnit(int channel, Box B)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     //StartCriticalSection();
     int unusedID = uniqueIDgenerator->generateUniqueID(); //generateUnitID();
     BoxUnit unit(B, unusedID,generateLocalID());
@@ -1052,6 +1108,7 @@ void SpikeSortBoxes::generateNewIDs()
 void SpikeSortBoxes::removeAllUnits()
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     boxUnits.clear();
     pcaUnits.clear();
 }
@@ -1059,6 +1116,7 @@ void SpikeSortBoxes::removeAllUnits()
 bool SpikeSortBoxes::removeUnit(int unitID)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     //StartCriticalSection();
     for (int k=0; k<boxUnits.size(); k++)
     {
@@ -1088,6 +1146,7 @@ bool SpikeSortBoxes::removeUnit(int unitID)
 bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
 
     //StartCriticalSection();
 
@@ -1113,6 +1172,7 @@ bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID)
 bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID, Box B)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     //StartCriticalSection();
     for (int k=0; k<boxUnits.size(); k++)
     {
@@ -1150,6 +1210,7 @@ void SpikeSortBoxes::updatePCAUnits(std::vector<PCAUnit> _units)
 {
     //StartCriticalSection();
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     pcaUnits = _units;
     //EndCriticalSection();
 }
@@ -1157,6 +1218,7 @@ void SpikeSortBoxes::updatePCAUnits(std::vector<PCAUnit> _units)
 void SpikeSortBoxes::updateBoxUnits(std::vector<BoxUnit> _units)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     //StartCriticalSection();
     boxUnits = _units;
     //EndCriticalSection();
@@ -1167,73 +1229,258 @@ void SpikeSortBoxes::updateBoxUnits(std::vector<BoxUnit> _units)
 
 // tests whether a candidate spike belongs to one of the defined units
 bool SpikeSortBoxes::sortSpike(SpikeObject* so, bool PCAfirst)
+{
+    sortSpikes(&so, 1, PCAfirst);
+
+    return so->sortedId != 0;
+}
+
+void SpikeSortBoxes::sortSpikes(SpikeObject** spikes, int numSpikes, bool PCAfirst)
 {
     const ScopedLock myScopedLock(mut);
-    if (PCAfirst)
+
+    for (int i = 0; i < numSpikes; i++)
     {
+        SpikeObject* so = spikes[i];
+
+        // the tables only change with the units, or with the waveform layout
+        if (unitsChanged || so->nSamples != compiledSamples
+            || so->samplingFrequencyHz != compiledSampleRate)
+            compileUnits(so);
+
+        channelMicrovolts.resize(so->nChannels * so->nSamples);
+        channelConverted.assign(so->nChannels, false);
 
-        for (int k=0; k<pcaUnits.size(); k++)
+        if (PCAfirst)
         {
-            if (pcaUnits[k].isWaveFormInsidePolygon(so))
-            {
-                so->sortedId = pcaUnits[k].getUnitID();
-                so->color[0] = pcaUnits[k].ColorRGB[0];
-                so->color[1] = pcaUnits[k].ColorRGB[1];
-                so->color[2] = pcaUnits[k].ColorRGB[2];
-                return true;
-            }
+            if (!sortByPolygons(so, false))
+                sortByBoxes(so);
+        }
+        else
+        {
+            if (!sortByBoxes(so))
+                sortByPolygons(so, true);
         }
+    }
+}
+
+void SpikeSortBoxes::compileUnits(const SpikeObject* so)
+{
+    SpikeObject* s = const_cast<SpikeObject*>(so);
 
-        for (int k=0; k<boxUnits.size(); k++)
+    unitsChanged = false;
+    compiledSamples = so->nSamples;
+    compiledSampleRate = so->samplingFrequencyHz;
+
+    binTimes.resize(so->nSamples);
+    for (int pt = 0; pt < so->nSamples; pt++)
+        binTimes[pt] = spikeTimeBinToMicrosecond(s, pt);
+
+    compiledBoxes.clear();
+    compiledBoxUnits.clear();
+
+    const int numBoxUnits = int(boxUnits.size());
+    for (int k = 0; k < numBoxUnits; k++)
+    {
+        CompiledUnit unit;
+        unit.unitIndex = k;
+        unit.first = int(compiledBoxes.size());
+        unit.count = int(boxUnits[k].lstBoxes.size());
+        unit.minX = unit.maxX = unit.minY = unit.maxY = 0;
+
+        for (int j = 0; j < unit.count; j++)
         {
-            if (boxUnits[k].isWaveFormInsideAllBoxes(so))
-            {
-                so->sortedId = boxUnits[k].getUnitID();
-                so->color[0] = boxUnits[k].ColorRGB[0];
-                so->color[1] = boxUnits[k].ColorRGB[1];
-                so->color[2] = boxUnits[k].ColorRGB[2];
-                boxUnits[k].updateWaveform(so);
-                return true;
-            }
+            const Box& box = boxUnits[k].lstBoxes[j];
+
+            CompiledBox b;
+            b.channel = box.channel;
+            b.firstBin = microSecondsToSpikeTimeBin(s, box.x);
+            b.lastBin = microSecondsToSpikeTimeBin(s, box.x + box.w);
+            b.top = box.y;
+            b.bottom = box.y - box.h;
+            b.topLeft = PointD(box.x, box.y);
+            b.bottomLeft = PointD(box.x, box.y - box.h);
+            b.topRight = PointD(box.x + box.w, box.y);
+            b.bottomRight = PointD(box.x + box.w, box.y - box.h);
+            compiledBoxes.push_back(b);
         }
+
+        // a unit needs all of its boxes, so their order is free: by sample
+        // index, the waveform is read from front to back
+        std::sort(compiledBoxes.begin() + unit.first, compiledBoxes.end(), compareBoxBins);
+
+        compiledBoxUnits.push_back(unit);
     }
-    else
+
+    compiledEdges.clear();
+    compiledPCAUnits.clear();
+
+    const int numPCAUnits = int(pcaUnits.size());
+    for (int k = 0; k < numPCAUnits; k++)
     {
+        const cPolygon& poly = pcaUnits[k].poly;
 
-        for (int k=0; k<boxUnits.size(); k++)
+        CompiledUnit unit;
+        unit.unitIndex = k;
+        unit.first = int(compiledEdges.size());
+        unit.count = poly.pts.size() < 3 ? 0 : int(poly.pts.size());
+        unit.minX = unit.minY = 1e30f;
+        unit.maxX = unit.maxY = -1e30f;
+
+        for (int i = 0; i < unit.count; i++)
         {
-            if (boxUnits[k].isWaveFormInsideAllBoxes(so))
-            {
-                so->sortedId = boxUnits[k].getUnitID();
-                so->color[0] = boxUnits[k].ColorRGB[0];
-                so->color[1] = boxUnits[k].ColorRGB[1];
-                so->color[2] = boxUnits[k].ColorRGB[2];
-                boxUnits[k].updateWaveform(so);
-                return true;
-            }
+            const PointD& oldPt = poly.pts[i == 0 ? unit.count - 1 : i - 1];
+            PointD oldPoint(oldPt.X + poly.offset.X, oldPt.Y + poly.offset.Y);
+            PointD newPoint(poly.pts[i].X + poly.offset.X, poly.pts[i].Y + poly.offset.Y);
+
+            CompiledEdge edge;
+            edge.newX = newPoint.X;
+            edge.oldX = oldPoint.X;
+            edge.p1 = newPoint.X > oldPoint.X ? oldPoint : newPoint;
+            edge.p2 = newPoint.X > oldPoint.X ? newPoint : oldPoint;
+            compiledEdges.push_back(edge);
+
+            unit.minX = jmin(unit.minX, newPoint.X);
+            unit.maxX = jmax(unit.maxX, newPoint.X);
+            unit.minY = jmin(unit.minY, newPoint.Y);
+            unit.maxY = jmax(unit.maxY, newPoint.Y);
         }
-        for (int k=0; k<pcaUnits.size(); k++)
+
+        compiledPCAUnits.push_back(unit);
+    }
+}
+
+bool SpikeSortBoxes::compareBoxBins(const CompiledBox& a, const CompiledBox& b)
+{
+    if (a.firstBin != b.firstBin)
+        return a.firstBin < b.firstBin;
+
+    return a.lastBin < b.lastBin;
+}
+
+bool SpikeSortBoxes::sortByBoxes(SpikeObject* so)
+{
+    const int numUnits = int(compiledBoxUnits.size());
+    for (int k = 0; k < numUnits; k++)
+    {
+        const CompiledUnit& unit = compiledBoxUnits[k];
+
+        if (unit.count == 0)
+            continue;
+
+        bool inside = true;
+        for (int j = 0; j < unit.count && inside; j++)
+            inside = isWaveformInsideBox(compiledBoxes[unit.first + j], so);
+
+        if (inside)
         {
-            if (pcaUnits[k].isWaveFormInsidePolygon(so))
-            {
-                so->sortedId = pcaUnits[k].getUnitID();
-                so->color[0] = pcaUnits[k].ColorRGB[0];
-                so->color[1] = pcaUnits[k].ColorRGB[1];
-                so->color[2] = pcaUnits[k].ColorRGB[2];
-                pcaUnits[k].updateWaveform(so);
-                return true;
-            }
+            BoxUnit& boxUnit = boxUnits[unit.unitIndex];
+            so->sortedId = boxUnit.getUnitID();
+            so->color[0] = boxUnit.ColorRGB[0];
+            so->color[1] = boxUnit.ColorRGB[1];
+            so->color[2] = boxUnit.ColorRGB[2];
+            boxUnit.updateWaveform(so);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SpikeSortBoxes::sortByPolygons(SpikeObject* so, bool updateWaveform)
+{
+    const int numUnits = int(compiledPCAUnits.size());
+    for (int k = 0; k < numUnits; k++)
+    {
+        const CompiledUnit& unit = compiledPCAUnits[k];
+
+        if (isPointInsidePolygon(unit, so->pcProj[0], so->pcProj[1]))
+        {
+            PCAUnit& pcaUnit = pcaUnits[unit.unitIndex];
+            so->sortedId = pcaUnit.getUnitID();
+            so->color[0] = pcaUnit.ColorRGB[0];
+            so->color[1] = pcaUnit.ColorRGB[1];
+            so->color[2] = pcaUnit.ColorRGB[2];
+            if (updateWaveform)
+                pcaUnit.updateWaveform(so);
+            return true;
         }
+    }
+
+    return false;
+}
+
+bool SpikeSortBoxes::isWaveformInsideBox(const CompiledBox& b, SpikeObject* so)
+{
+    const float* v = getChannelMicrovolts(so, b.channel);
+
+    if (v == nullptr)
+        return false;
 
+    for (int pt = b.firstBin; pt < b.lastBin; pt++)
+    {
+        // a segment entirely above or below the box cannot cross its edges
+        if ((v[pt] > b.top && v[pt+1] > b.top) || (v[pt] < b.bottom && v[pt+1] < b.bottom))
+            continue;
+
+        PointD Pwave1(binTimes[pt], v[pt]);
+        PointD Pwave2(binTimes[pt+1], v[pt+1]);
+
+        if (Box::LineSegmentIntersection(Pwave1, Pwave2, b.topLeft, b.bottomLeft)
+            || Box::LineSegmentIntersection(Pwave1, Pwave2, b.topRight, b.bottomRight)
+            || Box::LineSegmentIntersection(Pwave1, Pwave2, b.topLeft, b.topRight)
+            || Box::LineSegmentIntersection(Pwave1, Pwave2, b.bottomLeft, b.bottomRight))
+            return true;
     }
 
     return false;
 }
 
+bool SpikeSortBoxes::isPointInsidePolygon(const CompiledUnit& unit, float x, float y) const
+{
+    if (unit.count == 0 || x < unit.minX || x > unit.maxX || y < unit.minY || y > unit.maxY)
+        return false;
+
+    bool inside = false;
+
+    for (int i = unit.first; i < unit.first + unit.count; i++)
+    {
+        const CompiledEdge& e = compiledEdges[i];
+
+        if ((e.newX < x) == (x <= e.oldX)
+            && ((y - e.p1.Y) * (e.p2.X - e.p1.X) < (e.p2.Y - e.p1.Y) * (x - e.p1.X)))
+        {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+const float* SpikeSortBoxes::getChannelMicrovolts(SpikeObject* so, int channel)
+{
+    if (channel < 0 || channel >= so->nChannels)
+        return nullptr;
+
+    float* v = &channelMicrovolts[channel * so->nSamples];
+
+    // each channel is converted once per spike, however many boxes use it
+    if (!channelConverted[channel])
+    {
+        for (int pt = 0; pt < so->nSamples; pt++)
+            v[pt] = spikeDataBinToMicrovolts(so, pt, channel);
+
+        channelConverted[channel] = true;
+    }
+
+    return v;
+}
+
 
 bool  SpikeSortBoxes::removeBoxFromUnit(int unitID, int boxIndex)
 {
     const ScopedLock myScopedLock(mut);
+    unitsChanged = true;
     //StartCriticalSection();
     for (int k=0; k<boxUnits.size(); k++)
     {
@@ -1692,487 +1939,142 @@ void PCAUnit::updateWaveform(SpikeObject* so)
 /***************************/
 
 
-/*
-  An implementation of SVD from Numerical Recipes in C and Mike Erhdmann's lectures
-*/
-
-
-#define SIGN(a,b) ((b) > 0.0 ? fabs(a) : - fabs(a))
-
-static double maxarg1,maxarg2;
-#define FMAX(a,b) (maxarg1 = (a),maxarg2 = (b),(maxarg1) > (maxarg2) ? (maxarg1) : (maxarg2))
+// the sample count stops growing here, so older spikes are gradually forgotten
+#define PCA_MAX_SAMPLES 2000
+// extra weight of new spikes, once enough have been seen
+#define PCA_AMNESIA 2.0f
+#define PCA_AMNESIA_START 20
 
-static int iminarg1,iminarg2;
-#define IMIN(a,b) (iminarg1 = (a),iminarg2 = (b),(iminarg1 < (iminarg2) ? (iminarg1) : iminarg2))
-
-static double sqrarg;
-#define SQR(a) ((sqrarg = (a)) == 0.0 ? 0.0 : sqrarg * sqrarg)
-
-PCAjob::PCAjob(Array<SpikeObject> _spikes, float* _pc1, float* _pc2,
-               float* pc1Min, float* pc2Min, float* pc1Max, float* pc2Max, bool* _reportDone) : spikes(_spikes), reportDone(_reportDone)
-{
-    cov = nullptr;
-    pc1 = _pc1;
-    pc2 = _pc2;
-    pc1min = pc1Min;
-    pc2min = pc2Min;
-    pc1max = pc1Max;
-    pc2max = pc2Max;
-    dim = spikes[0].nChannels*spikes[0].nSamples;
-
-};
-
-PCAjob::~PCAjob()
+IncrementalPCA::IncrementalPCA() : dim(0), numSamples(0)
 {
-
 }
 
-
-
-// calculates sqrt( a^2 + b^2 ) with decent precision
-float PCAjob::pythag(float a, float b)
+void IncrementalPCA::reset(int dim_)
 {
-    float absa,absb;
-
-    absa = fabs(a);
-    absb = fabs(b);
+    dim = dim_;
+    numSamples = 0;
 
-    if (absa > absb)
-        return (absa * sqrt(1.0 + SQR(absb/absa)));
-    else
-        return (absb == 0.0 ? 0.0 : absb * sqrt(1.0 + SQR(absa / absb)));
+    mean.assign(dim, 0.0f);
+    residual.assign(dim, 0.0f);
+    components[0].assign(dim, 0.0f);
+    components[1].assign(dim, 0.0f);
 }
 
-/*
-  Modified from Numerical Recipes in C
-  Given a matrix a[nRows][nCols], svdcmp() computes its singular value
-  decomposition, A = U * W * Vt.  A is replaced by U when svdcmp
-  returns.  The diagonal matrix W is output as a vector w[nCols].
-  V (not V transpose) is output as the matrix V[nCols][nCols].
-*/
-int PCAjob::svdcmp(float** a, int nRows, int nCols, float* w, float** v)
+void IncrementalPCA::update(const float* waveform)
 {
+    if (numSamples < PCA_MAX_SAMPLES)
+        numSamples++;
 
-    int flag, i, its, j, jj, k, l = 0, nm = 0;
-    float anorm, c, f, g, h, s, scale, x, y, z, *rv1;
+    const float n = float(numSamples);
+    const float l = numSamples > PCA_AMNESIA_START ? PCA_AMNESIA : 0.0f;
+    const float oldWeight = (n - 1.0f - l) / n;
+    const float newWeight = (1.0f + l) / n;
 
-    rv1 = new float[nCols];
-    if (rv1 == NULL)
+    // centre on the mean of the previous spikes, then update it
+    for (int k = 0; k < dim; k++)
     {
-        printf("svdcmp(): Unable to allocate vector\n");
-        return (-1);
+        residual[k] = waveform[k] - mean[k];
+        mean[k] += residual[k] / n;
     }
 
-    g = scale = anorm = 0.0;
-    for (i = 0; i < nCols; i++)
+    for (int c = 0; c < 2; c++)
     {
-        l = i+1;
-        rv1[i] = scale*g;
-        g = s = scale = 0.0;
-        if (i < nRows)
-        {
-            for (k = i; k < nRows; k++)
-            {
-                //std::cout << k << " " << i << std::endl;
-                scale += fabs(a[k][i]);
-            }
-
-            if (scale)
-            {
-                for (k = i; k < nRows; k++)
-                {
-                    a[k][i] /= scale;
-                    s += a[k][i] * a[k][i];
-                }
-                f = a[i][i];
-                g = -SIGN(sqrt(s),f);
-                h = f * g - s;
-                a[i][i] = f - g;
-
-                for (j = l; j < nCols; j++)
-                {
-                    for (s = 0.0, k = i; k < nRows; k++) s += a[k][i] * a[k][j];
-                    f = s / h;
-                    for (k = i; k < nRows; k++) a[k][j] += f * a[k][i];
-                }
+        float* v = &components[c][0];
+        float* u = &residual[0];
 
-                for (k = i; k < nRows; k++)
-                    a[k][i] *= scale;
-            } // end if (scale)
-        } // end if (i < nRows)
-        w[i] = scale * g;
-        g = s = scale = 0.0;
-        if (i < nRows && i != nCols-1)
+        float norm = 0, dot = 0;
+        for (int k = 0; k < dim; k++)
         {
-            for (k = l; k < nCols; k++) scale += fabs(a[i][k]);
-            if (scale)
-            {
-                for (k = l; k < nCols; k++)
-                {
-                    a[i][k] /= scale;
-                    s += a[i][k] * a[i][k];
-                }
-                f = a[i][l];
-                g = - SIGN(sqrt(s),f);
-                h = f * g - s;
-                a[i][l] = f - g;
-                for (k=l; k<nCols; k++) rv1[k] = a[i][k] / h;
-                for (j=l; j<nRows; j++)
-                {
-                    for (s=0.0,k=l; k<nCols; k++) s += a[j][k] * a[i][k];
-                    for (k=l; k<nCols; k++) a[j][k] += s * rv1[k];
-                }
-                for (k=l; k<nCols; k++) a[i][k] *= scale;
-            }
+            norm += v[k] * v[k];
+            dot += u[k] * v[k];
         }
-        anorm = FMAX(anorm, (fabs(w[i]) + fabs(rv1[i])));
+        norm = sqrtf(norm);
 
-
-    }
-
-    for (i=nCols-1; i>=0; i--)
-    {
-        if (i < nCols-1)
+        if (norm == 0)
         {
-            if (g)
-            {
-                for (j=l; j<nCols; j++)
-                    v[j][i] = (a[i][j] / a[i][l]) / g;
-                for (j=l; j<nCols; j++)
-                {
-                    for (s=0.0,k=l; k<nCols; k++) s += a[i][k] * v[k][j];
-                    for (k=l; k<nCols; k++) v[k][j] += s * v[k][i];
-                }
-            }
-            for (j=l; j<nCols; j++) v[i][j] = v[j][i] = 0.0;
-        }
-        v[i][i] = 1.0;
-        g = rv1[i];
-        l = i;
-    }
-
-    for (i=IMIN(nRows,nCols) - 1; i >= 0; i--)
-    {
-        l = i + 1;
-        g = w[i];
-        for (j=l; j<nCols; j++) a[i][j] = 0.0;
-        if (g)
-        {
-            g = 1.0 / g;
-            for (j=l; j<nCols; j++)
-            {
-                for (s=0.0,k=l; k<nRows; k++) s += a[k][i] * a[k][j];
-                f = (s / a[i][i]) * g;
-                for (k=i; k<nRows; k++) a[k][j] += f * a[k][i];
-            }
-            for (j=i; j<nRows; j++) a[j][i] *= g;
+            for (int k = 0; k < dim; k++)
+                v[k] = u[k];
         }
         else
-            for (j=i; j<nRows; j++) a[j][i] = 0.0;
-        ++a[i][i];
-    }
-
-    for (k=nCols-1; k>=0; k--)
-    {
-        for (its=0; its<30; its++)
         {
-            flag = 1;
-            for (l=k; l>=0; l--)
-            {
-                nm = l-1;
-                if ((fabs(rv1[l]) + anorm) == anorm)
-                {
-                    flag =  0;
-                    break;
-                }
-                if ((fabs(w[nm]) + anorm) == anorm) break;
-            }
-            if (flag)
-            {
-                c = 0.0;
-                s = 1.0;
-                for (i=l; i<=k; i++)
-                {
-                    f = s * rv1[i];
-                    rv1[i] = c * rv1[i];
-                    if ((fabs(f) + anorm) == anorm) break;
-                    g = w[i];
-                    h = pythag(f,g);
-                    w[i] = h;
-                    h = 1.0 / h;
-                    c = g * h;
-                    s = -f * h;
-                    for (j=0; j<nRows; j++)
-                    {
-                        y = a[j][nm];
-                        z = a[j][i];
-                        a[j][nm] = y * c + z * s;
-                        a[j][i] = z * c - y * s;
-                    }
-                }
-            }
-            z = w[k];
-            if (l == k)
-            {
-                if (z < 0.0)
-                {
-                    w[k] = -z;
-                    for (j=0; j<nCols; j++) v[j][k] = -v[j][k];
-                }
-                break;
-            }
-            //if(its == 29) printf("no convergence in 30 svdcmp iterations\n");
-            x = w[l];
-            nm = k-1;
-            y = w[nm];
-            g = rv1[nm];
-            h = rv1[k];
-            f = ((y - z) * (y + z) + (g - h) * (g + h)) / (2.0 * h * y);
-            g = pythag(f,1.0);
-            f = ((x - z) * (x + z) + h * ((y / (f + SIGN(g,f))) - h)) / x;
-            c = s = 1.0;
-            for (j=l; j<=nm; j++)
-            {
-                i = j+1;
-                g = rv1[i];
-                y = w[i];
-                h = s * g;
-                g = c * g;
-                z = pythag(f,h);
-                rv1[j] = z;
-                c = f/z;
-                s = h/z;
-                f = x * c + g * s;
-                g = g * c - x * s;
-                h = y * s;
-                y *= c;
-                for (jj=0; jj<nCols; jj++)
-                {
-                    x = v[jj][j];
-                    z = v[jj][i];
-                    v[jj][j] = x * c + z * s;
-                    v[jj][i] = z * c - x * s;
-                }
-                z = pythag(f,h);
-                w[j] = z;
-                if (z)
-                {
-                    z = 1.0 / z;
-                    c = f * z;
-                    s = h * z;
-                }
-                f = c * g + s * y;
-                x = c * y - s * g;
-                for (jj=0; jj < nRows; jj++)
-                {
-                    y = a[jj][j];
-                    z = a[jj][i];
-                    a[jj][j] = y * c + z * s;
-                    a[jj][i] = z * c - y * s;
-                }
-            }
-            rv1[l] = 0.0;
-            rv1[k] = f;
-            w[k] = x;
+            const float projection = newWeight * dot / norm;
+            for (int k = 0; k < dim; k++)
+                v[k] = oldWeight * v[k] + projection * u[k];
         }
-    }
-
-    delete rv1;
 
-    return (0);
-}
-
-
-void PCAjob::computeCov()
-{
-    // allocate and zero
-    cov = new float*[dim];
-    float* mean  = new float[dim];
-    for (int k = 0; k < dim; k++)
-    {
-        cov[k] = new float[dim];
-        for (int j=0; j<dim; j++)
-        {
-            cov[k][j] = 0;
-        }
-    }
-    // compute mean
+        if (c == 1)
+            break;
 
-    for (int j=0; j<dim; j++)
-    {
-        mean[j] = 0;
-        for (int i=0; i<spikes.size(); i++)
+        // remove the first component from the residual
+        norm = dot = 0;
+        for (int k = 0; k < dim; k++)
         {
-            SpikeObject spike = spikes[i];
-            float v = spikeDataIndexToMicrovolts(&spike, j) ;
-            mean[j] += v / dim;
+            norm += v[k] * v[k];
+            dot += u[k] * v[k];
         }
-    }
-    // aggregate
 
-
-    for (int i=0; i<dim; i++)
-    {
-        for (int j=i; j<dim; j++)
+        if (norm > 0)
         {
-            // cov[i][j] = sum_k[ (X(i,:)) * (Xj-mue(j) ]
-            float sum = 0 ;
-            for (int k=0; k<spikes.size(); k++)
-            {
-
-                SpikeObject spike = spikes[k];
-                float vi = spikeDataIndexToMicrovolts(&spike, i);
-                float vj = spikeDataIndexToMicrovolts(&spike, j);
-                sum += (vi-mean[i]) * (vj-mean[j]);
-            }
-            cov[i][j] = sum / (dim-1);
-            cov[j][i] = sum / (dim-1);
+            const float scale = dot / norm;
+            for (int k = 0; k < dim; k++)
+                u[k] -= scale * v[k];
         }
     }
-    delete[] mean;
-
-    // delete covariances
-    //for (int k = 0; k < dim; k++)
-    //delete cov[k];
-
-    //delete(cov);
-    //cov = nullptr;
-
 }
 
-std::vector<int> sort_indexes(std::vector<float> v)
+void IncrementalPCA::setState(const float* mean_, const float* pc1, const float* pc2,
+                              float eigenvalue1, float eigenvalue2, int numSamples_)
 {
-    // initialize original index locations
-    std::vector<int> idx(v.size());
+    numSamples = jlimit(1, PCA_MAX_SAMPLES, numSamples_);
 
-    for (int i = 0; i != idx.size(); ++i)
-    {
-        idx[i] = i;
-    }
-
-    //sort indexes based on comparing values in v
-    sort(
-        idx.begin(),
-        idx.end()//,
-        //[&v](size_t i1, size_t i2)
-        //{
-        //	return v[i1] > v[i2];
-        //}
-    );
-
-    return idx;
-}
+    // the components carry their eigenvalues as their norms
+    const float scale1 = eigenvalue1 > 0 ? eigenvalue1 : 1.0f;
+    const float scale2 = eigenvalue2 > 0 ? eigenvalue2 : 1.0f;
 
-void PCAjob::computeSVD()
-{
-
-
-    float** eigvec, *sigvalues;
-    sigvalues = new float[dim];
-
-    eigvec = new float*[dim];
     for (int k = 0; k < dim; k++)
     {
-        eigvec[k] = new float[dim];
-        for (int j=0; j<dim; j++)
-        {
-            eigvec[k][j] = 0;
-        }
+        mean[k] = mean_[k];
+        components[0][k] = pc1[k] * scale1;
+        components[1][k] = pc2[k] * scale2;
     }
+}
 
-    svdcmp(cov, dim, dim, sigvalues, eigvec);
-
-    std::vector<float> sig;
-    sig.resize(dim);
-    for (int k = 0; k < dim; k++)
-        sig[k] = sigvalues[k];
-
-    std::vector<int> sortind = sort_indexes(sig);
+void IncrementalPCA::getComponents(float* pc1, float* pc2) const
+{
+    float* pcs[2] = { pc1, pc2 };
 
-    for (int k = 0; k < dim; k++)
+    for (int c = 0; c < 2; c++)
     {
-        pc1[k] = eigvec[k][sortind[0]];
-        pc2[k] = eigvec[k][sortind[1]];
-    }
-    // project samples to find the display range
-    float min1 = 1e10, min2 = 1e10, max1 = -1e10, max2 = -1e10;
+        const float* v = &components[c][0];
 
-    for (int j = 0; j < spikes.size(); j++)
-    {
-        float sum1 = 0, sum2=0;
+        float norm = 0;
         for (int k = 0; k < dim; k++)
-        {
-            SpikeObject spike = spikes[j];
-            sum1 += spikeDataIndexToMicrovolts(&spike,k) * pc1[k];
-            sum2 += spikeDataIndexToMicrovolts(&spike,k) * pc2[k];
-        }
-        if (sum1 < min1)
-            min1 = sum1;
-        if (sum2 < min2)
-            min2 = sum2;
-        if (sum1 > max1)
-            max1 = sum1;
-        if (sum2 > max2)
-            max2 = sum2;
-    }
-
+            norm += v[k] * v[k];
 
-    *pc1min = min1 - 1.5 * (max1-min1);
-    *pc2min = min2 - 1.5 * (max2-min2);
-    *pc1max = max1 + 1.5 * (max1-min1);
-    *pc2max = max2 + 1.5 * (max2-min2);
-
-    // clear memory
-    for (int k = 0; k < dim; k++)
-    {
-        delete eigvec[k];
+        const float scale = norm > 0 ? 1.0f / sqrtf(norm) : 0.0f;
+        for (int k = 0; k < dim; k++)
+            pcs[c][k] = v[k] * scale;
     }
-    delete eigvec;
-    delete sigvalues;
-
-    // delete covariances
-    for (int k = 0; k < dim; k++)
-        delete cov[k];
-
-    delete(cov);
-    cov = nullptr;
-
 }
 
-
-/**********************/
-
-
-void PCAcomputingThread::addPCAjob(PCAjob job)
+void IncrementalPCA::getMean(float* mean_) const
 {
-    jobs.push(job);
-    if (!isThreadRunning())
-    {
-        startThread();
-    }
+    for (int k = 0; k < dim; k++)
+        mean_[k] = mean[k];
 }
 
-void PCAcomputingThread::run()
+float IncrementalPCA::getEigenvalue(int component) const
 {
-    while (jobs.size() > 0)
-    {
-        PCAjob J = jobs.front();
-        jobs.pop();
-        // compute PCA
-        // 1. Compute Covariance matrix
-        // 2. Apply SVD on covariance matrix
-        // 3. Extract the two principal components corresponding to the largest singular values
-
-        J.computeCov();
-        J.computeSVD();
-
-        // 4. Report to the spike sorting electrode that PCA is finished
-        *(J.reportDone) = true;
-    }
-}
+    const float* v = &components[component][0];
 
+    float norm = 0;
+    for (int k = 0; k < dim; k++)
+        norm += v[k] * v[k];
 
-PCAcomputingThread::PCAcomputingThread() : Thread("PCA")
-{
+    return sqrtf(norm);
+}
 
+int IncrementalPCA::getNumSamples() const
+{
+    return numSamples;
 }
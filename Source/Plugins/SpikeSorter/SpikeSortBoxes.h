@@ -28,9 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "SpikeSorterEditor.h"
 #include <algorithm>    // std::sort
 #include <list>
-#include <queue>
 
-class PCAcomputingThread;
 class UniqueIDgenerator;
 class PointD
 {
@@ -58,7 +56,7 @@ public:
     Box();
     Box(int channel);
     Box(float X, float Y, float W, float H, int ch=0);
-    bool LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22);
+    static bool LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22);
     bool isWaveFormInside(SpikeObject* so);
     double x,y,w,h; // x&w and specified in microseconds. y&h in microvolts
     int channel;
@@ -150,32 +148,50 @@ public:
 
 };
 
-/*
-class PCAjob
-{
-public:
-PCAjob();
-};*/
-class PCAjob
+/**
+    Tracks the two leading principal components of the waveforms of an
+    electrode, updating them with every spike.
+
+    Uses candid covariance-free incremental PCA (Weng et al., 2003): each
+    component is a weighted running average of the centred waveforms scaled
+    by their projection on it, and each waveform is deflated by the first
+    component before it updates the second. An update costs O(dim) per
+    component and no covariance matrix is formed. The amnesic weighting and
+    the cap on the sample count let the components follow slow drifts.
+*/
+class IncrementalPCA
 {
 public:
-    PCAjob(Array<SpikeObject> _spikes, float* _pc1, float* _pc2,
-           float*, float*, float*, float*, bool* _reportDone);
-    ~PCAjob();
-    void computeCov();
-    void computeSVD();
-
-    float** cov;
-    Array<SpikeObject> spikes;
-    float* pc1, *pc2;
-    float* pc1min, *pc2min, *pc1max, *pc2max;
-    bool* reportDone;
+    IncrementalPCA();
+
+    /** Clears the estimate, for waveforms of dim values. */
+    void reset(int dim);
+
+    /** Updates the mean and the components with one waveform, in microvolts. */
+    void update(const float* waveform);
+
+    /** Starts from a previously saved estimate: the mean, the normalized
+        components with their eigenvalues, and the number of spikes it was
+        computed from, which sets how quickly new spikes move it. */
+    void setState(const float* mean, const float* pc1, const float* pc2,
+                  float eigenvalue1, float eigenvalue2, int numSamples);
+
+    /** Copies the current components, normalized. */
+    void getComponents(float* pc1, float* pc2) const;
+
+    void getMean(float* mean) const;
+    float getEigenvalue(int component) const;
+    int getNumSamples() const;
+
 private:
-    int svdcmp(float** a, int nRows, int nCols, float* w, float** v);
-    float pythag(float a, float b);
     int dim;
-};
+    int numSamples;
+    std::vector<float> mean;
+    std::vector<float> residual;
 
+    // the norm of each component estimates its eigenvalue
+    std::vector<float> components[2];
+};
 
 class cPolygon
 {
@@ -188,16 +204,6 @@ public:
 
 
 
-class PCAcomputingThread : juce::Thread
-{
-public:
-    PCAcomputingThread();
-    void run(); // computes PCA on waveforms
-    void addPCAjob(PCAjob job);
-
-    std::queue<PCAjob> jobs;
-};
-
 class PCAUnit
 {
 public:
@@ -228,14 +234,22 @@ public:
 class SpikeSortBoxes
 {
 public:
-    SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_, PCAcomputingThread* pth, int numch, double SamplingRate, int WaveFormLength);
+    SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_, int numch, double SamplingRate, int WaveFormLength);
     ~SpikeSortBoxes();
 
     void resizeWaveform(int numSamples);
 
 
+    /** Updates the principal components with a spike and projects it on them. */
     void projectOnPrincipalComponents(SpikeObject* so);
     bool sortSpike(SpikeObject* so, bool PCAfirst);
+
+    /** Sorts the spikes of one block, taking the lock once. The units are
+        compiled into flat tables again only after they or the waveform
+        layout have changed. */
+    void sortSpikes(SpikeObject** spikes, int numSpikes, bool PCAfirst);
+
+    /** Fits the PCA display range to the buffered spikes again. */
     void RePCA();
     void addPCAunit(PCAUnit unit);
     int addBoxUnit(int channel);
@@ -276,12 +290,61 @@ private:
     CriticalSection mut;
     std::vector<BoxUnit> boxUnits;
     std::vector<PCAUnit> pcaUnits;
+    void updatePCArange();
+
+    /** A box of a box unit, in the bins and microvolts of the compiled waveforms */
+    struct CompiledBox
+    {
+        int channel;
+        int firstBin, lastBin;      // segments starting at these bins are tested
+        float top, bottom;
+        PointD topLeft, bottomLeft, topRight, bottomRight;
+    };
+
+    /** A polygon edge, with the polygon offset applied */
+    struct CompiledEdge
+    {
+        float newX, oldX;           // in the order of the polygon points
+        PointD p1, p2;              // sorted by X
+    };
+
+    /** The boxes or polygon edges of a unit, and the bounds of a polygon */
+    struct CompiledUnit
+    {
+        int unitIndex;
+        int first, count;
+        float minX, maxX, minY, maxY;
+    };
+
+    /** Rebuilds the tables below for the units and the waveform layout of a spike. */
+    void compileUnits(const SpikeObject* so);
+    static bool compareBoxBins(const CompiledBox& a, const CompiledBox& b);
+    bool sortByBoxes(SpikeObject* so);
+    bool sortByPolygons(SpikeObject* so, bool updateWaveform);
+    bool isWaveformInsideBox(const CompiledBox& b, SpikeObject* so);
+    bool isPointInsidePolygon(const CompiledUnit& unit, float x, float y) const;
+    const float* getChannelMicrovolts(SpikeObject* so, int channel);
+
+    /** Set by every change to boxUnits or pcaUnits */
+    bool unitsChanged;
+    int compiledSamples;
+    uint16 compiledSampleRate;
+
+    std::vector<CompiledBox> compiledBoxes;        // each unit's boxes sorted by sample index
+    std::vector<CompiledUnit> compiledBoxUnits;
+    std::vector<CompiledEdge> compiledEdges;
+    std::vector<CompiledUnit> compiledPCAUnits;
+    std::vector<float> binTimes;
+    std::vector<float> channelMicrovolts;
+    std::vector<bool> channelConverted;
+
     float* pc1, *pc2;
     float pc1min, pc2min, pc1max, pc2max;
     Array<SpikeObject> spikeBuffer;
     int bufferSize,spikeBufferIndex;
-    PCAcomputingThread* computingThread;
-    bool bPCAJobSubmitted,bPCAcomputed,bRePCA,bPCAjobFinished ;
+    IncrementalPCA pca;
+    std::vector<float> waveform;
+    bool bPCAcomputed,bRePCA,bPCAjobFinished ;
 
 
 };
@@ -40,7 +40,6 @@ SpikeSorter::SpikeSorter()
     ticksPerSec = (float) timer.getHighResolutionTicksPerSecond();
     electrodeTypes.clear();
     electrodeCounter.clear();
-    spikeBuffer = new uint8_t[MAX_SPIKE_BUFFER_LEN]; // MAX_SPIKE_BUFFER_LEN defined in SpikeObject.h
     channelBuffers=nullptr;
     PCAbeforeBoxes = true;
     autoDACassignment = false;
@@ -153,9 +152,6 @@ void SpikeSorter::increaseUniqueProbeID(String type)
 
 SpikeSorter::~SpikeSorter()
 {
-    delete spikeBuffer;
-    spikeBuffer = nullptr;
-
     if (channelBuffers != nullptr)
         delete channelBuffers;
 
@@ -212,10 +208,9 @@ Electrode::~Electrode()
 
 }
 
-Electrode::Electrode(int ID, UniqueIDgenerator* uniqueIDgenerator_, PCAcomputingThread* pth, String _name, int _numChannels, int* _channels, float default_threshold, int pre, int post, float samplingRate , int sourceNodeId)
+Electrode::Electrode(int ID, UniqueIDgenerator* uniqueIDgenerator_, String _name, int _numChannels, int* _channels, float default_threshold, int pre, int post, float samplingRate , int sourceNodeId)
 {
     electrodeID = ID;
-    computingThread = pth;
     uniqueIDgenerator = uniqueIDgenerator_;
     name = _name;
 
@@ -241,10 +236,7 @@ Electrode::Electrode(int ID, UniqueIDgenerator* uniqueIDgenerator_, PCAcomputing
     }
     spikePlot = nullptr;
 
-    if (computingThread != nullptr)
-        spikeSort = new SpikeSortBoxes(uniqueIDgenerator, computingThread, numChannels, samplingRate, pre+post);
-    else
-        spikeSort = nullptr;
+    spikeSort = new SpikeSortBoxes(uniqueIDgenerator, numChannels, samplingRate, pre+post);
 
     isMonitored = false;
 }
@@ -437,7 +429,7 @@ bool SpikeSorter::addElectrode(int nChans, String name, double Depth)
     for (int k = 0; k < nChans; k++)
         chans[k] = firstChan + k;
 
-    Electrode* newElectrode = new Electrode(++uniqueID, &uniqueIDgenerator, &computingThread, name, nChans, chans, getDefaultThreshold(),
+    Electrode* newElectrode = new Electrode(++uniqueID, &uniqueIDgenerator, name, nChans, chans, getDefaultThreshold(),
                                             numPreSamples, numPostSamples, getSampleRate(), channels[chans[0]]->sourceNodeId);
 
     newElectrode->depthOffsetMM = Depth;
@@ -684,14 +676,7 @@ void SpikeSorter::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int pea
 
     // std::cout << "Adding spike event for index " << peakIndex << std::endl;
 
-    s->eventType = SPIKE_EVENT_CODE;
-
-    int numBytes = packSpike(s,                        // SpikeObject
-                             spikeBuffer,              // uint8_t*
-                             MAX_SPIKE_BUFFER_LEN);    // int
-
-    if (numBytes > 0)
-        eventBuffer.addEvent(spikeBuffer, numBytes, peakIndex);
+    spikeEvents.addSpikeEvent(eventBuffer, s, peakIndex);
 
     //std::cout << "Adding spike" << std::endl;
 }
@@ -883,6 +868,8 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
     Electrode* electrode;
     dataBuffer = &buffer;
 
+    spikeEvents.clear();
+
     checkForEvents(events); // find latest's packet timestamps
 
     //channelBuffers->update(buffer, hardware_timestamp,software_timestamp, nSamples);
@@ -958,7 +945,7 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
                         peakIndex = sampleIndex;
                         sampleIndex -= (electrode->prePeakSamples+1);
 
-                        SpikeObject newSpike;
+                        SpikeObject& newSpike = *spikeEvents.getNewSpike();
                         newSpike.sortedId = 0; // unsorted.
                         newSpike.timestamp = getTimestamp(currentChannel) + peakIndex;
                         newSpike.electrodeID = electrode->electrodeID;
@@ -996,27 +983,10 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
                         //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
                         electrode->spikeSort->projectOnPrincipalComponents(&newSpike);
 
-                        // Add spike to drawing buffer....
-                        electrode->spikeSort->sortSpike(&newSpike, PCAbeforeBoxes);
-
-
-                        // transfer buffered spikes to spike plot
-                        if (electrode->spikePlot != nullptr)
-                        {
-                            if (electrode->spikeSort->isPCAfinished())
-                            {
-                                electrode->spikeSort->resetJobStatus();
-                                float p1min,p2min, p1max,  p2max;
-                                electrode->spikeSort->getPCArange(p1min,p2min, p1max,  p2max);
-                                electrode->spikePlot->setPCARange(p1min,p2min, p1max,  p2max);
-                            }
-
-
-                            electrode->spikePlot->processSpikeObject(newSpike);
-                        }
+                        // spikes are sorted together at the end of the block
+                        blockSpikes.add(&newSpike);
+                        blockSpikePeaks.add(peakIndex);
 
-
-                        addSpikeEvent(&newSpike, events, peakIndex);
                         //prevSpike = newSpike;
                         // advance the sample index
                         sampleIndex = peakIndex + electrode->postPeakSamples;
@@ -1030,6 +1000,31 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
 
         } // end cycle through samples
 
+        if (blockSpikes.size() > 0)
+        {
+            electrode->spikeSort->sortSpikes(blockSpikes.getRawDataPointer(), blockSpikes.size(), PCAbeforeBoxes);
+
+            // transfer sorted spikes to spike plot
+            if (electrode->spikePlot != nullptr && electrode->spikeSort->isPCAfinished())
+            {
+                electrode->spikeSort->resetJobStatus();
+                float p1min,p2min, p1max,  p2max;
+                electrode->spikeSort->getPCArange(p1min,p2min, p1max,  p2max);
+                electrode->spikePlot->setPCARange(p1min,p2min, p1max,  p2max);
+            }
+
+            for (int k = 0; k < blockSpikes.size(); k++)
+            {
+                if (electrode->spikePlot != nullptr)
+                    electrode->spikePlot->processSpikeObject(*blockSpikes[k]);
+
+                addSpikeEvent(blockSpikes[k], events, blockSpikePeaks[k]);
+            }
+
+            blockSpikes.clearQuick();
+            blockSpikePeaks.clearQuick();
+        }
+
         //float vv = getNextSample(currentChannel);
         electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
 
@@ -1336,7 +1331,7 @@ void SpikeSorter::loadCustomParametersFromXml()
 
                         int sourceNodeId = 102010; // some number
 
-                        Electrode* newElectrode = new Electrode(electrodeID, &uniqueIDgenerator,&computingThread, electrodeName, channelsPerElectrode, channels,getDefaultThreshold(),
+                        Electrode* newElectrode = new Electrode(electrodeID, &uniqueIDgenerator, electrodeName, channelsPerElectrode, channels,getDefaultThreshold(),
                                                                 numPreSamples,numPostSamples, getSampleRate(), sourceNodeId);
                         for (int k=0; k<channelsPerElectrode; k++)
                         {
@@ -64,8 +64,6 @@ public:
 };
 */
 
-class PCAjob;
-class PCAcomputingThread;
 class UniqueIDgenerator
 {
 public:
@@ -149,7 +147,7 @@ private:
 class Electrode
 {
 public:
-    Electrode(int electrodeID, UniqueIDgenerator* uniqueIDgenerator_, PCAcomputingThread* pth,String _name, int _numChannels, int* _channels, float default_threshold, int pre, int post, float samplingRate , int sourceNodeId);
+    Electrode(int electrodeID, UniqueIDgenerator* uniqueIDgenerator_, String _name, int _numChannels, int* _channels, float default_threshold, int pre, int post, float samplingRate , int sourceNodeId);
     ~Electrode();
 
     void resizeWaveform(int numPre, int numPost);
@@ -174,7 +172,6 @@ public:
     RunningStat* runningStats;
     SpikeHistogramPlot* spikePlot;
     SpikeSortBoxes* spikeSort;
-    PCAcomputingThread* computingThread;
     UniqueIDgenerator* uniqueIDgenerator;
     bool isMonitored;
 };
@@ -416,7 +413,12 @@ private:
 
 
     int numPreSamples,numPostSamples;
-    uint8_t* spikeBuffer;///[256];
+    /** Spikes sorted in the current block, read in place downstream */
+    SpikeEventBuffer spikeEvents;
+
+    /** Spikes of the current electrode and their peak indexes, sorted once per block */
+    Array<SpikeObject*> blockSpikes;
+    Array<int> blockSpikePeaks;
     //int64 timestamp;
     int64 hardware_timestamp;
     int64 software_timestamp;
@@ -444,7 +446,6 @@ private:
 
 
     Array<Electrode*> electrodes;
-    PCAcomputingThread computingThread;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeSorter);
 
 };
@@ -49,25 +49,93 @@ void DataBuffer::resize(int chans, int size)
     numChans = chans;
 }
 
-void DataBuffer::addToBuffer(float* data, int64* timestamps, uint64* eventCodes, int numItems)
+// number of frames de-interleaved at a time; small enough that one tile of
+// source frames stays in L1 cache while each destination channel is written
+#define DATABUFFER_TILE_SIZE 16
+
+void DataBuffer::copyInterleaved(const float* data, int destStartSample, int numItems)
+{
+    float** dest = buffer.getArrayOfWritePointers();
+
+    for (int tile = 0; tile < numItems; tile += DATABUFFER_TILE_SIZE)
+    {
+        const int tileSize = jmin(DATABUFFER_TILE_SIZE, numItems - tile);
+        const float* src = data + tile * numChans;
+
+        for (int chan = 0; chan < numChans; chan++)
+        {
+            float* d = dest[chan] + destStartSample + tile;
+            const float* s = src + chan;
+
+            for (int n = 0; n < tileSize; n++)
+            {
+                d[n] = *s;
+                s += numChans;
+            }
+        }
+    }
+}
+
+int DataBuffer::addToBuffer(float* data, int64* timestamps, uint64* eventCodes, int numItems)
+{
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    if (blockSize1 > 0)
+    {
+        copyInterleaved(data, startIndex1, blockSize1);
+
+        memcpy(timestampBuffer + startIndex1, timestamps, blockSize1 * sizeof(int64));
+        memcpy(eventCodeBuffer + startIndex1, eventCodes, blockSize1 * sizeof(uint64));
+    }
+
+    if (blockSize2 > 0)
+    {
+        copyInterleaved(data + blockSize1 * numChans, startIndex2, blockSize2);
+
+        memcpy(timestampBuffer + startIndex2, timestamps + blockSize1, blockSize2 * sizeof(int64));
+        memcpy(eventCodeBuffer + startIndex2, eventCodes + blockSize1, blockSize2 * sizeof(uint64));
+    }
+
+    const int numWritten = blockSize1 + blockSize2;
+    abstractFifo.finishedWrite(numWritten);
+
+    return numWritten;
+}
+
+int DataBuffer::addChannelMajorToBuffer(const float* data, int channelStride,
+                                        int64* timestamps, uint64* eventCodes, int numItems)
 {
-    // writes one sample for all channels
     int startIndex1, blockSize1, startIndex2, blockSize2;
     abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
 
     for (int chan = 0; chan < numChans; chan++)
     {
+        const float* src = data + chan * channelStride;
 
-        buffer.copyFrom(chan, // int destChannel
-                        startIndex1, // int destStartSample
-                        data + chan,  // const float* source
-                        1); // int num samples
+        if (blockSize1 > 0)
+            buffer.copyFrom(chan, startIndex1, src, blockSize1);
+
+        if (blockSize2 > 0)
+            buffer.copyFrom(chan, startIndex2, src + blockSize1, blockSize2);
+    }
+
+    if (blockSize1 > 0)
+    {
+        memcpy(timestampBuffer + startIndex1, timestamps, blockSize1 * sizeof(int64));
+        memcpy(eventCodeBuffer + startIndex1, eventCodes, blockSize1 * sizeof(uint64));
+    }
+
+    if (blockSize2 > 0)
+    {
+        memcpy(timestampBuffer + startIndex2, timestamps + blockSize1, blockSize2 * sizeof(int64));
+        memcpy(eventCodeBuffer + startIndex2, eventCodes + blockSize1, blockSize2 * sizeof(uint64));
     }
 
-    *(timestampBuffer + startIndex1) = *timestamps;
-    *(eventCodeBuffer + startIndex1) = *eventCodes;
+    const int numWritten = blockSize1 + blockSize2;
+    abstractFifo.finishedWrite(numWritten);
 
-    abstractFifo.finishedWrite(numItems);
+    return numWritten;
 }
 
 int DataBuffer::getNumSamples()
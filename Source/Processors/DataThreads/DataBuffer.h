@@ -45,8 +45,20 @@ public:
     /** Clears the buffer.*/
     void clear();
 
-    /** Add an array of floats to the buffer.*/
-    void addToBuffer(float* data, int64* ts, uint64* eventCodes, int numItems);
+    /** Add an array of floats to the buffer.
+
+        The data must be interleaved (one frame of numChans values per sample),
+        with one timestamp and one event code per sample. Returns the number of
+        samples that were actually written, which can be less than numItems
+        if the buffer is full.*/
+    int addToBuffer(float* data, int64* ts, uint64* eventCodes, int numItems);
+
+    /** Add a block of channel-major floats to the buffer.
+
+        Samples for channel n start at data + n * channelStride. Returns the
+        number of samples that were actually written.*/
+    int addChannelMajorToBuffer(const float* data, int channelStride,
+                                int64* ts, uint64* eventCodes, int numItems);
 
     /** Returns the number of samples currently available in the buffer.*/
     int getNumSamples();
@@ -58,6 +70,9 @@ public:
     void resize(int chans, int size);
 
 private:
+    /** De-interleaves numItems frames into the buffer, starting at destStartSample.*/
+    void copyInterleaved(const float* data, int destStartSample, int numItems);
+
     AbstractFifo abstractFifo;
     AudioSampleBuffer buffer;
 
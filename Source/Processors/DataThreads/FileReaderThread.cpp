@@ -138,30 +138,21 @@ bool FileReaderThread::updateBuffer()
             std::cout << "Fewer samples read than were requested." << std::endl;
         }
         
-        int chan = 0;
+        const int numFrames = bufferSize / 16;
 
         for (int n = 0; n < bufferSize; n++)
         {
-            thisSample[chan] = float(-readBuffer[n]) * 0.0305; // previously 0.035
-
-            if (chan == 15)
-            {
-
-                timestamp++; // = (0 << 0) + (0 << 8) + (0 << 16) + (0 << 24); // +
-                //(4 << 32); // + (3 << 40) + (2 << 48) + (1 << 56);
-
-                //timestamp++; // = timer.getHighResolutionTicks();
-                dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
-                chan = 0;
-            }
-            else
-            {
-                chan++;
-            }
-
+            thisBlock[n] = float(-readBuffer[n]) * 0.0305; // previously 0.035
+        }
 
+        for (int n = 0; n < numFrames; n++)
+        {
+            blockTimestamps[n] = ++timestamp;
+            blockEventCodes[n] = eventCode;
         }
 
+        dataBuffer->addToBuffer(thisBlock, blockTimestamps, blockEventCodes, numFrames);
+
     }
     else
     {
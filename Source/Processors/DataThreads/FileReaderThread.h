@@ -63,8 +63,10 @@ private:
     int lengthOfInputFile;
     FILE* input;
 
-    float thisSample[16];
+    float thisBlock[1600];
     int16 readBuffer[1600];
+    int64 blockTimestamps[100];
+    uint64 blockEventCodes[100];
 
     int bufferSize;
 
@@ -0,0 +1,258 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RHD2000Decoder.h"
+#include "../DataBuffer.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+// number of sample frames converted before they are scattered to the output
+// channels; one tile of a 16-stream frame is ~18 KB and stays in L1 cache
+#define DECODER_TILE_SIZE 16
+
+// the aux and ADC scaling is done in double precision, as it always has been
+#define AMPLIFIER_BIT_VOLTS 0.195f
+#define AUX_BIT_VOLTS 0.0000374
+#define ADC_BIT_VOLTS 0.00015258789
+
+namespace
+{
+    /** dest[i] = (src[i] - 32768) * scale, for unaligned little-endian uint16 words.*/
+    void convertOffsetWords(float* dest, const unsigned char* src, float scale, int numValues)
+    {
+        int i = 0;
+
+#if JUCE_INTEL
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 offset = _mm_set1_ps(32768.0f);
+        const __m128 mult = _mm_set1_ps(scale);
+
+        for (; i + 8 <= numValues; i += 8)
+        {
+            const __m128i words = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+            const __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+            const __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero));
+
+            _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_sub_ps(lo, offset), mult));
+            _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_sub_ps(hi, offset), mult));
+        }
+#endif
+
+        for (; i < numValues; i++)
+        {
+            dest[i] = float(ByteOrder::littleEndianShort(src + 2 * i) - 32768) * scale;
+        }
+    }
+}
+
+RHD2000Decoder::RHD2000Decoder()
+    : numStreams(0), samplesPerBlock(0), frameSize(0), numChannels(0),
+      acquireAdcChannels(false), auxOffset(0), amplifierOffset(0), adcOffset(0),
+      ttlOffset(0), amplifierWords(0), firstAuxChannel(0), firstAdcChannel(0)
+{
+}
+
+RHD2000Decoder::~RHD2000Decoder()
+{
+}
+
+int RHD2000Decoder::getFrameSizeInBytes(int numStreams)
+{
+    // header (8) + timestamp (4) + 3 aux words, 32 amplifier words and
+    // one filler word per stream + 8 ADC words + TTL in and out (4)
+    return 8 + 4 + numStreams * 2 * (3 + 32 + 1) + 16 + 4;
+}
+
+bool RHD2000Decoder::checkHeader(const unsigned char* frame)
+{
+    return ByteOrder::littleEndianInt64(frame) == RHD2000_HEADER_MAGIC_NUMBER;
+}
+
+void RHD2000Decoder::setConfiguration(const Array<int>& chipIds,
+                                      const Array<int>& channelsPerStream,
+                                      bool adcsEnabled,
+                                      int numSamples)
+{
+    numStreams = channelsPerStream.size();
+    samplesPerBlock = numSamples;
+    acquireAdcChannels = adcsEnabled;
+
+    frameSize = getFrameSizeInBytes(numStreams);
+    auxOffset = 12;
+    amplifierOffset = auxOffset + 6 * numStreams;
+    amplifierWords = 32 * numStreams;
+    adcOffset = amplifierOffset + 2 * amplifierWords + 2 * numStreams;
+    ttlOffset = adcOffset + 16;
+
+    amplifierSource.clearQuick();
+    auxStreams.clearQuick();
+
+    for (int stream = 0; stream < numStreams; stream++)
+    {
+        int chOffset = 0;
+
+        if (chipIds[stream] == CHIP_ID_RHD2132 && channelsPerStream[stream] == 16) // RHD2132 16ch. headstage
+            chOffset = RHD2132_16CH_OFFSET;
+
+        for (int chan = 0; chan < channelsPerStream[stream]; chan++)
+            amplifierSource.add((chan + chOffset) * numStreams + stream);
+    }
+
+    for (int stream = 0; stream < numStreams; stream++)
+    {
+        if (chipIds[stream] != CHIP_ID_RHD2164_B) // channel B of 2164 shouldn't be copied
+            auxStreams.add(stream);
+    }
+
+    firstAuxChannel = amplifierSource.size();
+    firstAdcChannel = firstAuxChannel + 3 * auxStreams.size();
+    numChannels = firstAdcChannel + (acquireAdcChannels ? 8 : 0);
+
+    output.calloc(jmax(1, numChannels * samplesPerBlock));
+    scratch.malloc(jmax(1, DECODER_TILE_SIZE * amplifierWords));
+    timestamps.calloc(jmax(1, samplesPerBlock));
+    eventCodes.calloc(jmax(1, samplesPerBlock));
+    auxSamples.malloc(jmax(1, 3 * auxStreams.size()));
+    auxHeld.malloc(jmax(1, 3 * auxStreams.size()));
+
+    reset();
+}
+
+void RHD2000Decoder::reset()
+{
+    auxSamples.clear(jmax(1, 3 * auxStreams.size()));
+    auxHeld.clear(jmax(1, 3 * auxStreams.size()));
+}
+
+int RHD2000Decoder::decodeBlock(const unsigned char* block)
+{
+    int numSamples = 0;
+
+    for (; numSamples < samplesPerBlock; numSamples++)
+    {
+        const unsigned char* frame = block + numSamples * frameSize;
+
+        if (!checkHeader(frame))
+            break;
+
+        timestamps[numSamples] = ByteOrder::littleEndianInt(frame + 8);
+        eventCodes[numSamples] = ByteOrder::littleEndianShort(frame + ttlOffset);
+    }
+
+    decodeAmplifierChannels(block, numSamples);
+    decodeAuxChannels(block, numSamples);
+
+    if (acquireAdcChannels)
+        decodeAdcChannels(block, numSamples);
+
+    return numSamples;
+}
+
+int RHD2000Decoder::decodeBlockToBuffer(const unsigned char* block, DataBuffer& buffer)
+{
+    const int numSamples = decodeBlock(block);
+
+    if (numSamples > 0)
+        buffer.addChannelMajorToBuffer(output, samplesPerBlock, timestamps, eventCodes, numSamples);
+
+    return numSamples;
+}
+
+void RHD2000Decoder::decodeAmplifierChannels(const unsigned char* block, int numSamples)
+{
+    const int numAmplifierChannels = amplifierSource.size();
+    const int* source = amplifierSource.getRawDataPointer();
+
+    for (int tileStart = 0; tileStart < numSamples; tileStart += DECODER_TILE_SIZE)
+    {
+        const int tileSize = jmin(DECODER_TILE_SIZE, numSamples - tileStart);
+
+        // convert every amplifier word of the tile, which is contiguous within each frame
+        for (int t = 0; t < tileSize; t++)
+        {
+            convertOffsetWords(scratch + t * amplifierWords,
+                               block + (tileStart + t) * frameSize + amplifierOffset,
+                               AMPLIFIER_BIT_VOLTS,
+                               amplifierWords);
+        }
+
+        // then scatter it to the channel-major output, one cache line per channel
+        for (int chan = 0; chan < numAmplifierChannels; chan++)
+        {
+            const float* src = scratch + source[chan];
+            float* dest = output + chan * samplesPerBlock + tileStart;
+
+            for (int t = 0; t < tileSize; t++)
+                dest[t] = src[t * amplifierWords];
+        }
+    }
+}
+
+void RHD2000Decoder::decodeAuxChannels(const unsigned char* block, int numSamples)
+{
+    for (int i = 0; i < auxStreams.size(); i++)
+    {
+        // aux results come back on the second command slot of each stream
+        const int wordOffset = auxOffset + 2 * numStreams + 2 * auxStreams[i];
+        float* samples = auxSamples + 3 * i;
+        float* held = auxHeld + 3 * i;
+        float* dest = output + (firstAuxChannel + 3 * i) * samplesPerBlock;
+
+        for (int samp = 0; samp < numSamples; samp++)
+        {
+            const int auxNum = (samp + 3) % 4;
+
+            if (auxNum < 3)
+            {
+                samples[auxNum] = float(float(ByteOrder::littleEndianShort(block + samp * frameSize + wordOffset) - 32768)
+                                        * AUX_BIT_VOLTS);
+            }
+            else
+            {
+                held[0] = samples[0];
+                held[1] = samples[1];
+                held[2] = samples[2];
+            }
+
+            dest[samp] = held[0];
+            dest[samp + samplesPerBlock] = held[1];
+            dest[samp + 2 * samplesPerBlock] = held[2];
+        }
+    }
+}
+
+void RHD2000Decoder::decodeAdcChannels(const unsigned char* block, int numSamples)
+{
+    for (int adcChan = 0; adcChan < 8; adcChan++)
+    {
+        const unsigned char* src = block + adcOffset + 2 * adcChan;
+        float* dest = output + (firstAdcChannel + adcChan) * samplesPerBlock;
+
+        // ADC waveform units = volts
+        for (int samp = 0; samp < numSamples; samp++)
+            dest[samp] = float(ADC_BIT_VOLTS * float(ByteOrder::littleEndianShort(src + samp * frameSize))
+                               - 5 - 0.4096); // account for +/-5V input range and DC offset
+    }
+}
@@ -0,0 +1,150 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __RHD2000DECODER_H_4A1F2C3E__
+#define __RHD2000DECODER_H_4A1F2C3E__
+
+#include "../../../../JuceLibraryCode/JuceHeader.h"
+
+#define CHIP_ID_RHD2132  1
+#define CHIP_ID_RHD2216  2
+#define CHIP_ID_RHD2164  4
+#define CHIP_ID_RHD2164_B  1000
+#define RHD2132_16CH_OFFSET 8
+
+#define RHD2000_HEADER_MAGIC_NUMBER 0xc691199927021942ULL
+#define RHD2000_SAMPLES_PER_BLOCK(usb3) ((usb3) ? 256 : 60)
+
+class DataBuffer;
+
+/**
+
+  Converts raw USB data blocks from the Rhythm FPGA into channel-major
+  floating point arrays.
+
+  The channel ordering matches the one the RHD2000Thread has always produced:
+  all headstage channels stream by stream, then three aux channels per chip
+  (except for the second half of an RHD2164), then the eight board ADCs.
+
+  Everything that depends only on the stream configuration (byte offsets of
+  every channel inside a sample frame, the RHD2132 16-channel offset, which
+  streams carry aux data) is computed once by setConfiguration(), so that
+  decodeBlock() only has to run a handful of tight loops over the block.
+
+  @see RHD2000Thread
+
+*/
+
+class RHD2000Decoder
+{
+public:
+    RHD2000Decoder();
+    ~RHD2000Decoder();
+
+    /** Builds the decode plan for a given set of enabled data streams.*/
+    void setConfiguration(const Array<int>& chipIds,
+                          const Array<int>& channelsPerStream,
+                          bool adcsEnabled,
+                          int samplesPerBlock);
+
+    /** Clears the held aux values, so a new acquisition starts from zero.*/
+    void reset();
+
+    /** Decodes one raw data block, as returned by Rhd2000EvalBoard::readRawDataBlock.
+
+        Returns the number of samples decoded. This is less than the block size
+        if a sample with an invalid header was found.*/
+    int decodeBlock(const unsigned char* block);
+
+    /** Decodes one raw data block and appends the samples to a DataBuffer.
+
+        This is all RHD2000Thread::updateBuffer() does with a block, and what the
+        decode benchmark measures. Returns the number of samples decoded.*/
+    int decodeBlockToBuffer(const unsigned char* block, DataBuffer& buffer);
+
+    /** Returns the number of output channels produced by the current plan.*/
+    int getNumChannels() const { return numChannels; }
+
+    /** Returns the number of samples in each block.*/
+    int getSamplesPerBlock() const { return samplesPerBlock; }
+
+    /** Returns the size of a raw block, in bytes, for the current plan.*/
+    int getBlockSizeInBytes() const { return samplesPerBlock * frameSize; }
+
+    /** Returns the size of a single sample frame, in bytes.*/
+    static int getFrameSizeInBytes(int numStreams);
+
+    /** Returns the channel-major output; channel n starts at n * getSamplesPerBlock().*/
+    const float* getChannelData() const { return output; }
+
+    /** Returns one timestamp per decoded sample.*/
+    int64* getTimestamps() { return timestamps; }
+
+    /** Returns one TTL event code per decoded sample.*/
+    uint64* getEventCodes() { return eventCodes; }
+
+    /** Returns true if a sample frame starts with the Rhythm USB header.*/
+    static bool checkHeader(const unsigned char* frame);
+
+private:
+
+    void decodeAmplifierChannels(const unsigned char* block, int numSamples);
+    void decodeAuxChannels(const unsigned char* block, int numSamples);
+    void decodeAdcChannels(const unsigned char* block, int numSamples);
+
+    int numStreams;
+    int samplesPerBlock;
+    int frameSize;
+    int numChannels;
+    bool acquireAdcChannels;
+
+    // byte offsets inside a sample frame
+    int auxOffset;
+    int amplifierOffset;
+    int adcOffset;
+    int ttlOffset;
+    int amplifierWords;
+
+    /** Word index inside the amplifier section of a frame, for each headstage channel.*/
+    Array<int> amplifierSource;
+
+    /** Data streams that produce aux channels, in output order.*/
+    Array<int> auxStreams;
+    int firstAuxChannel;
+    int firstAdcChannel;
+
+    HeapBlock<float> output;
+    HeapBlock<float> scratch;
+    HeapBlock<int64> timestamps;
+    HeapBlock<uint64> eventCodes;
+
+    // aux inputs are only sampled every 4th sample, so these hold the last
+    // values of each aux channel across samples and blocks
+    HeapBlock<float> auxSamples;
+    HeapBlock<float> auxHeld;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000Decoder);
+};
+
+#endif  // __RHD2000DECODER_H_4A1F2C3E__
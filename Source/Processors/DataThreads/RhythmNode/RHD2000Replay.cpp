@@ -0,0 +1,194 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RHD2000Replay.h"
+
+#define CAPTURE_MAGIC "RHDRAW01"
+
+RHD2000Replay::RHD2000Replay()
+    : adcsEnabled(false), usb3(false), numBlocks(0), blockSize(0), frameSize(0),
+      currentBlock(0), timestampOffset(0), timestampSpan(0)
+{
+}
+
+RHD2000Replay::~RHD2000Replay()
+{
+}
+
+void RHD2000Replay::generateSyntheticBlocks(const Array<int>& chipIds_,
+                                            const Array<int>& channelsPerStream_,
+                                            bool adcsEnabled_,
+                                            bool usb3_,
+                                            int numBlocks_)
+{
+    chipIds = chipIds_;
+    channelsPerStream = channelsPerStream_;
+    adcsEnabled = adcsEnabled_;
+    usb3 = usb3_;
+    numBlocks = jmax(1, numBlocks_);
+
+    const int numStreams = channelsPerStream.size();
+    const int samplesPerBlock = getSamplesPerBlock();
+
+    frameSize = RHD2000Decoder::getFrameSizeInBytes(numStreams);
+    blockSize = frameSize * samplesPerBlock;
+
+    data.setSize(blockSize * numBlocks, true);
+
+    Random random(1234);
+
+    for (int samp = 0; samp < numBlocks * samplesPerBlock; samp++)
+    {
+        unsigned char* frame = (unsigned char*) data.getData() + samp * frameSize;
+        int index = 0;
+
+        *(uint64*)(frame + index) = ByteOrder::swapIfBigEndian((uint64) RHD2000_HEADER_MAGIC_NUMBER);
+        index += 8;
+        *(uint32*)(frame + index) = ByteOrder::swapIfBigEndian((uint32) samp);
+        index += 4;
+
+        // aux command results: a slow ramp on each slot
+        for (int i = 0; i < 3 * numStreams; i++, index += 2)
+            *(uint16*)(frame + index) = ByteOrder::swapIfBigEndian((uint16)(32768 + (samp / 4) % 1000));
+
+        // amplifier channels: a 1 kHz sine (at 30 kS/s) with a bit of noise,
+        // phase-shifted per channel
+        for (int i = 0; i < 32 * numStreams; i++, index += 2)
+        {
+            const double phase = 2.0 * double_Pi * (samp / 30.0 + i / 64.0);
+            const int value = 32768 + int(500.0 * std::sin(phase)) + random.nextInt(64) - 32;
+            *(uint16*)(frame + index) = ByteOrder::swapIfBigEndian((uint16) value);
+        }
+
+        index += 2 * numStreams; // filler words
+
+        for (int adcChan = 0; adcChan < 8; adcChan++, index += 2)
+            *(uint16*)(frame + index) = ByteOrder::swapIfBigEndian((uint16)(32768 + adcChan * 1000));
+
+        // toggle TTL input 0 every 1000 samples
+        *(uint16*)(frame + index) = ByteOrder::swapIfBigEndian((uint16)((samp / 1000) % 2));
+    }
+
+    currentBlock = 0;
+    timestampOffset = 0;
+    timestampSpan = numBlocks * samplesPerBlock;
+}
+
+void RHD2000Replay::writeCaptureHeader(OutputStream& stream,
+                                       const Array<int>& chipIds,
+                                       const Array<int>& channelsPerStream,
+                                       bool adcsEnabled,
+                                       bool usb3)
+{
+    stream.write(CAPTURE_MAGIC, 8);
+    stream.writeInt(channelsPerStream.size());
+    stream.writeInt(usb3 ? 1 : 0);
+    stream.writeInt(adcsEnabled ? 1 : 0);
+
+    for (int i = 0; i < channelsPerStream.size(); i++)
+    {
+        stream.writeInt(chipIds[i]);
+        stream.writeInt(channelsPerStream[i]);
+    }
+}
+
+bool RHD2000Replay::loadCapture(const File& file)
+{
+    FileInputStream stream(file);
+
+    if (stream.failedToOpen())
+    {
+        std::cout << "Can't open capture file " << file.getFullPathName() << std::endl;
+        return false;
+    }
+
+    char magic[8];
+
+    if (stream.read(magic, 8) != 8 || memcmp(magic, CAPTURE_MAGIC, 8) != 0)
+    {
+        std::cout << file.getFullPathName() << " is not an RHD2000 capture file." << std::endl;
+        return false;
+    }
+
+    const int numStreams = stream.readInt();
+    usb3 = stream.readInt() != 0;
+    adcsEnabled = stream.readInt() != 0;
+
+    chipIds.clear();
+    channelsPerStream.clear();
+
+    for (int i = 0; i < numStreams; i++)
+    {
+        chipIds.add(stream.readInt());
+        channelsPerStream.add(stream.readInt());
+    }
+
+    frameSize = RHD2000Decoder::getFrameSizeInBytes(numStreams);
+    blockSize = frameSize * getSamplesPerBlock();
+
+    data.reset();
+    stream.readIntoMemoryBlock(data);
+
+    numBlocks = int(data.getSize() / blockSize);
+
+    if (numBlocks == 0)
+    {
+        std::cout << "Capture file " << file.getFullPathName() << " holds no complete blocks." << std::endl;
+        return false;
+    }
+
+    const unsigned char* first = (const unsigned char*) data.getData();
+    const unsigned char* last = first + (numBlocks * getSamplesPerBlock() - 1) * frameSize;
+
+    currentBlock = 0;
+    timestampOffset = 0;
+    timestampSpan = ByteOrder::littleEndianInt(last + 8) - ByteOrder::littleEndianInt(first + 8) + 1;
+
+    return true;
+}
+
+const unsigned char* RHD2000Replay::getNextBlock()
+{
+    if (numBlocks == 0)
+        return nullptr;
+
+    unsigned char* block = (unsigned char*) data.getData() + currentBlock * blockSize;
+
+    if (timestampOffset != 0)
+    {
+        // keep timestamps increasing when the data loops
+        for (int samp = 0; samp < getSamplesPerBlock(); samp++)
+        {
+            uint32* ts = (uint32*)(block + samp * frameSize + 8);
+            *ts = ByteOrder::swapIfBigEndian(ByteOrder::littleEndianInt(ts) + timestampSpan);
+        }
+    }
+
+    if (++currentBlock == numBlocks)
+    {
+        currentBlock = 0;
+        timestampOffset += timestampSpan;
+    }
+
+    return block;
+}
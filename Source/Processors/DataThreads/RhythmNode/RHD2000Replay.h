@@ -0,0 +1,101 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __RHD2000REPLAY_H_7B3E91D0__
+#define __RHD2000REPLAY_H_7B3E91D0__
+
+#include "../../../../JuceLibraryCode/JuceHeader.h"
+#include "RHD2000Decoder.h"
+
+/**
+
+  Supplies raw Rhythm USB data blocks without an Opal Kelly board.
+
+  Blocks either come from a capture file written by the RHD2000Thread
+  (started with "--rhd-capture <file>") or are generated synthetically for
+  any stream configuration. Blocks are served in a loop, with their USB
+  timestamps rewritten so they keep increasing across repetitions.
+
+  The same source drives the "rhd2000" benchmark of open-ephys-benchmarks,
+  which pushes the blocks through RHD2000Decoder::decodeBlockToBuffer() like
+  RHD2000Thread::updateBuffer() does, as fast as possible.
+
+  @see RHD2000Decoder, RHD2000Thread
+
+*/
+
+class RHD2000Replay
+{
+public:
+    RHD2000Replay();
+    ~RHD2000Replay();
+
+    /** Generates numBlocks blocks of synthetic data with valid headers.*/
+    void generateSyntheticBlocks(const Array<int>& chipIds,
+                                 const Array<int>& channelsPerStream,
+                                 bool adcsEnabled,
+                                 bool usb3,
+                                 int numBlocks);
+
+    /** Loads a capture file written by the RHD2000Thread.*/
+    bool loadCapture(const File& file);
+
+    /** Returns the next block, wrapping around at the end of the data.*/
+    const unsigned char* getNextBlock();
+
+    int getNumBlocks() const { return numBlocks; }
+    int getBlockSizeInBytes() const { return blockSize; }
+    int getSamplesPerBlock() const { return RHD2000_SAMPLES_PER_BLOCK(usb3); }
+
+    const Array<int>& getChipIds() const { return chipIds; }
+    const Array<int>& getChannelsPerStream() const { return channelsPerStream; }
+    bool getAdcsEnabled() const { return adcsEnabled; }
+    bool isUSB3() const { return usb3; }
+
+    /** Writes the stream configuration that precedes the raw blocks of a capture file.*/
+    static void writeCaptureHeader(OutputStream& stream,
+                                   const Array<int>& chipIds,
+                                   const Array<int>& channelsPerStream,
+                                   bool adcsEnabled,
+                                   bool usb3);
+
+private:
+    Array<int> chipIds;
+    Array<int> channelsPerStream;
+    bool adcsEnabled;
+    bool usb3;
+
+    MemoryBlock data;
+    int numBlocks;
+    int blockSize;
+    int frameSize;
+    int currentBlock;
+
+    uint32 timestampOffset;
+    uint32 timestampSpan;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000Replay);
+};
+
+#endif  // __RHD2000REPLAY_H_7B3E91D0__
@@ -36,6 +36,7 @@
 #include "rhythm-api/okFrontPanelDLL.h"
 
 #include "../../DataThreads/DataThread.h"
+#include "RHD2000Decoder.h"
 #include "../../GenericProcessor/GenericProcessor.h"
 
 #define MAX_NUM_DATA_STREAMS_USB2 8
@@ -149,9 +150,11 @@ private:
 	int numChannels;
     bool deviceFound;
 
-	float thisSample[MAX_NUM_CHANNELS];
-	float auxBuffer[MAX_NUM_CHANNELS]; // aux inputs are only sampled every 4th sample, so use this to buffer the samples so they can be handles just like the regular neural channels later
-	float auxSamples[MAX_NUM_DATA_STREAMS_USB3][3];
+    /** Converts raw USB blocks into channel-major samples for the DataBuffer.*/
+    RHD2000Decoder decoder;
+
+    /** Receives a copy of every raw block when started with --rhd-capture.*/
+    ScopedPointer<FileOutputStream> captureStream;
 
     unsigned int blockSize;
 
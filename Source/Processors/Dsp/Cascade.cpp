@@ -101,6 +101,24 @@ void Cascade::applyScale(double scale)
     m_stageArray->applyScale(scale);
 }
 
+void Cascade::copyStagesTo(std::vector<BiquadBase>& stages) const
+{
+    stages.assign(m_stageArray, m_stageArray + m_numStages);
+}
+
+void Cascade::setInterpolatedStages(const std::vector<BiquadBase>& from,
+                                    const std::vector<BiquadBase>& to,
+                                    double t)
+{
+    assert(from.size() == to.size());
+    assert(int(to.size()) <= m_maxStages);
+
+    m_numStages = int(to.size());
+
+    for (int i = 0; i < m_numStages; ++i)
+        m_stageArray[i].setInterpolated(from[i], to[i], t);
+}
+
 void Cascade::setLayout(const LayoutBase& proto)
 {
     const int numPoles = proto.getNumPoles();
@@ -47,6 +47,12 @@ namespace Dsp
 /*
  * Implements smooth modulation of time-varying filter parameters
  *
+ * By default the filter is designed only at the start and the end of a
+ * transition, and the biquad coefficients are interpolated linearly in
+ * between. Designs whose number of stages changes during the transition
+ * fall back to a new design from interpolated parameters for every
+ * sample, which is also what redesignEachSample always does.
+ *
  */
 template <class DesignClass,
          int Channels,
@@ -59,9 +65,18 @@ class SmoothedFilterDesign
 public:
     typedef FilterDesign <DesignClass, Channels, StateType> filter_type_t;
 
-    SmoothedFilterDesign(int transitionSamples)
+    enum TransitionMode
+    {
+        redesignEachSample,
+        interpolateCoefficients
+    };
+
+    SmoothedFilterDesign(int transitionSamples,
+                         TransitionMode transitionMode = interpolateCoefficients)
         : m_transitionSamples(transitionSamples)
         , m_remainingSamples(-1)  // first time flag
+        , m_transitionMode(transitionMode)
+        , m_interpolating(false)
     {
     }
 
@@ -78,7 +93,32 @@ public:
         // first handle any transition samples
         int remainingSamples = std::min(m_remainingSamples, numSamples);
 
-        if (remainingSamples > 0)
+        if (remainingSamples > 0 && m_interpolating)
+        {
+            // interpolate coefficients for each sample
+            const int done = m_transitionSamples - m_remainingSamples;
+
+            for (int n = 0; n < remainingSamples; ++n)
+            {
+                const double t = double(done + n + 1) / m_transitionSamples;
+                m_transitionFilter.setInterpolatedStages(m_startStages, m_endStages, t);
+
+                for (int i = numChannels; --i >= 0;)
+                {
+                    Sample* dest = destChannelArray[i]+n;
+                    *dest = this->m_state[i].process(*dest, m_transitionFilter);
+                }
+            }
+
+            m_remainingSamples -= remainingSamples;
+
+            if (m_remainingSamples == 0)
+            {
+                m_transitionParams = this->getParams();
+                m_interpolating = false;
+            }
+        }
+        else if (remainingSamples > 0)
         {
             // interpolate parameters for each sample
             const double t = 1. / m_remainingSamples;
@@ -132,6 +172,32 @@ protected:
     {
         if (m_remainingSamples >= 0)
         {
+            if (m_remainingSamples > 0 && m_interpolating)
+            {
+                // interrupted part way through an interpolation: start from the
+                // coefficients and parameters it has reached, which is where
+                // m_transitionFilter would be had it processed another sample
+                const double t = double(m_transitionSamples - m_remainingSamples) / m_transitionSamples;
+
+                m_transitionFilter.setInterpolatedStages(m_startStages, m_endStages, t);
+                m_transitionFilter.copyStagesTo(m_startStages);
+
+                for (int i = 0; i < DesignClass::NumParams; ++i)
+                    m_transitionParams[i] += (m_endParams[i] - m_transitionParams[i]) * t;
+            }
+            else if (m_transitionMode == interpolateCoefficients)
+            {
+                // start from the coefficients in use right now
+                if (m_remainingSamples > 0)
+                {
+                    // redesigning each sample, from parameters that are up to date
+                    m_transitionFilter.setParams(m_transitionParams);
+                    m_transitionFilter.copyStagesTo(m_startStages);
+                }
+                else
+                    this->m_design.copyStagesTo(m_startStages);
+            }
+
             m_remainingSamples = m_transitionSamples;
         }
         else
@@ -142,14 +208,29 @@ protected:
         }
 
         filter_type_t::doSetParams(parameters);
+        m_endParams = parameters;
+
+        m_interpolating = false;
+
+        if (m_transitionMode == interpolateCoefficients && m_remainingSamples > 0)
+        {
+            this->m_design.copyStagesTo(m_endStages);
+            m_interpolating = m_startStages.size() == m_endStages.size();
+        }
     }
 
 protected:
     Params m_transitionParams;
+    Params m_endParams;            // getParams() has already changed when doSetParams() is called
     DesignClass m_transitionFilter;
     int m_transitionSamples;
 
     int m_remainingSamples;        // remaining transition samples
+
+    TransitionMode m_transitionMode;
+    bool m_interpolating;          // current transition interpolates coefficients
+    std::vector<BiquadBase> m_startStages;
+    std::vector<BiquadBase> m_endStages;
 };
 
 }
@@ -23,6 +23,7 @@
 
 #include "FileReader.h"
 #include "FileReaderEditor.h"
+#include "OpenEphysFileSource.h"
 #include <stdio.h>
 #include "../../AccessClass.h"
 #include "../PluginManager/PluginManager.h"
@@ -30,6 +31,7 @@
 
 FileReader::FileReader()
     : GenericProcessor ("File Reader")
+    , Thread ("File Reader")
     , timestamp             (0)
     , currentSampleRate     (0)
     , currentNumChannels    (0)
@@ -37,7 +39,10 @@ FileReader::FileReader()
     , currentNumSamples     (0)
     , startSample           (0)
     , stopSample            (0)
+    , readPosition          (0)
+    , readAheadTime         (1.0f)
     , counter               (0)
+    , readAheadFifo         (BUFFER_SIZE)
 {
     enabledState (false);
 
@@ -60,6 +65,7 @@ FileReader::FileReader()
 
 FileReader::~FileReader()
 {
+    stopThread (1000);
 }
 
 
@@ -124,6 +130,42 @@ void FileReader::enabledState (bool t)
 }
 
 
+bool FileReader::enable()
+{
+    if (! input)
+        return false;
+
+    // the fifo holds one sample less than its total size
+    const int readAheadSize = jmax (4 * BUFFER_SIZE, int (readAheadTime * currentSampleRate)) + 1;
+
+    readAheadBuffer.setSize (currentNumChannels, readAheadSize);
+    readAheadPointers.malloc (currentNumChannels);
+    readAheadFifo.setTotalSize (readAheadSize);
+    readAheadFifo.reset();
+
+    // resume reading from the playhead, and have some data ready for the first blocks
+    readPosition = currentSample;
+    input->seekTo (currentSample);
+
+    while (readAheadFifo.getFreeSpace() >= BUFFER_SIZE
+           && fillReadAheadBuffer() > 0)
+    {
+    }
+
+    startThread();
+
+    return isEnabled;
+}
+
+
+bool FileReader::disable()
+{
+    stopThread (1000);
+
+    return true;
+}
+
+
 bool FileReader::isFileSupported (const String& fileName) const
 {
     const File file (fileName);
@@ -138,7 +180,7 @@ bool FileReader::isFileExtensionSupported (const String& ext) const
     const int index = supportedExtensions[ext] - 1;
     const bool isExtensionSupported = index >= 0;
 
-    return isExtensionSupported;
+    return isExtensionSupported || ext == OPENEPHYS_FILE_EXTENSION;
 }
 
 
@@ -150,7 +192,11 @@ bool FileReader::setFile (String fullpath)
     const int index = supportedExtensions[ext] - 1;
     const bool isExtensionSupported = index >= 0;
 
-    if (isExtensionSupported)
+    if (ext == OPENEPHYS_FILE_EXTENSION)
+    {
+        input = new OpenEphysFileSource();
+    }
+    else if (isExtensionSupported)
     {
         const int index = supportedExtensions[ext] - 1;
         Plugin::FileSourceInfo sourceInfo = AccessClass::getPluginManager()->getFileSourceInfo (index);
@@ -238,35 +284,32 @@ void FileReader::process (AudioSampleBuffer& buffer, MidiBuffer& events)
     // FIXME: needs to account for the fact that the ratio might not be an exact
     //        integer value
 
-    int samplesRead = 0;
+    int start1, size1, start2, size2;
+    readAheadFifo.prepareToRead (samplesNeeded, start1, size1, start2, size2);
 
-    while (samplesRead < samplesNeeded)
+    for (int i = 0; i < currentNumChannels; ++i)
     {
-        int samplesToRead = samplesNeeded - samplesRead;
-        if ( (currentSample + samplesToRead) > stopSample)
-        {
-            samplesToRead = stopSample - currentSample;
-            if (samplesToRead > 0)
-                input->readData (readBuffer + samplesRead, samplesToRead);
-
-            input->seekTo (startSample);
-            currentSample = startSample;
-        }
-        else
-        {
-            input->readData (readBuffer + samplesRead, samplesToRead);
+        buffer.copyFrom (i, 0, readAheadBuffer, i, start1, size1);
 
-            currentSample += samplesToRead;
-        }
-
-        samplesRead += samplesToRead;
+        if (size2 > 0)
+            buffer.copyFrom (i, size1, readAheadBuffer, i, start2, size2);
     }
 
-    for (int i = 0; i < currentNumChannels; ++i)
+    const int samplesRead = size1 + size2;
+    readAheadFifo.finishedRead (samplesRead);
+    notify();
+
+    // if the reader thread has fallen behind, play silence rather than stall the signal chain
+    if (samplesRead < samplesNeeded)
     {
-        input->processChannelData (readBuffer, buffer.getWritePointer (i, 0), i, samplesNeeded);
+        for (int i = 0; i < currentNumChannels; ++i)
+            buffer.clear (i, samplesRead, samplesNeeded - samplesRead);
     }
 
+    currentSample += samplesRead;
+    if (currentSample >= stopSample && stopSample > startSample)
+        currentSample = startSample + (currentSample - stopSample) % (stopSample - startSample);
+
     timestamp += samplesNeeded;
     setNumSamples (events, samplesNeeded);
 
@@ -301,6 +344,85 @@ void FileReader::process (AudioSampleBuffer& buffer, MidiBuffer& events)
 }
 
 
+void FileReader::run()
+{
+    while (! threadShouldExit())
+    {
+        // process() wakes the thread up each time it takes data out
+        if (readAheadFifo.getFreeSpace() < BUFFER_SIZE
+            || fillReadAheadBuffer() == 0)
+        {
+            wait (10);
+        }
+    }
+}
+
+
+int FileReader::fillReadAheadBuffer()
+{
+    int start1, size1, start2, size2;
+    readAheadFifo.prepareToWrite (BUFFER_SIZE, start1, size1, start2, size2);
+
+    const int samplesRead = readSamples (readBuffer, size1 + size2);
+
+    // de-interleave and scale all the channels in one pass over the read buffer
+    const int samplesToStart1 = jmin (samplesRead, size1);
+
+    for (int i = 0; i < currentNumChannels; ++i)
+        readAheadPointers[i] = readAheadBuffer.getWritePointer (i, start1);
+
+    input->processAllChannelData (readBuffer, readAheadPointers, samplesToStart1);
+
+    if (samplesRead > size1)
+    {
+        for (int i = 0; i < currentNumChannels; ++i)
+            readAheadPointers[i] = readAheadBuffer.getWritePointer (i, start2);
+
+        input->processAllChannelData (readBuffer + size1 * currentNumChannels, readAheadPointers, samplesRead - size1);
+    }
+
+    readAheadFifo.finishedWrite (samplesRead);
+
+    return samplesRead;
+}
+
+
+int FileReader::readSamples (int16* dest, int numSamples)
+{
+    int samplesRead = 0;
+
+    while (samplesRead < numSamples)
+    {
+        int samplesToRead = numSamples - samplesRead;
+        if ( (readPosition + samplesToRead) > stopSample)
+        {
+            samplesToRead = int (stopSample - readPosition);
+            if (samplesToRead > 0)
+                samplesToRead = input->readData (dest + samplesRead * currentNumChannels, samplesToRead);
+
+            input->seekTo (startSample);
+            readPosition = startSample;
+
+            if (stopSample <= startSample)
+                break;
+        }
+        else
+        {
+            samplesToRead = input->readData (dest + samplesRead * currentNumChannels, samplesToRead);
+
+            if (samplesToRead <= 0)
+                break;
+
+            readPosition += samplesToRead;
+        }
+
+        samplesRead += jmax (0, samplesToRead);
+    }
+
+    return samplesRead;
+}
+
+
 void FileReader::setParameter (int parameterIndex, float newValue)
 {
     switch (parameterIndex)
@@ -325,6 +447,39 @@ void FileReader::setParameter (int parameterIndex, float newValue)
 
             static_cast<FileReaderEditor*> (getEditor())->setCurrentTime (samplesToMilliseconds (currentSample));
             break;
+
+        //set the read-ahead time, in seconds (takes effect at the next acquisition start)
+        case 3:
+            readAheadTime = newValue;
+
+            static_cast<FileReaderEditor*> (getEditor())->setReadAheadTime (readAheadTime);
+            break;
+    }
+}
+
+
+float FileReader::getReadAheadTime() const
+{
+    return readAheadTime;
+}
+
+
+void FileReader::saveCustomParametersToXml (XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement ("FILEREADER");
+    mainNode->setAttribute ("readAheadTime", readAheadTime);
+}
+
+
+void FileReader::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement (*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName ("FILEREADER"))
+                setParameter (3, mainNode->getDoubleAttribute ("readAheadTime", readAheadTime));
+        }
     }
 }
 
@@ -33,15 +33,23 @@
 
 #define BUFFER_SIZE 1024
 
+// read by the File Reader itself, rather than by a FileSource plugin
+#define OPENEPHYS_FILE_EXTENSION "openephys"
+
 /**
 
   Reads data from a file.
 
+  While acquisition is running, a background thread keeps the next
+  readAheadTime seconds of the file decoded into a ring buffer, so
+  process() only has to copy samples out of it and never waits on the disk.
+
   @see GenericProcessor
 
 */
 
-class FileReader : public GenericProcessor
+class FileReader : public GenericProcessor,
+                   private Thread
 {
 public:
     FileReader();
@@ -67,9 +75,18 @@ public:
     void updateSettings()       override;
     void enabledState (bool t)  override;
 
+    bool enable()   override;
+    bool disable()  override;
+
     String getFile() const;
     bool setFile (String fullpath);
 
+    /** Seconds of the file kept decoded ahead of the playhead, set with parameter 3. */
+    float getReadAheadTime() const;
+
+    void saveCustomParametersToXml (XmlElement* parentElement) override;
+    void loadCustomParametersFromXml() override;
+
     bool isFileSupported          (const String& filename) const;
     bool isFileExtensionSupported (const String& ext) const;
 
@@ -77,6 +94,17 @@ public:
 private:
     void setActiveRecording (int index);
 
+    /** Reads from the file into the ring buffer, as long as it has space. */
+    void run() override;
+
+    /** Reads up to BUFFER_SIZE samples into the free part of the ring buffer,
+        and returns the number of samples added. */
+    int fillReadAheadBuffer();
+
+    /** Reads interleaved samples from the file, looping from stopSample
+        back to startSample. Returns the number of samples read. */
+    int readSamples (int16* dest, int numSamples);
+
     unsigned int samplesToMilliseconds (int64 samples)  const;
     int64 millisecondsToSamples (unsigned int ms)       const;
 
@@ -89,6 +117,8 @@ private:
     int64 currentNumSamples;
     int64 startSample;
     int64 stopSample;
+    int64 readPosition;
+    float readAheadTime;
     Array<RecordedChannelInfo> channelInfo;
 
     // for testing purposes only
@@ -98,6 +128,10 @@ private:
 
     HeapBlock<int16> readBuffer;
 
+    AbstractFifo readAheadFifo;
+    AudioSampleBuffer readAheadBuffer;
+    HeapBlock<float*> readAheadPointers;
+
     HashMap<String, int> supportedExtensions;
 
 
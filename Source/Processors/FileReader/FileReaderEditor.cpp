@@ -50,6 +50,17 @@ FileReaderEditor::FileReaderEditor (GenericProcessor* parentNode, bool useDefaul
     recordSelector->addListener (this);
     addAndMakeVisible (recordSelector);
 
+    readAheadLabel = new Label ("ReadAheadLabel");
+    readAheadLabel->setBounds (152, 50, 26, 20);
+    readAheadLabel->setEditable (true);
+    readAheadLabel->setFont (Font ("Small Text", 10, Font::plain));
+    readAheadLabel->setColour (Label::backgroundColourId, Colours::lightgrey);
+    readAheadLabel->setColour (Label::outlineColourId,    Colours::black);
+    readAheadLabel->setTooltip ("Seconds of the file read ahead of playback");
+    readAheadLabel->addListener (this);
+    addAndMakeVisible (readAheadLabel);
+    setReadAheadTime (fileReader->getReadAheadTime());
+
     currentTime = new DualTimeComponent (this, false);
     currentTime->setBounds (5, 80, 175, 20);
     addAndMakeVisible (currentTime);
@@ -165,6 +176,27 @@ void FileReaderEditor::setCurrentTime (unsigned int ms)
 }
 
 
+void FileReaderEditor::setReadAheadTime (float seconds)
+{
+    readAheadLabel->setText (String (seconds, 1) + " s", dontSendNotification);
+}
+
+
+void FileReaderEditor::labelTextChanged (Label* label)
+{
+    const float seconds = label->getText().getFloatValue();
+
+    if (seconds < 0.1f || seconds > 60.0f)
+    {
+        CoreServices::sendStatusMessage ("Read-ahead time must be between 0.1 and 60 seconds.");
+        setReadAheadTime (fileReader->getReadAheadTime());
+        return;
+    }
+
+    fileReader->setParameter (3, seconds);
+}
+
+
 void FileReaderEditor::comboBoxChanged (ComboBox* combo)
 {
     fileReader->setParameter (0, combo->getSelectedId() - 1);
@@ -205,6 +237,7 @@ void FileReaderEditor::startAcquisition()
 {
     recordSelector->setEnabled (false);
     timeLimits->setEnable (false);
+    readAheadLabel->setEnabled (false);
 
     GenericEditor::startAcquisition();
 }
@@ -214,6 +247,7 @@ void FileReaderEditor::stopAcquisition()
 {
     recordSelector->setEnabled (true);
     timeLimits->setEnable (true);
+    readAheadLabel->setEnabled (true);
 
     GenericEditor::stopAcquisition();
 }
@@ -43,6 +43,7 @@ class FileSource;
 class FileReaderEditor  : public GenericEditor
                         , public FileDragAndDropTarget
                         , public ComboBox::Listener
+                        , public Label::Listener
 {
 public:
     FileReaderEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
@@ -66,6 +67,7 @@ public:
     bool setPlaybackStopTime  (unsigned int ms);
     void setTotalTime   (unsigned int ms);
     void setCurrentTime (unsigned int ms);
+    void setReadAheadTime (float seconds);
 
     void startAcquisition() override;
     void stopAcquisition()  override;
@@ -73,6 +75,7 @@ public:
     void setFile (String file);
 
     void comboBoxChanged (ComboBox* combo);
+    void labelTextChanged (Label* label) override;
     void populateRecordings (FileSource* source);
 
 
@@ -85,6 +88,7 @@ private:
     ScopedPointer<ComboBox>             recordSelector;
     ScopedPointer<DualTimeComponent>    currentTime;
     ScopedPointer<DualTimeComponent>    timeLimits;
+    ScopedPointer<Label>                readAheadLabel;
 
     FileReader* fileReader;
     unsigned int recTotalTime;
@@ -141,6 +141,16 @@ bool FileSource::OpenFile (File file)
     return fileOpened;
 }
 
+void FileSource::processAllChannelData (int16* inBuffer, float** outBuffers, int64 numSamples)
+{
+    const int numChannels = getActiveNumChannels();
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        processChannelData (inBuffer, outBuffers[i], i, numSamples);
+    }
+}
+
 bool FileSource::isReady()
 {
 	return true;
@@ -65,6 +65,11 @@ public:
 
     virtual int readData (int16* buffer, int nSamples) = 0;
     virtual void processChannelData (int16* inBuffer, float* outBuffer, int channel, int64 numSamples) = 0;
+
+    /** Converts numSamples interleaved samples of every channel, writing each channel
+        to its own output buffer. By default calls processChannelData() for each channel;
+        sources can override it to do the whole conversion in a single pass. */
+    virtual void processAllChannelData (int16* inBuffer, float** outBuffers, int64 numSamples);
     virtual void seekTo (int64 sample) = 0;
 
 	virtual bool isReady();
@@ -0,0 +1,256 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "OpenEphysFileSource.h"
+
+
+OpenEphysFileSource::OpenEphysFileSource()
+    : samplePos (0)
+{
+}
+
+
+OpenEphysFileSource::~OpenEphysFileSource()
+{
+}
+
+
+bool OpenEphysFileSource::Open (File file)
+{
+    XmlDocument doc (file);
+    ScopedPointer<XmlElement> xml = doc.getDocumentElement();
+
+    if (xml == nullptr || ! xml->hasTagName ("EXPERIMENT"))
+    {
+        std::cout << file.getFileName() << " is not an Open Ephys experiment file." << std::endl;
+        return false;
+    }
+
+    experimentXml = xml;
+    directory = file.getParentDirectory();
+
+    return true;
+}
+
+
+MemoryMappedFile* OpenEphysFileSource::getMappedFile (const File& file)
+{
+    const int index = mappedFileNames.indexOf (file.getFullPathName());
+
+    if (index >= 0)
+        return mappedFiles[index];
+
+    ScopedPointer<MemoryMappedFile> mapped = new MemoryMappedFile (file, MemoryMappedFile::readOnly);
+
+    if (mapped->getData() == nullptr)
+    {
+        std::cout << "Could not map " << file.getFullPathName() << std::endl;
+        return nullptr;
+    }
+
+    mappedFileNames.add (file.getFullPathName());
+
+    return mappedFiles.add (mapped.release());
+}
+
+
+void OpenEphysFileSource::fillRecordInfo()
+{
+    // a file can hold several recordings, each one ending where the next one starts
+    StringArray startFileNames;
+    OwnedArray<SortedSet<int64> > startPositions;
+
+    forEachXmlChildElementWithTagName (*experimentXml, recording, "RECORDING")
+    {
+        forEachXmlChildElementWithTagName (*recording, processor, "PROCESSOR")
+        {
+            forEachXmlChildElementWithTagName (*processor, channel, "CHANNEL")
+            {
+                const String fileName = channel->getStringAttribute ("filename");
+                int index = startFileNames.indexOf (fileName);
+
+                if (index < 0)
+                {
+                    index = startFileNames.size();
+                    startFileNames.add (fileName);
+                    startPositions.add (new SortedSet<int64>());
+                }
+
+                startPositions[index]->add ((int64) channel->getDoubleAttribute ("position"));
+            }
+        }
+    }
+
+    forEachXmlChildElementWithTagName (*experimentXml, recording, "RECORDING")
+    {
+        const int numProcessors = recording->getNumChildElements();
+
+        forEachXmlChildElementWithTagName (*recording, processor, "PROCESSOR")
+        {
+            RecordInfo info;
+            info.name = "Recording " + recording->getStringAttribute ("number");
+            if (numProcessors > 1)
+                info.name += ", processor " + processor->getStringAttribute ("id");
+            info.sampleRate = float (recording->getDoubleAttribute ("samplerate"));
+
+            ScopedPointer<RecordData> data = new RecordData();
+            int64 numBlocks = -1;
+
+            forEachXmlChildElementWithTagName (*processor, channel, "CHANNEL")
+            {
+                const String fileName = channel->getStringAttribute ("filename");
+                MemoryMappedFile* mapped = getMappedFile (directory.getChildFile (fileName));
+
+                if (mapped == nullptr)
+                {
+                    numBlocks = -1;
+                    break;
+                }
+
+                const int64 start = (int64) channel->getDoubleAttribute ("position");
+                int64 end = (int64) mapped->getSize();
+
+                const SortedSet<int64>& starts = *startPositions[startFileNames.indexOf (fileName)];
+                const int next = starts.indexOf (start) + 1;
+                if (next < starts.size())
+                    end = jmin (end, starts[next]);
+
+                const int64 channelBlocks = jmax (int64 (0), end - start) / OPENEPHYS_RECORD_SIZE;
+                const char* channelData = static_cast<const char*> (mapped->getData()) + start;
+
+                // check that the first record is laid out as expected
+                if (channelBlocks > 0)
+                {
+                    const char* marker = channelData + OPENEPHYS_RECORD_SIZE - 10;
+                    bool valid = ByteOrder::littleEndianShort (channelData + 8) == OPENEPHYS_BLOCK_LENGTH;
+
+                    for (int i = 0; i < 9; i++)
+                        valid = valid && marker[i] == i;
+                    valid = valid && uint8 (marker[9]) == 255;
+
+                    if (! valid)
+                    {
+                        std::cout << "Unexpected record format in " << fileName << std::endl;
+                        numBlocks = -1;
+                        break;
+                    }
+                }
+
+                numBlocks = (numBlocks < 0) ? channelBlocks : jmin (numBlocks, channelBlocks);
+                data->channelData.add (channelData);
+
+                RecordedChannelInfo c;
+                c.name = channel->getStringAttribute ("name");
+                c.bitVolts = float (channel->getDoubleAttribute ("bitVolts", 1.0));
+                info.channels.add (c);
+            }
+
+            if (numBlocks > 0)
+            {
+                info.numSamples = numBlocks * OPENEPHYS_BLOCK_LENGTH;
+                infoArray.add (info);
+                recordData.add (data.release());
+                numRecords++;
+            }
+        }
+    }
+}
+
+
+void OpenEphysFileSource::updateActiveRecord()
+{
+    samplePos = 0;
+
+    activeBitVolts.clearQuick();
+    for (int i = 0; i < getActiveNumChannels(); i++)
+        activeBitVolts.add (getChannelInfo (i).bitVolts);
+}
+
+
+void OpenEphysFileSource::seekTo (int64 sample)
+{
+    samplePos = sample % getActiveNumSamples();
+}
+
+
+int OpenEphysFileSource::readData (int16* buffer, int nSamples)
+{
+    const RecordData* data = recordData[activeRecord];
+    const int numChannels = getActiveNumChannels();
+    const int samplesToRead = int (jmin (int64 (nSamples), getActiveNumSamples() - samplePos));
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        const char* channelData = data->channelData.getUnchecked (ch);
+        int64 pos = samplePos;
+        int samplesRead = 0;
+
+        while (samplesRead < samplesToRead)
+        {
+            // records hold a 12-byte header, the big-endian samples, and a 10-byte marker
+            const int64 block = pos / OPENEPHYS_BLOCK_LENGTH;
+            const int offset = int (pos % OPENEPHYS_BLOCK_LENGTH);
+            const int n = jmin (samplesToRead - samplesRead, OPENEPHYS_BLOCK_LENGTH - offset);
+
+            const char* src = channelData + block * OPENEPHYS_RECORD_SIZE + 12 + 2 * offset;
+            int16* dest = buffer + samplesRead * numChannels + ch;
+
+            for (int i = 0; i < n; i++)
+                dest[i * numChannels] = (int16) ByteOrder::bigEndianShort (src + 2 * i);
+
+            samplesRead += n;
+            pos += n;
+        }
+    }
+
+    samplePos += samplesToRead;
+
+    return samplesToRead;
+}
+
+
+void OpenEphysFileSource::processChannelData (int16* inBuffer, float* outBuffer, int channel, int64 numSamples)
+{
+    const int n = getActiveNumChannels();
+    const float bitVolts = activeBitVolts[channel];
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        outBuffer[i] = inBuffer[n * i + channel] * bitVolts;
+    }
+}
+
+
+void OpenEphysFileSource::processAllChannelData (int16* inBuffer, float** outBuffers, int64 numSamples)
+{
+    const int n = getActiveNumChannels();
+    const float* bitVolts = activeBitVolts.getRawDataPointer();
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        const int16* frame = inBuffer + n * i;
+
+        for (int j = 0; j < n; j++)
+            outBuffers[j][i] = frame[j] * bitVolts[j];
+    }
+}
@@ -0,0 +1,94 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef OPENEPHYSFILESOURCE_H_INCLUDED
+#define OPENEPHYSFILESOURCE_H_INCLUDED
+
+#include "FileSource.h"
+
+#define OPENEPHYS_HEADER_SIZE 1024
+#define OPENEPHYS_BLOCK_LENGTH 1024
+#define OPENEPHYS_RECORD_SIZE (8 + 2 + 2 + 2*OPENEPHYS_BLOCK_LENGTH + 10)
+
+/**
+
+  Reads the .continuous files written by the Open Ephys record engine.
+
+  The Continuous_Data.openephys file of an experiment lists, for each
+  recording, the channel files and the offset where the recording starts
+  in each of them. Every recording of every processor becomes one record
+  of this source.
+
+  The channel files are memory-mapped when the experiment is opened. Since
+  every record holds OPENEPHYS_BLOCK_LENGTH samples, the position of any
+  sample in a file is computed directly, so seeking costs nothing and
+  readData() copies straight out of the mapped pages.
+
+  @see FileSource, OriginalRecording
+
+*/
+
+class OpenEphysFileSource : public FileSource
+{
+public:
+    OpenEphysFileSource();
+    ~OpenEphysFileSource();
+
+    int readData (int16* buffer, int nSamples) override;
+
+    void seekTo (int64 sample) override;
+
+    void processChannelData (int16* inBuffer, float* outBuffer, int channel, int64 numSamples) override;
+
+    void processAllChannelData (int16* inBuffer, float** outBuffers, int64 numSamples) override;
+
+private:
+    bool Open (File file) override;
+    void fillRecordInfo() override;
+    void updateActiveRecord() override;
+
+    /** Returns the mapped contents of a channel file, mapping it the first time. */
+    MemoryMappedFile* getMappedFile (const File& file);
+
+    /** Where each channel of a record starts in its mapped file. */
+    struct RecordData
+    {
+        Array<const char*> channelData;
+    };
+
+    ScopedPointer<XmlElement> experimentXml;
+    File directory;
+
+    OwnedArray<MemoryMappedFile> mappedFiles;
+    StringArray mappedFileNames;
+
+    OwnedArray<RecordData> recordData;
+
+    Array<float> activeBitVolts;
+    int64 samplePos;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OpenEphysFileSource);
+};
+
+
+#endif  // OPENEPHYSFILESOURCE_H_INCLUDED
@@ -31,10 +31,20 @@ GenericProcessor::GenericProcessor(const String& name_) :
     sourceNode(0), destNode(0), isEnabled(true), wasConnected(false),
     nextAvailableChannel(0), saveOrder(-1), loadOrder(-1), currentChannel(-1),
     editor(0), parametersAsXml(nullptr), sendSampleCount(true), name(name_),
-    paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false)
+    paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false),
+    eventBytesAdded(0)
 {
     settings.numInputs = settings.numOutputs = settings.sampleRate = 0;
 
+    // every source node ID fits in one byte, so the slots never need to grow
+    // past this during acquisition
+    sourceInfo.ensureStorageAllocated(257);
+    SourceBlockInfo emptyInfo = { 0, 0 };
+    sourceInfo.add(emptyInfo);
+
+    for (int i = 0; i < 256; i++)
+        sourceSlots[i] = 0;
+
 }
 
 GenericProcessor::~GenericProcessor()
@@ -453,6 +463,11 @@ void GenericProcessor::update()
 
     updateSettings(); // allow processors to change custom settings
 
+    channelSourceSlots.clearQuick();
+
+    for (int i = 0; i < channels.size(); i++)
+        channelSourceSlots.add(getSourceSlot(channels[i]->sourceNodeId));
+
     // required for the ProcessorGraph to know the
     // details of this processor:
     setPlayConfigDetails(getNumInputs(),  // numIns
@@ -522,27 +537,12 @@ void GenericProcessor::disableEditor()
 /** Used to get the number of samples in a given buffer, for a given channel. */
 int GenericProcessor::getNumSamples(int channelNum)
 {
-    int sourceNodeId, nSamples;
-
-    if (channelNum >= 0 && channelNum < channels.size())
-        sourceNodeId = channels[channelNum]->sourceNodeId;
+    if (channelNum >= 0 && channelNum < channelSourceSlots.size())
+        return sourceInfo.getReference(channelSourceSlots.getUnchecked(channelNum)).numSamples;
+    else if (channelNum >= 0 && channelNum < channels.size())
+        return getNumSourceSamples(channels[channelNum]->sourceNodeId);
     else
         return 0;
-
-    // std::cout << "Requesting samples for channel " << channelNum << " with source node " << sourceNodeId << std::endl;
-
-    try
-    {
-        nSamples = numSamples.at(sourceNodeId);
-    }
-    catch (std::exception& e)
-    {
-        return 0;
-    }
-
-    //std::cout << nSamples << " were found." << std::endl;
-
-    return nSamples;
 }
 
 
@@ -577,24 +577,37 @@ void GenericProcessor::setNumSamples(MidiBuffer& events, int sampleIndex)
 /** Used to get the timestamp for a given buffer, for a given source node. */
 int64 GenericProcessor::getTimestamp(int channelNum)
 {
-    int sourceNodeId;
-    int64 ts;
-
-    if (channelNum >= 0 && channelNum < channels.size())
-        sourceNodeId = channels[channelNum]->sourceNodeId;
+    if (channelNum >= 0 && channelNum < channelSourceSlots.size())
+        return sourceInfo.getReference(channelSourceSlots.getUnchecked(channelNum)).timestamp;
+    else if (channelNum >= 0 && channelNum < channels.size())
+        return getSourceTimestamp(channels[channelNum]->sourceNodeId);
     else
         return 0;
+}
 
-    try
-    {
-        ts = timestamps.at(sourceNodeId);
-    }
-    catch (std::exception& e)
+int GenericProcessor::getNumSourceSamples(int sourceNodeId) const
+{
+    return sourceInfo.getReference(sourceSlots[(uint8) sourceNodeId]).numSamples;
+}
+
+int64 GenericProcessor::getSourceTimestamp(int sourceNodeId) const
+{
+    return sourceInfo.getReference(sourceSlots[(uint8) sourceNodeId]).timestamp;
+}
+
+int GenericProcessor::getSourceSlot(int sourceNodeId)
+{
+    // events carry the source node ID in a single byte
+    int& slot = sourceSlots[(uint8) sourceNodeId];
+
+    if (slot == 0)
     {
-        return 0;
+        slot = sourceInfo.size();
+        SourceBlockInfo emptyInfo = { 0, 0 };
+        sourceInfo.add(emptyInfo);
     }
 
-    return ts;
+    return slot;
 }
 
 /** Used to set the timestamp for a given buffer, for a given channel. */
@@ -618,8 +631,8 @@ void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp)
              true    // isTimestampEvent
             );
 
-    //since the processor generating the timestamp won't get the event, add it to the map
-    timestamps[nodeId] = timestamp;
+    //since the processor generating the timestamp won't get the event, add it to the table
+    sourceInfo.getReference(getSourceSlot(nodeId)).timestamp = timestamp;
 
     if (needsToSendTimestampMessage)
     {
@@ -682,7 +695,7 @@ int GenericProcessor::processEventBuffer(MidiBuffer& events)
                 uint8 sourceNodeId;
                 memcpy(&sourceNodeId, dataptr + 1, 1);
 
-                numSamples[sourceNodeId] = numRead;
+                sourceInfo.getReference(getSourceSlot(sourceNodeId)).numSamples = numRead;
 
                 //if (nodeId < 900)
                 //    std::cout << nodeId << " got " << numRead << " samples for " << (int) sourceNodeId << std::endl;
@@ -697,7 +710,7 @@ int GenericProcessor::processEventBuffer(MidiBuffer& events)
                 uint8 sourceNodeId;
                 memcpy(&sourceNodeId, dataptr + 1, 1);
 
-                timestamps[sourceNodeId] = ts;
+                sourceInfo.getReference(getSourceSlot(sourceNodeId)).timestamp = ts;
 
                 //if (nodeId < 900)
                 //    std::cout << nodeId << " got " << ts << " timestamp for " << (int) sourceNodeId << std::endl;
@@ -769,8 +782,9 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
     if (!isTimestamp && !timestampSet && !isSource() && !generatesTimestamps())
         setTimestamp(eventBuffer, getTimestamp(0));
 
-	HeapBlock<uint8> data(static_cast<const size_t>(6 + numBytes));
-    //uint8* data = new uint8[6+numBytes];
+    // numBytes is a uint8, so every event fits in a small stack buffer and
+    // nothing is allocated on the audio thread
+    uint8 data[6 + 255];
 
     data[0] = type;    // event type
     data[1] = nodeId;  // processor ID automatically added
@@ -807,10 +821,20 @@ void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& event
     processEventBuffer(eventBuffer); // extract buffer sizes and timestamps,
     // set flag on all TTL events to zero
 
+    // Make room for twice as many event bytes as this processor added last
+    // time, so a burst of events is stored without growing the buffer one
+    // event at a time. This is a no-op once the buffer is large enough.
+    const int eventBytesIn = eventBuffer.data.size();
+
+    if (eventBytesAdded > 0)
+        eventBuffer.ensureSize((size_t)(eventBytesIn + 2 * eventBytesAdded));
+
     timestampSet = false;
 
     process(buffer, eventBuffer);
 
+    eventBytesAdded = jmax(0, eventBuffer.data.size() - eventBytesIn);
+
 }
 
 
@@ -488,11 +488,36 @@ public:
     /** Used to set the timestamp for a given buffer, for a given source node. */
     void setTimestamp(MidiBuffer&, int64 timestamp);
 
-    std::map<uint8, int> numSamples;
-    std::map<uint8, int64> timestamps;
+    /** Returns the number of samples in the current buffer for a given source node,
+        or 0 if that node hasn't sent a buffer size yet. */
+    int getNumSourceSamples(int sourceNodeId) const;
+
+    /** Returns the timestamp of the current buffer for a given source node,
+        or 0 if that node hasn't sent a timestamp yet. */
+    int64 getSourceTimestamp(int sourceNodeId) const;
 
 private:
 
+    /** Sample count and timestamp of the current buffer for one source node. */
+    struct SourceBlockInfo
+    {
+        int numSamples;
+        int64 timestamp;
+    };
+
+    /** Returns the slot of a source node in sourceInfo, adding one if needed.*/
+    int getSourceSlot(int sourceNodeId);
+
+    /** Per-source sample counts and timestamps, filled in by processEventBuffer().
+        Slot 0 stays empty and stands for sources that haven't sent anything.*/
+    Array<SourceBlockInfo> sourceInfo;
+
+    /** Slot in sourceInfo for each source node ID, as carried by the events.*/
+    int sourceSlots[256];
+
+    /** Slot in sourceInfo for the source node of each channel, resolved in update().*/
+    Array<int> channelSourceSlots;
+
     /** Automatically extracts the number of samples in the buffer, then
     calls the process(), where custom actions take place.*/
     virtual void processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
@@ -515,6 +540,10 @@ private:
 
     bool timestampSet;
 
+    /** Number of event bytes added by process() in the previous block, used
+        to reserve space in the event buffer before the next one.*/
+    int eventBytesAdded;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GenericProcessor);
 
 };
@@ -330,7 +330,7 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
         int ttl_source = dataptr[1];
         bool ttl_raise = dataptr[2] > 0;
         int channel = dataptr[3]; // channel number
-        int64 ttl_timestamp_hardware = timestamps[ttl_source] + samplePosition; // hardware time
+        int64 ttl_timestamp_hardware = getSourceTimestamp(ttl_source) + samplePosition; // hardware time
         int64 ttl_timestamp_software = timer.getHighResolutionTicks(); // get software time
         //int64  ttl_timestamp_software,ttl_timestamp_hardware;
         //memcpy(&ttl_timestamp_software, dataptr+4, 8);
@@ -342,14 +342,11 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
 
     if (eventType == SPIKE)
     {
-        const uint8_t* dataptr = event.getRawData();
+        const SpikeObject* spike = getSpikeFromEvent(event);
 
-        int bufferSize = event.getRawDataSize();
-
-        if (bufferSize > 0)
+        if (spike != nullptr)
         {
-            SpikeObject newSpike;
-            unpackSpike(&newSpike, dataptr, bufferSize);
+            const SpikeObject& newSpike = *spike;
 
             if (newSpike.sortedId > 0)   // drop unsorted spikes
             {
@@ -301,7 +301,7 @@ public:
     void modifyConditionVisibility(int cond, bool newstate);
     void modifyConditionVisibilityusingConditionID(int condID, bool newstate);
     bool parseMessage(StringTS s);
-    void addSpikeToSpikeBuffer(SpikeObject newSpike);
+    void addSpikeToSpikeBuffer(const SpikeObject& newSpike);
     void process(AudioSampleBuffer& buffer,int nSamples,int64 hardware_timestamp,int64 software_timestamp);
     void simulateHardwareTrial(int64 ttl_timestamp_software,int64 ttl_timestamp_hardware, int trialType, float lengthSec);
     //void simulateTrial(int64 ttl_timestamp_software, int trialType, float lengthSec);
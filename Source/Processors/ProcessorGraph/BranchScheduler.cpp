@@ -0,0 +1,437 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BranchScheduler.h"
+
+/**
+  Waits for the start of each block, then renders branches alongside the
+  audio thread until the block is done.
+*/
+class BranchWorker : public Thread
+{
+public:
+    BranchWorker(BranchScheduler& scheduler_, int index)
+        : Thread("Branch worker " + String(index)), scheduler(scheduler_), workerIndex(index)
+    {
+    }
+
+    void run()
+    {
+        while (!threadShouldExit())
+        {
+            wait(-1);
+
+            if (threadShouldExit())
+                break;
+
+            scheduler.runBranches(workerIndex + 1);
+        }
+    }
+
+private:
+    BranchScheduler& scheduler;
+    const int workerIndex;
+};
+
+BranchScheduler::BranchScheduler(AudioProcessorGraph& graph_, int numWorkers)
+    : graph(graph_), maxSamples(0), currentNumSamples(0), maxWorkers(numWorkers),
+      numReady(0), branchesRemaining(0), numIdle(0)
+{
+}
+
+BranchScheduler::~BranchScheduler()
+{
+    release();
+}
+
+void BranchScheduler::release()
+{
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->signalThreadShouldExit();
+
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i]->notify();
+        workers[i]->stopThread(1000);
+    }
+
+    workers.clear();
+    branchReadyEvents.clear();
+    branches.clear();
+    nodes.clear();
+    sinkNodes.clear();
+
+    maxSamples = 0;
+}
+
+bool BranchScheduler::prepare(int maxSamplesPerBlock, const Array<uint32>& sinkNodeIds)
+{
+    release();
+
+    maxSamples = jmax(1, maxSamplesPerBlock);
+
+    const int numNodes = graph.getNumNodes();
+    HashMap<int, int> nodeIndex;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        AudioProcessorGraph::Node* node = graph.getNode(i);
+        AudioProcessor* processor = node->getProcessor();
+
+        RenderNode* r = new RenderNode();
+        r->processor = processor;
+        r->nodeId = node->nodeId;
+        r->numChannels = jmax(1, processor->getNumInputChannels(), processor->getNumOutputChannels());
+        r->isOutput = false;
+
+        typedef AudioProcessorGraph::AudioGraphIOProcessor IOProcessor;
+
+        if (IOProcessor* io = dynamic_cast<IOProcessor*>(processor))
+        {
+            if (io->getType() != IOProcessor::audioOutputNode)
+            {
+                std::cout << "Branch scheduler can't render graph input nodes." << std::endl;
+                delete r;
+                release();
+                return false;
+            }
+
+            r->isOutput = true;
+        }
+
+        r->buffer.setSize(r->numChannels, maxSamples);
+        r->channels.malloc(r->numChannels);
+
+        for (int chan = 0; chan < r->numChannels; chan++)
+            r->channels[chan] = r->buffer.getWritePointer(chan);
+
+        r->view.setDataToReferTo(r->channels, r->numChannels, maxSamples);
+
+        nodes.add(r);
+        nodeIndex.set((int) r->nodeId, i);
+    }
+
+    OwnedArray<Array<int> > predecessors, successors;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        predecessors.add(new Array<int>());
+        successors.add(new Array<int>());
+    }
+
+    for (int i = 0; i < graph.getNumConnections(); i++)
+    {
+        const AudioProcessorGraph::Connection* c = graph.getConnection(i);
+
+        if (!nodeIndex.contains((int) c->sourceNodeId) || !nodeIndex.contains((int) c->destNodeId))
+            continue;
+
+        const int source = nodeIndex[(int) c->sourceNodeId];
+        const int dest = nodeIndex[(int) c->destNodeId];
+
+        if (c->sourceChannelIndex == AudioProcessorGraph::midiChannelIndex)
+        {
+            nodes[dest]->midiInputs.addIfNotAlreadyThere(source);
+        }
+        else
+        {
+            if (c->sourceChannelIndex >= nodes[source]->numChannels
+                || c->destChannelIndex >= nodes[dest]->numChannels)
+                continue;
+
+            AudioInput input;
+            input.sourceNode = source;
+            input.sourceChannel = c->sourceChannelIndex;
+            input.destChannel = c->destChannelIndex;
+            nodes[dest]->audioInputs.add(input);
+        }
+
+        predecessors[dest]->addIfNotAlreadyThere(source);
+        successors[source]->addIfNotAlreadyThere(dest);
+    }
+
+    // topological order
+    Array<int> order;
+    Array<int> inDegree;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        inDegree.add(predecessors[i]->size());
+
+        if (inDegree[i] == 0)
+            order.add(i);
+    }
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        const Array<int>& next = *successors[order[n]];
+
+        for (int i = 0; i < next.size(); i++)
+        {
+            inDegree.set(next[i], inDegree[next[i]] - 1);
+
+            if (inDegree[next[i]] == 0)
+                order.add(next[i]);
+        }
+    }
+
+    if (order.size() != numNodes)
+    {
+        std::cout << "Branch scheduler found a loop in the processor graph." << std::endl;
+        release();
+        return false;
+    }
+
+    Array<bool> isSink;
+
+    for (int i = 0; i < numNodes; i++)
+        isSink.add(nodes[i]->isOutput || sinkNodeIds.contains(nodes[i]->nodeId));
+
+    // split the remaining nodes into branches
+    Array<int> branchOf;
+    branchOf.insertMultiple(0, -1, numNodes);
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        const int node = order[n];
+
+        if (isSink[node])
+        {
+            sinkNodes.add(node);
+            continue;
+        }
+
+        const Array<int>& preds = *predecessors[node];
+
+        for (int i = 0; i < preds.size(); i++)
+        {
+            if (isSink[preds[i]])
+            {
+                std::cout << "Branch scheduler can't render processors fed by "
+                          << nodes[preds[i]]->processor->getName() << "." << std::endl;
+                release();
+                return false;
+            }
+        }
+
+        if (preds.size() == 1)
+        {
+            int numProcessingSuccessors = 0;
+            const Array<int>& succs = *successors[preds[0]];
+
+            for (int i = 0; i < succs.size(); i++)
+                if (!isSink[succs[i]])
+                    numProcessingSuccessors++;
+
+            if (numProcessingSuccessors == 1)
+            {
+                // continues its source's branch
+                branchOf.set(node, branchOf[preds[0]]);
+                branches[branchOf[node]]->nodes.add(node);
+                continue;
+            }
+        }
+
+        Branch* branch = new Branch();
+        branch->nodes.add(node);
+        branch->numDependencies = 0;
+
+        const int index = branches.size();
+        branches.add(branch);
+        branchOf.set(node, index);
+
+        for (int i = 0; i < preds.size(); i++)
+        {
+            Branch* source = branches[branchOf[preds[i]]];
+
+            if (!source->successors.contains(index))
+            {
+                source->successors.add(index);
+                branch->numDependencies++;
+            }
+        }
+    }
+
+    pendingDependencies.calloc(jmax(1, branches.size()));
+    readyBranches.calloc(jmax(1, branches.size()));
+    numReady = 0;
+    branchesRemaining = 0;
+
+    const int numWorkers = jmin(maxWorkers, branches.size() - 1);
+
+    for (int i = 0; i <= numWorkers; i++)
+        branchReadyEvents.add(new WaitableEvent());
+
+    idleThreads.calloc(numWorkers + 1);
+    numIdle = 0;
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        BranchWorker* worker = new BranchWorker(*this, i);
+        workers.add(worker);
+        worker->startThread(8);
+    }
+
+    std::cout << "Branch scheduler: " << branches.size() << " branches, "
+              << sinkNodes.size() << " sink nodes, " << workers.size() << " worker threads." << std::endl;
+
+    return true;
+}
+
+bool BranchScheduler::render(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    if (numSamples > maxSamples)
+        return false;
+
+    currentNumSamples = numSamples;
+
+    {
+        const SpinLock::ScopedLockType lock(queueLock);
+
+        numReady = 0;
+
+        for (int i = 0; i < branches.size(); i++)
+        {
+            pendingDependencies[i] = branches[i]->numDependencies;
+
+            if (pendingDependencies[i] == 0)
+                readyBranches[numReady++] = i;
+        }
+
+        branchesRemaining = branches.size();
+    }
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->notify();
+
+    runBranches(0);
+
+    // barrier: every branch has finished, so the sinks can read all of their inputs
+    buffer.clear();
+
+    for (int i = 0; i < sinkNodes.size(); i++)
+    {
+        RenderNode* node = nodes[sinkNodes[i]];
+
+        renderNode(node, numSamples);
+
+        if (node->isOutput)
+        {
+            for (int chan = 0; chan < jmin(buffer.getNumChannels(), node->numChannels); chan++)
+                buffer.addFrom(chan, 0, node->buffer, chan, 0, numSamples);
+        }
+    }
+
+    midiMessages.clear();
+
+    return true;
+}
+
+void BranchScheduler::runBranches(int thread)
+{
+    for (;;)
+    {
+        int branch = -1;
+
+        {
+            const SpinLock::ScopedLockType lock(queueLock);
+
+            if (branchesRemaining == 0)
+                return;
+
+            if (numReady > 0)
+                branch = readyBranches[--numReady];
+            else
+                idleThreads[numIdle++] = thread;
+        }
+
+        if (branch < 0)
+        {
+            // another thread is still on a branch that the remaining ones depend
+            // on; it wakes us when it's done
+            branchReadyEvents[thread]->wait(-1);
+            continue;
+        }
+
+        renderBranch(branch);
+
+        const SpinLock::ScopedLockType lock(queueLock);
+
+        const Array<int>& next = branches[branch]->successors;
+
+        for (int i = 0; i < next.size(); i++)
+        {
+            if (--pendingDependencies[next[i]] == 0)
+                readyBranches[numReady++] = next[i];
+        }
+
+        --branchesRemaining;
+
+        if (numReady > 0 || branchesRemaining == 0)
+        {
+            for (int i = 0; i < numIdle; i++)
+                branchReadyEvents[idleThreads[i]]->signal();
+
+            numIdle = 0;
+        }
+    }
+}
+
+void BranchScheduler::renderBranch(int branch)
+{
+    const Array<int>& branchNodes = branches[branch]->nodes;
+
+    for (int i = 0; i < branchNodes.size(); i++)
+        renderNode(nodes[branchNodes[i]], currentNumSamples);
+}
+
+void BranchScheduler::renderNode(RenderNode* node, int numSamples)
+{
+    AudioSampleBuffer& buffer = node->view;
+
+    // only (re)allocates, for nodes with more than 32 channels, when the block size changes
+    if (buffer.getNumSamples() != numSamples)
+        buffer.setDataToReferTo(node->channels, node->numChannels, numSamples);
+
+    buffer.clear();
+
+    for (int i = 0; i < node->audioInputs.size(); i++)
+    {
+        const AudioInput& input = node->audioInputs.getReference(i);
+
+        buffer.addFrom(input.destChannel, 0,
+                       nodes[input.sourceNode]->buffer, input.sourceChannel,
+                       0, numSamples);
+    }
+
+    node->midi.clear();
+
+    for (int i = 0; i < node->midiInputs.size(); i++)
+        node->midi.addEvents(nodes[node->midiInputs[i]]->midi, 0, -1, 0);
+
+    // the output node just collects the graph's output channels
+    if (!node->isOutput)
+        node->processor->processBlock(buffer, node->midi);
+}
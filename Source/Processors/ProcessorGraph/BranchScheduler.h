@@ -0,0 +1,158 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BRANCHSCHEDULER_H_9C2D4E61__
+#define __BRANCHSCHEDULER_H_9C2D4E61__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+class BranchWorker;
+
+/**
+
+  Renders the ProcessorGraph with independent branches running in parallel.
+
+  The AudioProcessorGraph renders every node, one after the other, on the
+  audio callback thread. Once a Splitter fans a chain out, or several
+  signal chains are open side by side, most of that work has no ordering
+  constraints at all.
+
+  When the graph is prepared, the BranchScheduler splits the nodes into
+  branches: maximal runs of processors where each one feeds only the next.
+  A branch ends wherever the chain forks or joins, so the paths below a
+  Splitter become separate branches, as does everything below a Merger.
+  The RecordNode, AudioNode and audio output node are kept out of the
+  branches and rendered last, after a barrier.
+
+  Every block, the branches are handed to a pool of worker threads (the
+  audio thread takes part as well); a branch starts as soon as all the
+  branches feeding it have finished. Each node renders into its own
+  buffers, so the channel and event routing is the same as that of the
+  AudioProcessorGraph.
+
+  @see ProcessorGraph
+
+*/
+
+class BranchScheduler
+{
+public:
+    BranchScheduler(AudioProcessorGraph& graph, int numWorkers);
+    ~BranchScheduler();
+
+    /** Builds the branch plan from the graph's current connections.
+
+        The nodes in sinkNodeIds, and the audio output node, are rendered
+        after all of the branches. Returns false if the graph can't be split
+        (for example, because a connection loops back), in which case it
+        should be rendered serially.*/
+    bool prepare(int maxSamplesPerBlock, const Array<uint32>& sinkNodeIds);
+
+    /** Stops the workers and frees the per-node buffers.*/
+    void release();
+
+    /** Renders one block. The graph's audio output is written to buffer.
+
+        Returns false if the block is larger than the prepared size and
+        was not rendered.*/
+    bool render(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+
+    /** Returns the number of branches in the current plan.*/
+    int getNumBranches() const { return branches.size(); }
+
+private:
+
+    struct AudioInput
+    {
+        int sourceNode;
+        int sourceChannel;
+        int destChannel;
+    };
+
+    /** A graph node along with the buffers it renders into.*/
+    struct RenderNode
+    {
+        AudioProcessor* processor;
+        uint32 nodeId;
+        int numChannels;
+        bool isOutput;
+
+        Array<AudioInput> audioInputs;
+        Array<int> midiInputs;
+
+        AudioSampleBuffer buffer;
+        MidiBuffer midi;
+        HeapBlock<float*> channels;
+
+        /** Refers to the buffer's channels, sized to the current block.*/
+        AudioSampleBuffer view;
+    };
+
+    /** A run of nodes that are always rendered in order by a single thread.*/
+    struct Branch
+    {
+        Array<int> nodes;
+        Array<int> successors;
+        int numDependencies;
+    };
+
+    friend class BranchWorker;
+
+    void renderNode(RenderNode* node, int numSamples);
+    void renderBranch(int branch);
+
+    /** Renders ready branches until none are left in the current block.
+
+        Thread 0 is the audio thread and thread i + 1 is worker i.*/
+    void runBranches(int thread);
+
+    AudioProcessorGraph& graph;
+
+    OwnedArray<RenderNode> nodes;
+    OwnedArray<Branch> branches;
+
+    /** Nodes rendered after every branch has finished, in order.*/
+    Array<int> sinkNodes;
+
+    int maxSamples;
+    int currentNumSamples;
+
+    int maxWorkers;
+    OwnedArray<BranchWorker> workers;
+
+    // per-block scheduling state, guarded by queueLock
+    SpinLock queueLock;
+    HeapBlock<int> pendingDependencies;
+    HeapBlock<int> readyBranches;
+    int numReady;
+    int branchesRemaining;
+
+    // threads parked until another one finishes a branch, and their wake-up events
+    OwnedArray<WaitableEvent> branchReadyEvents;
+    HeapBlock<int> idleThreads;
+    int numIdle;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BranchScheduler);
+};
+
+#endif  // __BRANCHSCHEDULER_H_9C2D4E61__
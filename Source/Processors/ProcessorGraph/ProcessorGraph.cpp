@@ -24,6 +24,7 @@
 #include <stdio.h>
 
 #include "ProcessorGraph.h"
+#include "BranchScheduler.h"
 #include "../GenericProcessor/GenericProcessor.h"
 
 #include "../AudioNode/AudioNode.h"
@@ -36,7 +37,7 @@
 
 #include "../ProcessorManager/ProcessorManager.h"
     
-ProcessorGraph::ProcessorGraph() : currentNodeId(100)
+ProcessorGraph::ProcessorGraph() : currentNodeId(100), renderBranchesInParallel(false)
 {
 
     // The ProcessorGraph will always have 0 inputs (all content is generated within graph)
@@ -46,11 +47,62 @@ ProcessorGraph::ProcessorGraph() : currentNodeId(100)
                          44100.0, // sampleRate
                          1024);    // blockSize
 
+    StringArray parameters = JUCEApplication::getCommandLineParameterArray();
+    int index = parameters.indexOf("--parallel-graph");
+
+    if (index >= 0)
+    {
+        // worker threads, in addition to the audio thread
+        int numWorkers = SystemStats::getNumCpus() - 1;
+
+        if (parameters[index + 1].containsOnly("0123456789") && parameters[index + 1].isNotEmpty())
+            numWorkers = parameters[index + 1].getIntValue();
+
+        std::cout << "Rendering signal chain branches with up to " << numWorkers << " worker threads." << std::endl;
+        branchScheduler = new BranchScheduler(*this, jmax(0, numWorkers));
+    }
+
 }
 
 ProcessorGraph::~ProcessorGraph()
 {
+    branchScheduler = nullptr; // stop the workers before the nodes go away
+}
+
+void ProcessorGraph::prepareToPlay(double sampleRate, int estimatedSamplesPerBlock)
+{
+    renderBranchesInParallel = false;
+
+    AudioProcessorGraph::prepareToPlay(sampleRate, estimatedSamplesPerBlock);
+
+    if (branchScheduler != nullptr)
+    {
+        Array<uint32> sinkNodeIds;
+        sinkNodeIds.add(RECORD_NODE_ID);
+        sinkNodeIds.add(AUDIO_NODE_ID);
+
+        renderBranchesInParallel = branchScheduler->prepare(estimatedSamplesPerBlock, sinkNodeIds)
+                                   && branchScheduler->getNumBranches() > 1;
+    }
+}
+
+void ProcessorGraph::releaseResources()
+{
+    renderBranchesInParallel = false;
+
+    if (branchScheduler != nullptr)
+        branchScheduler->release();
+
+    AudioProcessorGraph::releaseResources();
+}
+
+void ProcessorGraph::processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    // blocks larger than the prepared size fall back to the serial renderer
+    if (renderBranchesInParallel && branchScheduler->render(buffer, midiMessages))
+        return;
 
+    AudioProcessorGraph::processBlock(buffer, midiMessages);
 }
 
 void ProcessorGraph::createDefaultNodes()
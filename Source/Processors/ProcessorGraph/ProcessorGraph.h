@@ -29,6 +29,7 @@
 #include "../../AccessClass.h"
 
 class GenericProcessor;
+class BranchScheduler;
 class RecordNode;
 class AudioNode;
 class MessageCenter;
@@ -87,9 +88,24 @@ public:
     void refreshColors();
 
     void createDefaultNodes();
+
+    /** Prepares the graph, along with the branch plan if parallel rendering is on.*/
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+    void releaseResources();
+
+    /** Renders the independent branches of the signal chain on separate threads
+        when the GUI is started with "--parallel-graph [threads]", or all nodes
+        in order on the calling thread otherwise.
+
+        @see BranchScheduler */
+    void processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+
 private:
     int currentNodeId;
 
+    ScopedPointer<BranchScheduler> branchScheduler;
+    bool renderBranchesInParallel;
+
     enum nodeIds
     {
         RECORD_NODE_ID = 900,
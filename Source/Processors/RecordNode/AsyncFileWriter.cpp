@@ -0,0 +1,229 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AsyncFileWriter.h"
+
+/**
+	Writes the buffers submitted to it, in the order they were submitted.
+*/
+class AsyncFileWriterThread : public Thread
+{
+public:
+	AsyncFileWriterThread(AsyncFileWriter& writer, int index)
+		: Thread("Async file writer " + String(index)), m_writer(writer)
+	{
+	}
+
+	void enqueue(int handle, FILE* file, const char* data, int size)
+	{
+		Job job;
+		job.handle = handle;
+		job.file = file;
+		job.data = data;
+		job.size = size;
+
+		{
+			const ScopedLock sl(m_queueLock);
+			m_queue.add(job);
+		}
+		notify();
+	}
+
+	void run() override
+	{
+		while (!threadShouldExit())
+		{
+			writeQueuedBuffers();
+			wait(100);
+		}
+		writeQueuedBuffers();
+	}
+
+private:
+	struct Job
+	{
+		int handle;
+		FILE* file;
+		const char* data;
+		int size;
+	};
+
+	void writeQueuedBuffers()
+	{
+		for (;;)
+		{
+			Job job;
+			{
+				const ScopedLock sl(m_queueLock);
+				if (m_queue.size() == 0)
+					return;
+				job = m_queue.getReference(0);
+				m_queue.remove(0);
+			}
+
+			size_t count = fwrite(job.data, 1, job.size, job.file);
+			m_writer.bufferWritten(job.handle, count == size_t(job.size));
+		}
+	}
+
+	AsyncFileWriter& m_writer;
+	CriticalSection m_queueLock;
+	Array<Job> m_queue;
+};
+
+AsyncFileWriter::AsyncFileWriter(int numThreads, int bufferSize_)
+	: m_bufferSize(bufferSize_)
+{
+	for (int i = 0; i < jmax(1, numThreads); i++)
+	{
+		AsyncFileWriterThread* thread = new AsyncFileWriterThread(*this, i);
+		m_threads.add(thread);
+		thread->startThread();
+	}
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+	flush();
+
+	for (int i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i]->signalThreadShouldExit();
+		m_threads[i]->notify();
+		m_threads[i]->stopThread(5000);
+	}
+}
+
+int AsyncFileWriter::addFile(FILE* file)
+{
+	FileState* state = new FileState();
+	state->file = file;
+	state->current = 0;
+	state->numPending = 0;
+
+	for (int i = 0; i < 2; i++)
+	{
+		state->buffers[i].data.malloc(m_bufferSize);
+		state->buffers[i].size = 0;
+	}
+
+	const ScopedLock sl(m_pendingLock);
+	m_files.add(state);
+	return m_files.size() - 1;
+}
+
+void AsyncFileWriter::write(int handle, const void* data, int size)
+{
+	FileState* state = m_files[handle];
+	const char* source = static_cast<const char*>(data);
+
+	while (size > 0)
+	{
+		StagingBuffer& buffer = state->buffers[state->current];
+		int n = jmin(size, m_bufferSize - buffer.size);
+
+		memcpy(buffer.data + buffer.size, source, n);
+		buffer.size += n;
+		source += n;
+		size -= n;
+
+		if (buffer.size == m_bufferSize)
+			submit(handle);
+	}
+}
+
+void AsyncFileWriter::submit(int handle)
+{
+	FileState* state = m_files[handle];
+	StagingBuffer& buffer = state->buffers[state->current];
+
+	if (buffer.size == 0)
+		return;
+
+	{
+		const ScopedLock sl(m_pendingLock);
+		state->numPending++;
+	}
+	m_threads[handle % m_threads.size()]->enqueue(handle, state->file, buffer.data, buffer.size);
+
+	//Buffers of a file are written in order, so the other one is free once at most one is pending
+	state->current = 1 - state->current;
+	for (;;)
+	{
+		{
+			const ScopedLock sl(m_pendingLock);
+			if (state->numPending < 2)
+				break;
+		}
+		m_bufferFreed.wait(100);
+	}
+	state->buffers[state->current].size = 0;
+}
+
+void AsyncFileWriter::bufferWritten(int handle, bool ok)
+{
+	{
+		const ScopedLock sl(m_pendingLock);
+		m_files[handle]->numPending--;
+	}
+
+	if (ok)
+		++m_numBuffersWritten;
+	else
+		++m_numErrors;
+
+	m_bufferFreed.signal();
+}
+
+void AsyncFileWriter::flush()
+{
+	for (int i = 0; i < m_files.size(); i++)
+		submit(i);
+
+	for (int i = 0; i < m_files.size(); i++)
+	{
+		for (;;)
+		{
+			{
+				const ScopedLock sl(m_pendingLock);
+				if (m_files[i]->numPending == 0)
+					break;
+			}
+			m_bufferFreed.wait(100);
+		}
+		fflush(m_files[i]->file);
+	}
+
+	if (m_numErrors.get() > 0)
+		std::cout << "Async file writer: " << m_numErrors.get() << " buffers could not be written" << std::endl;
+}
+
+int AsyncFileWriter::getNumBuffersWritten() const
+{
+	return m_numBuffersWritten.get();
+}
+
+int AsyncFileWriter::getNumErrors() const
+{
+	return m_numErrors.get();
+}
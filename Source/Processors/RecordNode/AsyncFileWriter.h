@@ -0,0 +1,105 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ASYNCFILEWRITER_H_INCLUDED
+#define ASYNCFILEWRITER_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include <stdio.h>
+
+class AsyncFileWriterThread;
+
+/**
+	Collects many small writes to a set of files into large buffers and
+	writes the full buffers from a pool of background threads.
+
+	Each file gets a pair of staging buffers: one is filled by write() while
+	the other is on its way to disk. Every file is always written by the same
+	thread, so its data reaches the disk in order and the file format is
+	unchanged. If both of a file's buffers are still waiting to be written,
+	write() blocks until one is free, which throttles the caller to the
+	speed of the disk instead of dropping data.
+
+	Used by OriginalRecording to turn the several small fwrite calls per
+	1024-sample record into one write per staging buffer.
+
+	@see OriginalRecording
+*/
+class AsyncFileWriter
+{
+public:
+	AsyncFileWriter(int numThreads, int bufferSize);
+	~AsyncFileWriter();
+
+	/** Hands a file over to the writer and returns the handle to write to it with.
+		The file must not be written to otherwise until flush() has been called. */
+	int addFile(FILE* file);
+
+	/** Copies data into the file's staging buffer, submitting it when full */
+	void write(int handle, const void* data, int size);
+
+	/** Submits every partially filled buffer and waits until all data is on disk */
+	void flush();
+
+	/** Returns the number of buffers written so far */
+	int getNumBuffersWritten() const;
+
+	/** Returns the number of writes that failed */
+	int getNumErrors() const;
+
+private:
+	friend class AsyncFileWriterThread;
+
+	struct StagingBuffer
+	{
+		HeapBlock<char> data;
+		int size;
+	};
+
+	struct FileState
+	{
+		FILE* file;
+		StagingBuffer buffers[2];
+		int current;
+
+		/** Number of this file's buffers queued on or being written by a thread */
+		int numPending;
+	};
+
+	void submit(int handle);
+	void bufferWritten(int handle, bool ok);
+
+	OwnedArray<FileState> m_files;
+	OwnedArray<AsyncFileWriterThread> m_threads;
+	const int m_bufferSize;
+
+	CriticalSection m_pendingLock;
+	WaitableEvent m_bufferFreed;
+
+	Atomic<int> m_numBuffersWritten;
+	Atomic<int> m_numErrors;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AsyncFileWriter);
+};
+
+#endif  // ASYNCFILEWRITER_H_INCLUDED
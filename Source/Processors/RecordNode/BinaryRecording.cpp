@@ -0,0 +1,381 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BinaryRecording.h"
+
+#define EVENT_RECORD_SIZE 12
+
+BinaryRecording::BinaryRecording() : convertBufferSize(0), interleavedBufferSize(0),
+    eventFile(nullptr), messageFile(nullptr), spikeFile(nullptr),
+    experimentNumber(0), recordingNumber(0)
+{
+}
+
+BinaryRecording::~BinaryRecording()
+{
+    //Cleanup just in case
+    for (int i = 0; i < processors.size(); i++)
+    {
+        if (processors[i]->dataFile != nullptr) fclose(processors[i]->dataFile);
+        if (processors[i]->timestampFile != nullptr) fclose(processors[i]->timestampFile);
+    }
+    if (eventFile != nullptr) fclose(eventFile);
+    if (messageFile != nullptr) fclose(messageFile);
+    if (spikeFile != nullptr) fclose(spikeFile);
+}
+
+String BinaryRecording::getEngineID() const
+{
+    return "BINARY";
+}
+
+void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recordingNumber)
+{
+    this->experimentNumber = experimentNumber;
+    this->recordingNumber = recordingNumber;
+    recordFolder = rootFolder;
+
+    processors.clear();
+    channelQueues.clear();
+    processorOfChannel.clear();
+
+    String prefix = "experiment" + String(experimentNumber) + "_recording" + String(recordingNumber);
+
+    for (int i = 0; i < getNumRecordedChannels(); i++)
+    {
+        Channel* ch = getChannel(getRealChannel(i));
+
+        int procIndex = -1;
+        for (int p = 0; p < processors.size(); p++)
+        {
+            if (processors[p]->nodeId == ch->nodeId)
+                procIndex = p;
+        }
+
+        if (procIndex < 0)
+        {
+            ProcessorFiles* proc = new ProcessorFiles();
+            proc->nodeId = ch->nodeId;
+            proc->sampleRate = ch->sampleRate;
+            proc->baseName = prefix + "_" + String(ch->nodeId);
+            proc->dataFile = fopen(rootFolder.getChildFile(proc->baseName + ".dat").getFullPathName().toUTF8(), "wb");
+            proc->timestampFile = fopen(rootFolder.getChildFile(proc->baseName + ".timestamps").getFullPathName().toUTF8(), "wb");
+            proc->numFrames = 0;
+            proc->numTimestamps = 0;
+            proc->timestampSize = 0;
+
+            if (proc->dataFile == nullptr || proc->timestampFile == nullptr)
+                std::cout << "Binary recording: can't open the files for " << proc->baseName << std::endl;
+
+            procIndex = processors.size();
+            processors.add(proc);
+        }
+
+        processors[procIndex]->channels.add(i);
+        processorOfChannel.add(procIndex);
+
+        ChannelQueue* queue = new ChannelQueue();
+        queue->numSamples = 0;
+        queue->size = 0;
+        channelQueues.add(queue);
+    }
+
+    eventFile = fopen(rootFolder.getChildFile(prefix + "_events.dat").getFullPathName().toUTF8(), "wb");
+    messageFile = fopen(rootFolder.getChildFile(prefix + "_messages.txt").getFullPathName().toUTF8(), "wb");
+    spikeFile = fopen(rootFolder.getChildFile(prefix + "_spikes.dat").getFullPathName().toUTF8(), "wb");
+
+    writeHeader();
+}
+
+void BinaryRecording::closeFiles()
+{
+    for (int i = 0; i < processors.size(); i++)
+    {
+        ProcessorFiles* proc = processors[i];
+
+        writeFrames(*proc, true);
+
+        if (proc->dataFile != nullptr)
+        {
+            fclose(proc->dataFile);
+            proc->dataFile = nullptr;
+        }
+        if (proc->timestampFile != nullptr)
+        {
+            fclose(proc->timestampFile);
+            proc->timestampFile = nullptr;
+        }
+    }
+    if (eventFile != nullptr)
+    {
+        fclose(eventFile);
+        eventFile = nullptr;
+    }
+    if (messageFile != nullptr)
+    {
+        fclose(messageFile);
+        messageFile = nullptr;
+    }
+    if (spikeFile != nullptr)
+    {
+        fclose(spikeFile);
+        spikeFile = nullptr;
+    }
+
+    // rewrite the header now that the sample counts are known
+    writeHeader();
+}
+
+void BinaryRecording::writeData(int writeChannel, int realChannel, const float* buffer, int size)
+{
+    if (size > convertBufferSize)
+    {
+        floatBuffer.realloc(size);
+        intBuffer.realloc(size);
+        convertBufferSize = size;
+    }
+
+    // scale the data back into the range of int16
+    float scaleFactor = float(0x7fff) * getChannel(realChannel)->bitVolts;
+
+    for (int n = 0; n < size; n++)
+    {
+        floatBuffer[n] = buffer[n] / scaleFactor;
+    }
+    AudioDataConverters::convertFloatToInt16LE(floatBuffer, intBuffer, size);
+
+    appendSamples(*channelQueues[writeChannel], intBuffer, size);
+
+    // the first channel of each processor provides the frame timestamps
+    ProcessorFiles* proc = processors[processorOfChannel[writeChannel]];
+    if (proc->channels[0] == writeChannel)
+        appendTimestamps(*proc, getTimestamp(writeChannel), size);
+}
+
+void BinaryRecording::endChannelBlock(bool lastBlock)
+{
+    for (int i = 0; i < processors.size(); i++)
+        writeFrames(*processors[i], false);
+}
+
+void BinaryRecording::appendSamples(ChannelQueue& queue, const int16* data, int nSamples)
+{
+    if (queue.numSamples + nSamples > queue.size)
+    {
+        queue.size = queue.numSamples + nSamples;
+        queue.samples.realloc(queue.size);
+    }
+    memcpy(queue.samples + queue.numSamples, data, nSamples * sizeof(int16));
+    queue.numSamples += nSamples;
+}
+
+void BinaryRecording::appendTimestamps(ProcessorFiles& proc, int64 firstTimestamp, int nSamples)
+{
+    if (proc.numTimestamps + nSamples > proc.timestampSize)
+    {
+        proc.timestampSize = proc.numTimestamps + nSamples;
+        proc.timestamps.realloc(proc.timestampSize);
+    }
+    for (int n = 0; n < nSamples; n++)
+        proc.timestamps[proc.numTimestamps + n] = firstTimestamp + n;
+    proc.numTimestamps += nSamples;
+}
+
+void BinaryRecording::writeFrames(ProcessorFiles& proc, bool pad)
+{
+    const int numChannels = proc.channels.size();
+
+    // channels can be a few samples apart within a block; only whole frames are written
+    int numFrames = proc.numTimestamps;
+    for (int c = 0; c < numChannels; c++)
+    {
+        const int available = channelQueues[proc.channels[c]]->numSamples;
+        numFrames = pad ? jmax(numFrames, available) : jmin(numFrames, available);
+    }
+
+    if (numFrames == 0)
+        return;
+
+    if (pad)
+    {
+        const int16 zero = 0;
+        for (int c = 0; c < numChannels; c++)
+        {
+            ChannelQueue& queue = *channelQueues[proc.channels[c]];
+            while (queue.numSamples < numFrames)
+                appendSamples(queue, &zero, 1);
+        }
+        if (proc.numTimestamps < numFrames)
+        {
+            int64 next = proc.numTimestamps > 0 ? proc.timestamps[proc.numTimestamps - 1] + 1 : 0;
+            appendTimestamps(proc, next, numFrames - proc.numTimestamps);
+        }
+    }
+
+    if (numFrames * numChannels > interleavedBufferSize)
+    {
+        interleavedBufferSize = numFrames * numChannels;
+        interleavedBuffer.realloc(interleavedBufferSize);
+    }
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        const int16* src = channelQueues[proc.channels[c]]->samples;
+        int16* dest = interleavedBuffer + c;
+
+        for (int n = 0; n < numFrames; n++)
+            dest[n * numChannels] = src[n];
+    }
+
+    if (proc.dataFile != nullptr)
+    {
+        size_t count = fwrite(interleavedBuffer, sizeof(int16), numFrames * numChannels, proc.dataFile);
+        jassert(count == (size_t) (numFrames * numChannels));
+    }
+    if (proc.timestampFile != nullptr)
+    {
+        size_t count = fwrite(proc.timestamps, sizeof(int64), numFrames, proc.timestampFile);
+        jassert(count == (size_t) numFrames);
+    }
+    proc.numFrames += numFrames;
+
+    // keep the samples that are not part of a whole frame yet
+    for (int c = 0; c < numChannels; c++)
+    {
+        ChannelQueue& queue = *channelQueues[proc.channels[c]];
+        queue.numSamples -= numFrames;
+        memmove(queue.samples, queue.samples + numFrames, queue.numSamples * sizeof(int16));
+    }
+    proc.numTimestamps -= numFrames;
+    memmove(proc.timestamps, proc.timestamps + numFrames, proc.numTimestamps * sizeof(int64));
+}
+
+void BinaryRecording::writeEvent(int eventType, const MidiMessage& event, int64 timestamp)
+{
+    if (isWritableEvent(eventType) && eventFile != nullptr)
+    {
+        // timestamp followed by the 1st four bytes of event (type, nodeId, eventId, eventChannel)
+        uint8 record[EVENT_RECORD_SIZE];
+        memcpy(record, &timestamp, 8);
+        memcpy(record + 8, event.getRawData(), 4);
+        fwrite(record, 1, EVENT_RECORD_SIZE, eventFile);
+    }
+    if (eventType == GenericProcessor::MESSAGE && messageFile != nullptr)
+    {
+        String line = String(timestamp) + " " + String((const char*)event.getRawData() + 6, event.getRawDataSize() - 6) + "\n";
+        fwrite(line.toUTF8(), 1, line.getNumBytesAsUTF8(), messageFile);
+    }
+}
+
+void BinaryRecording::addSpikeElectrode(int index, const SpikeRecordInfo* elec)
+{
+    // spikes all go to one file, so the electrodes are only described in the header
+    spikeElectrodes.set(index, *elec);
+}
+
+void BinaryRecording::resetChannels()
+{
+    spikeElectrodes.clear();
+}
+
+void BinaryRecording::writeSpike(int electrodeIndex, const SpikeObject& spike, int64 timestamp)
+{
+    if (spikeFile == nullptr)
+        return;
+
+    uint8_t spikeBuffer[MAX_SPIKE_BUFFER_LEN];
+
+    packSpike(&spike, spikeBuffer, MAX_SPIKE_BUFFER_LEN);
+
+    int totalBytes = spike.nSamples * spike.nChannels * 2 + // account for samples
+                     spike.nChannels * 4 +            // acount for gain
+                     spike.nChannels * 2 +            // account for thresholds
+                     SPIKE_METADATA_SIZE;             // 42, from SpikeObject.h
+
+    fwrite(spikeBuffer, 1, totalBytes, spikeFile);
+}
+
+void BinaryRecording::writeHeader()
+{
+    String prefix = "experiment" + String(experimentNumber) + "_recording" + String(recordingNumber);
+
+    XmlElement xml("BINARY_RECORDING");
+    xml.setAttribute("version", BINARY_VERSION);
+    xml.setAttribute("experiment", experimentNumber);
+    xml.setAttribute("recording", recordingNumber);
+    xml.setAttribute("date", generateDateString());
+
+    for (int i = 0; i < processors.size(); i++)
+    {
+        ProcessorFiles* proc = processors[i];
+
+        XmlElement* procXml = xml.createNewChildElement("PROCESSOR");
+        procXml->setAttribute("id", proc->nodeId);
+        procXml->setAttribute("sampleRate", proc->sampleRate);
+        procXml->setAttribute("numChannels", proc->channels.size());
+        procXml->setAttribute("numSamples", (double) proc->numFrames);
+        procXml->setAttribute("dataFile", proc->baseName + ".dat");
+        procXml->setAttribute("dataType", "int16");
+        procXml->setAttribute("byteOrder", "little-endian");
+        procXml->setAttribute("layout", "interleaved");
+        procXml->setAttribute("timestampFile", proc->baseName + ".timestamps");
+        procXml->setAttribute("timestampType", "int64");
+
+        for (int c = 0; c < proc->channels.size(); c++)
+        {
+            Channel* ch = getChannel(getRealChannel(proc->channels[c]));
+
+            XmlElement* chanXml = procXml->createNewChildElement("CHANNEL");
+            chanXml->setAttribute("index", c);
+            chanXml->setAttribute("name", ch->name);
+            chanXml->setAttribute("bitVolts", ch->bitVolts);
+        }
+    }
+
+    XmlElement* events = xml.createNewChildElement("EVENTS");
+    events->setAttribute("file", prefix + "_events.dat");
+    events->setAttribute("recordSize", EVENT_RECORD_SIZE);
+
+    XmlElement* messages = xml.createNewChildElement("MESSAGES");
+    messages->setAttribute("file", prefix + "_messages.txt");
+
+    XmlElement* spikes = xml.createNewChildElement("SPIKES");
+    spikes->setAttribute("file", prefix + "_spikes.dat");
+
+    for (int i = 0; i < spikeElectrodes.size(); i++)
+    {
+        XmlElement* elecXml = spikes->createNewChildElement("ELECTRODE");
+        elecXml->setAttribute("index", i);
+        elecXml->setAttribute("name", spikeElectrodes.getReference(i).name);
+        elecXml->setAttribute("numChannels", spikeElectrodes.getReference(i).numChannels);
+        elecXml->setAttribute("sampleRate", spikeElectrodes.getReference(i).sampleRate);
+    }
+
+    xml.writeToFile(recordFolder.getChildFile(prefix + ".xml"), String::empty);
+}
+
+RecordEngineManager* BinaryRecording::getEngineManager()
+{
+    RecordEngineManager* man = new RecordEngineManager("BINARY", "Flat binary", nullptr);
+    return man;
+}
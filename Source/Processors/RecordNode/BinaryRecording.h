@@ -0,0 +1,133 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef BINARYRECORDING_H_INCLUDED
+#define BINARYRECORDING_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#include "RecordEngine.h"
+#include <stdio.h>
+
+#define BINARY_VERSION 0.1
+
+/**
+    Record engine that writes flat files which can be memory-mapped directly.
+
+    For every processor, the recorded channels go to one .dat file holding
+    little-endian int16 samples interleaved by channel (sample 0 of every
+    channel, then sample 1, ...), and a .timestamps file holding one int64
+    timestamp per sample frame. An XML header describes each processor's
+    files, sample rate and channels, with their names and bitVolts. The
+    sample count is the size of the .timestamps file divided by 8.
+
+    TTL events are written as 12-byte records (int64 timestamp, then the
+    event type, processor ID, event ID and event channel bytes), messages
+    as text lines and spikes as packed SpikeObjects. All electrodes share one
+    spike file, and the header lists the electrodes with their names,
+    channel counts and sample rates.
+
+    @see RecordEngine, OriginalRecording
+*/
+class BinaryRecording : public RecordEngine
+{
+public:
+    BinaryRecording();
+    ~BinaryRecording();
+
+    String getEngineID() const override;
+    void openFiles(File rootFolder, int experimentNumber, int recordingNumber) override;
+    void closeFiles() override;
+    void writeData(int writeChannel, int realChannel, const float* buffer, int size) override;
+    void endChannelBlock(bool lastBlock) override;
+    void writeEvent(int eventType, const MidiMessage& event, int64 timestamp) override;
+    void addSpikeElectrode(int index, const SpikeRecordInfo* elec) override;
+    void resetChannels() override;
+    void writeSpike(int electrodeIndex, const SpikeObject& spike, int64 timestamp) override;
+
+    static RecordEngineManager* getEngineManager();
+
+private:
+    /** Samples of one recorded channel that have not been interleaved yet */
+    struct ChannelQueue
+    {
+        HeapBlock<int16> samples;
+        int numSamples;
+        int size;
+    };
+
+    /** The files and channels of one processor */
+    struct ProcessorFiles
+    {
+        int nodeId;
+        float sampleRate;
+        String baseName;
+        FILE* dataFile;
+        FILE* timestampFile;
+        int64 numFrames;
+
+        /** Recorded channel indexes, in file order */
+        Array<int> channels;
+
+        /** Timestamps of the frames held in the channel queues */
+        HeapBlock<int64> timestamps;
+        int numTimestamps;
+        int timestampSize;
+    };
+
+    void appendSamples(ChannelQueue& queue, const int16* data, int nSamples);
+    void appendTimestamps(ProcessorFiles& proc, int64 firstTimestamp, int nSamples);
+
+    /** Interleaves every complete frame of a processor and writes it out.
+        With pad set, missing samples at the end are filled with zeros. */
+    void writeFrames(ProcessorFiles& proc, bool pad);
+
+    void writeHeader();
+
+    OwnedArray<ChannelQueue> channelQueues;
+    OwnedArray<ProcessorFiles> processors;
+
+    /** Processor index of each recorded channel */
+    Array<int> processorOfChannel;
+
+    /** Registered spike electrodes, listed in the header */
+    Array<SpikeRecordInfo> spikeElectrodes;
+
+    HeapBlock<float> floatBuffer;
+    HeapBlock<int16> intBuffer;
+    int convertBufferSize;
+
+    HeapBlock<int16> interleavedBuffer;
+    int interleavedBufferSize;
+
+    FILE* eventFile;
+    FILE* messageFile;
+    FILE* spikeFile;
+
+    File recordFolder;
+    int experimentNumber;
+    int recordingNumber;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BinaryRecording);
+};
+
+#endif  // BINARYRECORDING_H_INCLUDED
@@ -55,6 +55,7 @@ void DataQueue::setChannels(int nChans)
 		m_lastReadTimestamps.add(0);
 	}
 	m_buffer.setSize(nChans, m_maxSize);
+	m_highWaterMark = 0;
 }
 
 void DataQueue::resize(int nBlocks)
@@ -75,6 +76,7 @@ void DataQueue::resize(int nBlocks)
 		m_lastReadTimestamps.set(i, 0);
 	}
 	m_buffer.setSize(m_numChans, size);
+	m_highWaterMark = 0;
 }
 
 void DataQueue::fillTimestamps(int channel, int index, int size, int64 timestamp)
@@ -109,7 +111,7 @@ void DataQueue::fillTimestamps(int channel, int index, int size, int64 timestamp
 	}
 }
 
-void DataQueue::writeChannel(const AudioSampleBuffer& buffer, int channel, int sourceChannel, int nSamples, int64 timestamp)
+int DataQueue::writeChannel(const AudioSampleBuffer& buffer, int channel, int sourceChannel, int nSamples, int64 timestamp)
 {
 	int index1, size1, index2, size2;
 	m_fifos[channel]->prepareToWrite(nSamples, index1, size1, index2, size2);
@@ -138,6 +140,23 @@ void DataQueue::writeChannel(const AudioSampleBuffer& buffer, int channel, int s
 		fillTimestamps(channel, index2, size2, timestamp + size1);
 	}
 	m_fifos[channel]->finishedWrite(size1 + size2);
+
+	//only the writing thread updates the mark, so a plain compare and set is enough
+	int numReady = m_fifos[channel]->getNumReady();
+	if (numReady > m_highWaterMark.get())
+		m_highWaterMark = numReady;
+
+	return numReady;
+}
+
+int DataQueue::getHighWaterMark() const
+{
+	return m_highWaterMark.get();
+}
+
+int DataQueue::getSizeInSamples() const
+{
+	return m_maxSize;
 }
 
 /* 
@@ -45,10 +45,16 @@ public:
 
 	//Only the methods after this comment are considered thread-safe.
 	//Caution must be had to avoid calling more than one of the methods above simulatenously
-	void writeChannel(const AudioSampleBuffer& buffer, int channel, int sourceChannel, int nSamples, int64 timestamp);
+
+	/** Returns the number of samples waiting to be read from the channel after the write */
+	int writeChannel(const AudioSampleBuffer& buffer, int channel, int sourceChannel, int nSamples, int64 timestamp);
 	bool startRead(Array<CircularBufferIndexes>& indexes, Array<int64>& timestamps, int nMax);
 	const AudioSampleBuffer& getAudioBufferReference() const;
 	void stopRead();
+
+	/** Largest number of samples that have been waiting in any channel since setChannels() was called */
+	int getHighWaterMark() const;
+	int getSizeInSamples() const;
 	
 
 private:
@@ -65,6 +71,7 @@ private:
 	bool m_readInProgress;
 	int m_numBlocks;
 	int m_maxSize;
+	Atomic<int> m_highWaterMark;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataQueue);
 };
@@ -29,40 +29,65 @@
 
 struct SpikeObject;
 
+/** Largest event a processor can emit: a 6-byte header plus up to 255 bytes of data */
+#define EVENT_QUEUE_MAX_EVENT_BYTES 261
+
+/** One preallocated entry of an EventQueue. The producer copies each event into it in place. */
 template <class MsgContainer>
-class AsyncEventMessage :
-	public ReferenceCountedObject
+class EventQueueSlot
 {
 public:
-	AsyncEventMessage(const MsgContainer& m, int64 t, int extra) : 
-		ReferenceCountedObject(),
-		m_data(m),
-		m_timestamp(t),
-		m_extra(extra)
-	{}
+	void set(const MsgContainer& m) { m_data = m; }
 
-	~AsyncEventMessage() {};
+	const MsgContainer& getData() const { return m_data; }
 
-	const MsgContainer& getData() const { return m_data;  }
-	const int64& getTimestamp() const { return m_timestamp; }
-	const int& getExtra() const { return m_extra;  }
+	int64 m_timestamp;
+	int m_extra;
 
 private:
-	const MsgContainer m_data;
-	const int64 m_timestamp;
-	const int m_extra;
+	MsgContainer m_data;
+};
+
+/** MidiMessages allocate their data when copied, so events are stored as raw bytes
+	and only turned back into a MidiMessage on the record thread. */
+template <>
+class EventQueueSlot<MidiMessage>
+{
+public:
+	void set(const MidiMessage& m)
+	{
+		m_size = jmin(m.getRawDataSize(), EVENT_QUEUE_MAX_EVENT_BYTES);
+		memcpy(m_data, m.getRawData(), (size_t) m_size);
+	}
 
+	MidiMessage getData() const { return MidiMessage(m_data, m_size, 0); }
+
+	int64 m_timestamp;
+	int m_extra;
+
+private:
+	uint8 m_data[EVENT_QUEUE_MAX_EVENT_BYTES];
+	int m_size;
 };
 
+/**
+	Fixed-capacity single-producer, single-consumer queue between the audio
+	thread and the RecordThread.
+
+	All slots are allocated up front, and addEvent() copies each event into
+	the next free one, so the producer never allocates. When the queue is
+	full, the event is dropped and counted; getNumOverruns() exposes that
+	count so the UI can report it.
+*/
 template <class EventClass>
 class EventQueue
 {
 public:
-	typedef AsyncEventMessage<EventClass> EventContainer;
-	typedef ReferenceCountedObjectPtr<EventContainer> EventClassPtr;
+	typedef EventQueueSlot<EventClass> Slot;
 
 	EventQueue(int size) :
-		m_fifo(size)
+		m_fifo(size),
+		m_readPos1(0), m_readSize1(0), m_readPos2(0), m_readSize2(0)
 	{
 		m_data.resize(size);
 	}
@@ -75,67 +100,77 @@ public:
 		return m_fifo.getNumReady();
 	}
 
+	/** Returns the number of events dropped because the queue was full, since the last reset */
+	int getNumOverruns() const
+	{
+		return m_overruns.get();
+	}
+
 	void reset()
 	{
-		m_data.clear();
-		m_data.resize(m_fifo.getTotalSize());
+		m_fifo.reset();
+		m_overruns = 0;
 	}
 
 	void resize(int size)
 	{
-		m_data.clear();
 		m_fifo.setTotalSize(size);
 		m_data.resize(size);
+		reset();
 	}
 
 	void addEvent(const EventClass& ev, int64 t, int extra = 0)
 	{
 		int pos1, size1, pos2, size2;
-		size1 = 0;
 		m_fifo.prepareToWrite(1, pos1, size1, pos2, size2);
 
-		/* This means there is a buffer overrun. Instead of overwritting the existing data and risking a collision of both threads
-			we just skip the incoming samples. TODO: use this to notify of the overrun and act consequently   */
-		if (size1 > 0)
+		/* The consumer hasn't kept up. Rather than overwrite data it may be reading,
+			drop the incoming event and count it. */
+		if (size1 == 0)
 		{
-			m_data[pos1] = new EventContainer(ev, t, extra);
-			m_fifo.finishedWrite(1);
+			++m_overruns;
+			return;
 		}
+
+		Slot& slot = m_data[pos1];
+		slot.set(ev);
+		slot.m_timestamp = t;
+		slot.m_extra = extra;
+		m_fifo.finishedWrite(1);
 	}
 
-	int getEvents(std::vector<EventClassPtr>& vec, int max)
+	/** Makes up to max events (all of them if max <= 0) available through getReadSlot(),
+		and returns how many there are. They stay valid until finishedRead() is called. */
+	int startRead(int max)
 	{
-		int pos1, size1, pos2, size2;
 		int numAvailable = m_fifo.getNumReady();
 		int numToRead = ((max < numAvailable) && (max > 0)) ? max : numAvailable;
-		m_fifo.prepareToRead(numToRead, pos1, size1, pos2, size2);
-		vec.resize(numToRead);
-		for (int i = 0; i < size1; ++i)
-		{
-			vec[i] = m_data[pos1 + i];
-		}
-		if (size2 > 0)
-		{
-			for (int i = 0; i < size2; ++i)
-			{
-				vec[size1 + i] = m_data[pos2 + i];
-			}
-		}
-		m_fifo.finishedRead(numToRead);
-		return numToRead;
+		m_fifo.prepareToRead(numToRead, m_readPos1, m_readSize1, m_readPos2, m_readSize2);
+		return m_readSize1 + m_readSize2;
+	}
+
+	const Slot& getReadSlot(int index) const
+	{
+		return index < m_readSize1 ? m_data[m_readPos1 + index] : m_data[m_readPos2 + index - m_readSize1];
+	}
+
+	void finishedRead()
+	{
+		m_fifo.finishedRead(m_readSize1 + m_readSize2);
+		m_readSize1 = m_readSize2 = 0;
 	}
 
 private:
-	std::vector<EventClassPtr> m_data;
+	std::vector<Slot> m_data;
 	AbstractFifo m_fifo;
+	Atomic<int> m_overruns;
+
+	int m_readPos1, m_readSize1, m_readPos2, m_readSize2;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventQueue);
 };
 
 typedef EventQueue<MidiMessage> EventMsgQueue;
 typedef EventQueue<SpikeObject> SpikeMsgQueue;
-typedef ReferenceCountedObjectPtr<AsyncEventMessage<MidiMessage>> EventMessagePtr;
-typedef ReferenceCountedObjectPtr<AsyncEventMessage<SpikeObject>> SpikeMessagePtr;
 
 #endif  // EVENTQUEUE_H_INCLUDED
-
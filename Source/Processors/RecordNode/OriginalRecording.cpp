@@ -26,7 +26,7 @@
 #include "../../Audio/AudioComponent.h"
 
 OriginalRecording::OriginalRecording() : separateFiles(false),
-    recordingNumber(0), experimentNumber(0),  zeroBuffer(1, 50000),
+    recordingNumber(0), experimentNumber(0), asyncWrites(false), zeroBuffer(1, 50000),
     eventFile(nullptr), messageFile(nullptr), lastProcId(0)
 {
     /*continuousDataIntegerBuffer = new int16[10000];
@@ -49,6 +49,7 @@ OriginalRecording::OriginalRecording() : separateFiles(false),
 OriginalRecording::~OriginalRecording()
 {
     //Cleanup just in case
+    asyncWriter = nullptr;
     for (int i=0; i < fileArray.size(); i++)
     {
         if (fileArray[i] != nullptr) fclose(fileArray[i]);
@@ -71,6 +72,7 @@ void OriginalRecording::addChannel(int index, const Channel* chan)
 {
     //Just populate the file array with null so we can address it by index afterwards
     fileArray.add(nullptr);
+    asyncWriterHandles.add(-1);
     blockIndex.add(0);
     samplesSinceLastTimestamp.add(0);
 }
@@ -83,6 +85,7 @@ void OriginalRecording::addSpikeElectrode(int index, const SpikeRecordInfo* elec
 void OriginalRecording::resetChannels()
 {
     fileArray.clear();
+    asyncWriterHandles.clear();
     spikeFileArray.clear();
     blockIndex.clear();
     processorArray.clear();
@@ -100,6 +103,9 @@ void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int rec
     openFile(rootFolder,nullptr);
     openMessageFile(rootFolder);
 
+    if (asyncWrites)
+        asyncWriter = new AsyncFileWriter(ASYNC_WRITE_THREADS, ASYNC_WRITE_RECORDS*RECORD_SIZE);
+
     for (int i = 0; i < fileArray.size(); i++)
     {
         if (getChannel(i)->getRecordState())
@@ -107,6 +113,9 @@ void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int rec
             openFile(rootFolder,getChannel(i));
             blockIndex.set(i,0);
             samplesSinceLastTimestamp.set(i,0);
+
+            if (asyncWriter != nullptr && fileArray[i] != nullptr)
+                asyncWriterHandles.set(i, asyncWriter->addFile(fileArray[i]));
         }
 
     }
@@ -514,65 +523,56 @@ void OriginalRecording::writeContinuousBuffer(const float* data, int nSamples, i
 
     if (blockIndex[channel] == 0)
     {
-        writeTimestampAndSampleCount(fileArray[channel], writeChannel);
+        writeTimestampAndSampleCount(channel, writeChannel);
     }
 
-    diskWriteLock.enter();
-
-    size_t count = fwrite(continuousDataIntegerBuffer, // ptr
-                          2,                               // size of each element
-                          nSamples,                        // count
-                          fileArray[channel]); // ptr to FILE object
-
-    //std::cout << channel << " : " << nSamples << " : " << count << std::endl;
-
-    jassert(count == nSamples); // make sure all the data was written
-
-    diskWriteLock.exit();
+    writeContinuousBytes(channel, continuousDataIntegerBuffer, 2*nSamples);
 
     if (blockIndex[channel] + nSamples == BLOCK_LENGTH)
     {
-        writeRecordMarker(fileArray[channel]);
+        writeRecordMarker(channel);
     }
 }
 
-void OriginalRecording::writeTimestampAndSampleCount(FILE* file, int channel)
+void OriginalRecording::writeTimestampAndSampleCount(int channel, int writeChannel)
 {
-    diskWriteLock.enter();
-
     uint16 samps = BLOCK_LENGTH;
 
    // int sourceNodeId = getChannel(channel)->sourceNodeId;
 
-    int64 ts = getTimestamp(channel) + samplesSinceLastTimestamp[channel];
+    int64 ts = getTimestamp(writeChannel) + samplesSinceLastTimestamp[writeChannel];
 
-    fwrite(&ts,                       // ptr
-           8,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
+    // timestamp, sample count and recording number go out in a single write
+    char recordHeader[12];
+    memcpy(recordHeader, &ts, 8);
+    memcpy(recordHeader + 8, &samps, 2);
+    memcpy(recordHeader + 10, &recordingNumber, 2);
 
-    fwrite(&samps,                           // ptr
-           2,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    fwrite(&recordingNumber,                         // ptr
-           2,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    diskWriteLock.exit();
+    writeContinuousBytes(channel, recordHeader, 12);
 }
 
-void OriginalRecording::writeRecordMarker(FILE* file)
+void OriginalRecording::writeRecordMarker(int channel)
 {
     // write a 10-byte marker indicating the end of a record
+    writeContinuousBytes(channel, recordMarker, 10);
+}
+
+void OriginalRecording::writeContinuousBytes(int channel, const void* data, int size)
+{
+    if (asyncWriter != nullptr)
+    {
+        asyncWriter->write(asyncWriterHandles[channel], data, size);
+        return;
+    }
 
     diskWriteLock.enter();
-    fwrite(recordMarker,        // ptr
-           1,                   // size of each element
-           10,                  // count
-           file);               // ptr to FILE object
+
+    size_t count = fwrite(data,                 // ptr
+                          1,                    // size of each element
+                          size,                 // count
+                          fileArray[channel]);  // ptr to FILE object
+
+    jassert(count == size); // make sure all the data was written
 
     diskWriteLock.exit();
 }
@@ -587,12 +587,28 @@ void OriginalRecording::closeFiles()
             {
                 // fill out the rest of the current buffer
                 writeContinuousBuffer(zeroBuffer.getReadPointer(0), BLOCK_LENGTH - blockIndex[i], i);
-                diskWriteLock.enter();
-                fclose(fileArray[i]);
-                fileArray.set(i,nullptr);
-                diskWriteLock.exit();
             }
         }
+    }
+
+    if (asyncWriter != nullptr)
+    {
+        // wait for every record to reach the disk before the files are closed
+        asyncWriter = nullptr;
+
+        for (int i = 0; i < asyncWriterHandles.size(); i++)
+            asyncWriterHandles.set(i, -1);
+    }
+
+    for (int i = 0; i < fileArray.size(); i++)
+    {
+        if (fileArray[i] != nullptr)
+        {
+            diskWriteLock.enter();
+            fclose(fileArray[i]);
+            fileArray.set(i,nullptr);
+            diskWriteLock.exit();
+        }
 
         blockIndex.set(i,0);
     }
@@ -706,6 +722,7 @@ void OriginalRecording::setParameter(EngineParameter& parameter)
     boolParameter(0, separateFiles);
     boolParameter(1, renameFiles);
     strParameter(2, renamedPrefix);
+    boolParameter(3, asyncWrites);
 }
 
 RecordEngineManager* OriginalRecording::getEngineManager()
@@ -718,5 +735,7 @@ RecordEngineManager* OriginalRecording::getEngineManager()
     man->addParameter(param);
     param = new EngineParameter(EngineParameter::STR, 2, "Renamed files prefix", "CH");
     man->addParameter(param);
+    param = new EngineParameter(EngineParameter::BOOL, 3, "Write continuous data asynchronously", false);
+    man->addParameter(param);
     return man;
 }
\ No newline at end of file
@@ -26,12 +26,19 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 
 #include "RecordEngine.h"
+#include "AsyncFileWriter.h"
 #include <stdio.h>
 #include <map>
 
 #define HEADER_SIZE 1024
 #define BLOCK_LENGTH 1024
 
+//Size of a record: timestamp, sample count, recording number, samples and record marker
+#define RECORD_SIZE (8 + 2 + 2 + 2*BLOCK_LENGTH + 10)
+//Records collected per channel before the asynchronous writer writes them
+#define ASYNC_WRITE_RECORDS 16
+#define ASYNC_WRITE_THREADS 4
+
 #define VERSION 0.4
 
 #define VSTR(s) #s
@@ -62,8 +69,9 @@ private:
     void openFile(File rootFolder, Channel* ch);
     String generateHeader(Channel* ch);
     void writeContinuousBuffer(const float* data, int nSamples, int channel);
-    void writeTimestampAndSampleCount(FILE* file, int channel);
-    void writeRecordMarker(FILE* file);
+    void writeTimestampAndSampleCount(int channel, int writeChannel);
+    void writeRecordMarker(int channel);
+    void writeContinuousBytes(int channel, const void* data, int size);
 
     void openSpikeFile(File rootFolder, SpikeRecordInfo* elec);
     String generateSpikeHeader(SpikeRecordInfo* elec);
@@ -83,6 +91,13 @@ private:
     bool renameFiles;
     String renamedPrefix;
 
+    /** When set, continuous data is collected into whole records and written
+        by the AsyncFileWriter's threads instead of the record thread.
+    */
+    bool asyncWrites;
+    ScopedPointer<AsyncFileWriter> asyncWriter;
+    Array<int> asyncWriterHandles;
+
     /** Holds data that has been converted from float to int16 before
         saving.
     */
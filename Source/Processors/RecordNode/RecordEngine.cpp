@@ -28,6 +28,7 @@
 
 #include "EngineConfigWindow.h"
 #include "OriginalRecording.h"
+#include "BinaryRecording.h"
 
 RecordEngine::RecordEngine()
     : manager(nullptr)
@@ -169,7 +170,7 @@ void RecordEngineManager::addParameter(EngineParameter* param)
 
 int RecordEngineManager::getNumOfBuiltInEngines()
 {
-	return 1;
+	return 2;
 }
 
 RecordEngineManager* RecordEngineManager::createBuiltInEngineManager(int index)
@@ -179,6 +180,9 @@ RecordEngineManager* RecordEngineManager::createBuiltInEngineManager(int index)
 	case 0:
 		return OriginalRecording::getEngineManager();
 		break;
+	case 1:
+		return BinaryRecording::getEngineManager();
+		break;
 	default:
 		return nullptr;
 	}
@@ -194,6 +198,9 @@ RecordEngine* RecordEngineManager::instantiateEngine()
     if (id == "OPENEPHYS")
         return new OriginalRecording();
 
+    if (id == "BINARY")
+        return new BinaryRecording();
+
     return nullptr;
 }
 
@@ -342,6 +342,7 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
 
             // close the writing thread.
 			m_recordThread->signalThreadShouldExit();
+			m_recordThread->notify();
 			m_recordThread->waitForThreadToExit(2000);
 			while (m_recordThread->isThreadRunning())
 			{
@@ -424,6 +425,16 @@ float RecordNode::getFreeSpace()
     return 1.0f - float(dataDirectory.getBytesFreeOnVolume())/float(dataDirectory.getVolumeTotalSize());
 }
 
+int RecordNode::getNumDroppedEvents()
+{
+	return m_eventQueue->getNumOverruns();
+}
+
+int RecordNode::getNumDroppedSpikes()
+{
+	return m_spikeQueue->getNumOverruns();
+}
+
 
 void RecordNode::handleEvent(int eventType, MidiMessage& event, int samplePosition)
 {
@@ -434,8 +445,11 @@ void RecordNode::handleEvent(int eventType, MidiMessage& event, int samplePositi
             if (*(event.getRawData()+4) > 0) // saving flag > 0 (i.e., event has not already been processed)
             {
 				uint8 sourceNodeId = event.getNoteNumber();
-				int64 timestamp = timestamps[sourceNodeId] + samplePosition;
+				int64 timestamp = getSourceTimestamp(sourceNodeId) + samplePosition;
 				m_eventQueue->addEvent(event, timestamp, eventType);
+
+				if (m_eventQueue->getRemainingEvents() > EVENT_BUFFER_NEVENTS / 2)
+					m_recordThread->requestWrite();
             }
         }
     }
@@ -452,15 +466,20 @@ void RecordNode::process(AudioSampleBuffer& buffer,
     {
         // SECOND: write channel data
 		int recordChans = channelMap.size();
+		int maxWaiting = 0;
 		for (int chan = 0; chan < recordChans; ++chan)
 		{
 			int realChan = channelMap[chan];
 			int sourceNodeId = channelPointers[realChan]->sourceNodeId;
-			int nSamples = numSamples.at(sourceNodeId);
-			int timestamp = timestamps.at(sourceNodeId);
-			m_dataQueue->writeChannel(buffer, chan, realChan, nSamples, timestamp);
+			int nSamples = getNumSourceSamples(sourceNodeId);
+			int64 timestamp = getSourceTimestamp(sourceNodeId);
+			maxWaiting = jmax(maxWaiting, m_dataQueue->writeChannel(buffer, chan, realChan, nSamples, timestamp));
 		}
 
+		// the record thread sleeps until there's enough to write in one go
+		if (maxWaiting >= m_recordThread->getWakeupSamples())
+			m_recordThread->requestWrite();
+
         //  std::cout << nSamples << " " << samplesWritten << " " << blockIndex << std::endl;
 		if (!setFirstBlock)
 		{
@@ -501,11 +520,15 @@ int RecordNode::addSpikeElectrode(SpikeRecordInfo* elec)
     return spikeElectrodeIndex++;
 }
 
-void RecordNode::writeSpike(SpikeObject& spike, int electrodeIndex)
+void RecordNode::writeSpike(const SpikeObject& spike, int electrodeIndex)
 {
 	if (isRecording)
 	{
+		const SpinLock::ScopedLockType lock(m_spikeWriteLock);
 		m_spikeQueue->addEvent(spike, spike.timestamp, electrodeIndex);
+
+		if (m_spikeQueue->getRemainingEvents() > SPIKE_BUFFER_NSPIKES / 2)
+			m_recordThread->requestWrite();
 	}
 }
 
@@ -106,6 +106,12 @@ public:
     */
     float getFreeSpace();
 
+    /** Returns the number of events and spikes dropped since recording started
+        because the record thread fell behind.
+    */
+    int getNumDroppedEvents();
+    int getNumDroppedSpikes();
+
     /** Selects a channel relative to a particular processor with ID = id
     */
     void setChannel(Channel* ch);
@@ -154,7 +160,7 @@ public:
 
     /** Called by a spike recording source to write a spike to file
     */
-    void writeSpike(SpikeObject& spike, int electrodeIndex);
+    void writeSpike(const SpikeObject& spike, int electrodeIndex);
 
     SpikeRecordInfo* getSpikeElectrode(int index);
 
@@ -222,6 +228,10 @@ private:
 	ScopedPointer<DataQueue> m_dataQueue;
 	ScopedPointer<EventMsgQueue> m_eventQueue;
 	ScopedPointer<SpikeMsgQueue> m_spikeQueue;
+
+	/** Spikes can arrive from processors in different branches at once, while the
+		spike queue only takes a single producer. */
+	SpinLock m_spikeWriteLock;
 	
 	Array<int> m_recordedChannelMap;
 
@@ -32,7 +32,10 @@ RecordThread::RecordThread(const OwnedArray<RecordEngine>& engines) :
 Thread("Record Thread"),
 m_engineArray(engines),
 m_receivedFirstBlock(false),
-m_cleanExit(true)
+m_cleanExit(true),
+m_writeRequested(false),
+m_wakeupSamples(RECORD_WAKEUP_SAMPLES),
+m_maxLatencyMs(RECORD_MAX_LATENCY_MS)
 {
 }
 
@@ -71,6 +74,42 @@ void RecordThread::setFirstBlockFlag(bool state)
 	this->notify();
 }
 
+void RecordThread::setWakeupConditions(int wakeupSamples, int maxLatencyMs)
+{
+	if (isThreadRunning())
+		return;
+	m_wakeupSamples = jmax(1, wakeupSamples);
+	m_maxLatencyMs = jmax(1, maxLatencyMs);
+}
+
+int RecordThread::getWakeupSamples() const
+{
+	return m_wakeupSamples;
+}
+
+void RecordThread::requestWrite()
+{
+	//only signal once per wakeup, so the audio thread doesn't touch the event again on every block
+	if (!m_writeRequested.exchange(true))
+		this->notify();
+}
+
+int RecordThread::getNumWriteBatches() const
+{
+	return m_numWriteBatches.get();
+}
+
+int RecordThread::getLargestWriteBatch() const
+{
+	return m_largestWriteBatch.get();
+}
+
+double RecordThread::getMeanWriteBatch() const
+{
+	int n = m_numWriteBatches.get();
+	return n > 0 ? double(m_totalWriteBatchSamples.get()) / n : 0.0;
+}
+
 void RecordThread::run()
 {
 	const AudioSampleBuffer& dataBuffer = m_dataQueue->getAudioBufferReference();
@@ -86,15 +125,26 @@ void RecordThread::run()
 	{
 		m_cleanExit = false;
 		closeEarly = false;
+		m_numWriteBatches = 0;
+		m_largestWriteBatch = 0;
+		m_totalWriteBatchSamples = 0;
 		Array<int64> timestamps;
 		m_dataQueue->getTimestampsForBlock(0, timestamps);
 		EVERY_ENGINE->updateTimestamps(timestamps);
 		EVERY_ENGINE->openFiles(m_rootFolder, m_experimentNumber, m_recordingNumber);
 	}
-	//3-Normal loop
+	//3-Normal loop: sleep until RecordNode reports enough queued data or the latency deadline
+	//passes, then write everything that has accumulated
 	while (!threadShouldExit())
 	{
-		writeData(dataBuffer, BLOCK_MAX_WRITE_SAMPLES, BLOCK_MAX_WRITE_EVENTS, BLOCK_MAX_WRITE_SPIKES);
+		wait(m_maxLatencyMs);
+		m_writeRequested = false;
+
+		int batchSize;
+		do
+		{
+			batchSize = writeData(dataBuffer, BLOCK_MAX_WRITE_SAMPLES, BLOCK_MAX_WRITE_EVENTS, BLOCK_MAX_WRITE_SPIKES);
+		} while (batchSize == BLOCK_MAX_WRITE_SAMPLES && !threadShouldExit());
 	}
 	std::cout << "Exiting record thread" << std::endl;
 	//4-Before closing the thread, try to write the remaining samples
@@ -106,11 +156,17 @@ void RecordThread::run()
 		//5-Close files
 		EVERY_ENGINE->closeFiles();
 	}
+	if (m_numWriteBatches.get() > 0)
+	{
+		std::cout << "Record thread wrote " << getNumWriteBatches() << " batches, " << getMeanWriteBatch()
+			<< " samples on average and " << getLargestWriteBatch() << " at most. Queue high-water mark: "
+			<< m_dataQueue->getHighWaterMark() << " of " << m_dataQueue->getSizeInSamples() << " samples." << std::endl;
+	}
 	m_cleanExit = true;
 	m_receivedFirstBlock = false;
 }
 
-void RecordThread::writeData(const AudioSampleBuffer& dataBuffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock)
+int RecordThread::writeData(const AudioSampleBuffer& dataBuffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock)
 {
 	Array<int64> timestamps;
 	Array<CircularBufferIndexes> idx;
@@ -133,19 +189,36 @@ void RecordThread::writeData(const AudioSampleBuffer& dataBuffer, int maxSamples
 	m_dataQueue->stopRead();
 	EVERY_ENGINE->endChannelBlock(lastBlock);
 
-	std::vector<EventMessagePtr> events;
-	int nEvents = m_eventQueue->getEvents(events, maxEvents);
+	int batchSize = 0;
+	for (int chan = 0; chan < m_numChannels; ++chan)
+		batchSize = jmax(batchSize, idx[chan].size1 + idx[chan].size2);
+
+	if (batchSize > 0)
+	{
+		++m_numWriteBatches;
+		m_totalWriteBatchSamples += batchSize;
+		if (batchSize > m_largestWriteBatch.get())
+			m_largestWriteBatch = batchSize;
+	}
+
+	int nEvents = m_eventQueue->startRead(maxEvents);
 	for (int ev = 0; ev < nEvents; ++ev)
 	{
-		EVERY_ENGINE->writeEvent(events[ev]->getExtra(), events[ev]->getData(), events[ev]->getTimestamp());
+		const EventMsgQueue::Slot& slot = m_eventQueue->getReadSlot(ev);
+		const MidiMessage event = slot.getData();
+		EVERY_ENGINE->writeEvent(slot.m_extra, event, slot.m_timestamp);
 	}
+	m_eventQueue->finishedRead();
 
-	std::vector<SpikeMessagePtr> spikes;
-	int nSpikes = m_spikeQueue->getEvents(spikes, maxSpikes);
+	int nSpikes = m_spikeQueue->startRead(maxSpikes);
 	for (int sp = 0; sp < nSpikes; ++sp)
 	{
-		EVERY_ENGINE->writeSpike(spikes[sp]->getExtra(), spikes[sp]->getData(), spikes[sp]->getTimestamp());
+		const SpikeMsgQueue::Slot& slot = m_spikeQueue->getReadSlot(sp);
+		EVERY_ENGINE->writeSpike(slot.m_extra, slot.getData(), slot.m_timestamp);
 	}
+	m_spikeQueue->finishedRead();
+
+	return batchSize;
 }
 
 void RecordThread::forceCloseFiles()
@@ -29,9 +29,13 @@
 #include "DataQueue.h"
 #include <atomic>
 
-#define BLOCK_MAX_WRITE_SAMPLES 4096
-#define BLOCK_MAX_WRITE_EVENTS 32
-#define BLOCK_MAX_WRITE_SPIKES 32
+#define BLOCK_MAX_WRITE_SAMPLES 40960
+#define BLOCK_MAX_WRITE_EVENTS 512
+#define BLOCK_MAX_WRITE_SPIKES 512
+
+//The thread is woken when this many samples are waiting in a channel, or after the maximum latency
+#define RECORD_WAKEUP_SAMPLES 16384
+#define RECORD_MAX_LATENCY_MS 100
 
 class Channel;
 class RecordEngine;
@@ -51,8 +55,24 @@ public:
 	void setFirstBlockFlag(bool state);
 	void forceCloseFiles();
 
+	/** Sets when the thread wakes up to write: as soon as a channel holds wakeupSamples
+		samples, or maxLatencyMs after the previous write, whichever comes first. */
+	void setWakeupConditions(int wakeupSamples, int maxLatencyMs);
+	int getWakeupSamples() const;
+
+	/** Wakes the thread ahead of its deadline. Called from the audio thread
+		once a queue reaches its fill level, and cheap to call repeatedly. */
+	void requestWrite();
+
+	/** Statistics for the current or last recording. A batch is one pass over
+		all channels; its size is the largest number of samples written for a channel. */
+	int getNumWriteBatches() const;
+	int getLargestWriteBatch() const;
+	double getMeanWriteBatch() const;
+
 private:
-	void writeData(const AudioSampleBuffer& buffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock = false);
+	/** Returns the size of the batch that was written */
+	int writeData(const AudioSampleBuffer& buffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock = false);
 
 	const OwnedArray<RecordEngine>& m_engineArray;
 	Array<int> m_channelArray;
@@ -63,6 +83,14 @@ private:
 
 	std::atomic<bool> m_receivedFirstBlock;
 	std::atomic<bool> m_cleanExit;
+	std::atomic<bool> m_writeRequested;
+
+	int m_wakeupSamples;
+	int m_maxLatencyMs;
+
+	Atomic<int> m_numWriteBatches;
+	Atomic<int> m_largestWriteBatch;
+	Atomic<int64> m_totalWriteBatchSamples;
 
 	File m_rootFolder;
 	int m_experimentNumber;
@@ -343,6 +343,56 @@ void generateEmptySpike(SpikeObject* s, int nChannels, int numSamples)
     }
 }
 
+SpikeEventBuffer::SpikeEventBuffer() : numSpikes(0)
+{
+    chunks.add(new SpikeChunk());
+}
+
+SpikeEventBuffer::~SpikeEventBuffer()
+{
+}
+
+void SpikeEventBuffer::clear()
+{
+    numSpikes = 0;
+}
+
+SpikeObject* SpikeEventBuffer::getNewSpike()
+{
+    const int chunk = numSpikes / spikesPerChunk;
+
+    // spikes already handed out must not move, so the buffer grows by whole chunks
+    if (chunk == chunks.size())
+        chunks.add(new SpikeChunk());
+
+    return &(chunks[chunk]->spikes[numSpikes++ % spikesPerChunk]);
+}
+
+void SpikeEventBuffer::addSpikeEvent(MidiBuffer& eventBuffer, SpikeObject* spike, int sampleNum)
+{
+    uint8 data[SPIKE_EVENT_DESCRIPTOR_SIZE];
+
+    spike->eventType = SPIKE_EVENT_CODE;
+
+    // same leading bytes as a packed spike
+    data[0] = spike->eventType;
+    memcpy(data + 1, &(spike->timestamp), 8);
+    memcpy(data + 9, &spike, sizeof(SpikeObject*));
+
+    eventBuffer.addEvent(data, SPIKE_EVENT_DESCRIPTOR_SIZE, sampleNum);
+}
+
+const SpikeObject* getSpikeFromEvent(const MidiMessage& event)
+{
+    if (event.getRawDataSize() != SPIKE_EVENT_DESCRIPTOR_SIZE || *event.getRawData() != SPIKE_EVENT_CODE)
+        return nullptr;
+
+    const SpikeObject* spike;
+    memcpy(&spike, event.getRawData() + 9, sizeof(SpikeObject*));
+
+    return spike;
+}
+
 void printSpike(SpikeObject* s)
 {
 
@@ -35,7 +35,7 @@
 #define MAX_NUMBER_OF_SPIKE_CHANNELS 4
 #define MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES 80
 #define CHECK_BUFFER_VALIDITY true
-#define SPIKE_EVENT_CODE 4;
+#define SPIKE_EVENT_CODE 4
 #define MAX_SPIKE_BUFFER_LEN 512 // max length of spike buffer in bytes
                                  // the true max calculated from the spike values below is actually 507
 
@@ -60,9 +60,9 @@ PLUGIN_API String generateSpikeElectrodeName(int numChannels, int index);
 
   Allows spikes to be transmitted between processors.
 
-  For transmission between processors SpikeObjects must be packaged up into buffers that can fit into MidiEvents
-  The following two methods can be used to package the above spike object into a buffer and  unpackage a buffer
-  into a SpikeObject.
+  Processors pass SpikeObjects to each other in place, through a SpikeEventBuffer. For storage and for
+  transmission outside the GUI, SpikeObjects are packaged up into byte buffers: the following two methods
+  can be used to package the above spike object into a buffer and unpackage a buffer into a SpikeObject.
 
   The buffer is LittleEndian (thank Intel) and the byte order is the same as the SpikeObject definition.
   IE. the first 2 bytes are the timestamp, the next two bytes are the source identifier, etc... with the last
@@ -116,6 +116,60 @@ PLUGIN_API bool isBufferValid(const uint8_t* buffer, int bufferLength);
 /** Computes the validity value for the buffer, this should be called after packing the buffer */
 PLUGIN_API void makeBufferValid(uint8_t* buffer, int bufferLength);
 
+/**
+
+  Holds the spikes that a processor detects in each block, so that they can be
+  passed downstream without being serialized.
+
+  The producer fills SpikeObjects obtained from getNewSpike() in place, and
+  addSpikeEvent() puts a small descriptor pointing at the spike into the
+  MidiBuffer. Downstream processors run in the same graph callback, so they
+  read the spike in place through getSpikeFromEvent(). Only the first
+  nChannels * nSamples values of the waveform are written and read.
+
+  The producer calls clear() at the start of each block; spikes are valid
+  until then. Anything that keeps a spike longer (a display, a record queue)
+  must copy it. Storage is allocated in chunks that are kept and reused, so
+  no allocation happens once the buffer has grown to the busiest block.
+
+*/
+class PLUGIN_API SpikeEventBuffer
+{
+public:
+    SpikeEventBuffer();
+    ~SpikeEventBuffer();
+
+    /** Makes every spike available again, at the start of a block. */
+    void clear();
+
+    /** Returns a spike to fill in; its contents are left from a previous block. */
+    SpikeObject* getNewSpike();
+
+    /** Adds a descriptor for a spike returned by getNewSpike() to a MidiBuffer. */
+    void addSpikeEvent(MidiBuffer& eventBuffer, SpikeObject* spike, int sampleNum);
+
+    int getNumSpikes() const { return numSpikes; }
+
+private:
+    enum { spikesPerChunk = 256 };
+
+    struct SpikeChunk
+    {
+        SpikeObject spikes[spikesPerChunk];
+    };
+
+    OwnedArray<SpikeChunk> chunks;
+    int numSpikes;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeEventBuffer);
+};
+
+/** Size of the MidiBuffer event describing a spike: the event type, the timestamp and a pointer to the spike */
+#define SPIKE_EVENT_DESCRIPTOR_SIZE (1 + 8 + sizeof(SpikeObject*))
+
+/** Returns the spike described by a SPIKE event, or nullptr if the event is not a spike descriptor */
+PLUGIN_API const SpikeObject* getSpikeFromEvent(const MidiMessage& event);
+
 /** Helper function for generating fake spikes in the absence of a real spike source.
   Can be used to generate a sign wave with a fixed Frequency of 1000 hz or a basic spike waveform
   Additionally noise can be added to the waveform for help in diagnosing projection plots */
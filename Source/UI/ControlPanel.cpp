@@ -371,7 +371,8 @@ void ControlPanelButton::setState(bool b)
 
 
 ControlPanel::ControlPanel(ProcessorGraph* graph_, AudioComponent* audio_)
-    : graph(graph_), audio(audio_), initialize(true), open(false), lastEngineIndex(-1)
+    : graph(graph_), audio(audio_), initialize(true), open(false), lastEngineIndex(-1),
+      lastDroppedEvents(0), lastDroppedSpikes(0)
 {
 
     if (1)
@@ -1003,7 +1004,7 @@ void ControlPanel::refreshMeters()
 {
     if (playButton->getToggleState())
     {
-        cpuMeter->updateCPU(audio->deviceManager.getCpuUsage());
+        cpuMeter->updateCPU(audio->getCpuUsage());
     }
     else
     {
@@ -1017,6 +1018,8 @@ void ControlPanel::refreshMeters()
     diskMeter->updateDiskSpace(graph->getRecordNode()->getFreeSpace());
     diskMeter->repaint();
 
+    checkForDroppedEvents();
+
     if (initialize)
     {
         stopTimer();
@@ -1025,6 +1028,24 @@ void ControlPanel::refreshMeters()
     }
 }
 
+void ControlPanel::checkForDroppedEvents()
+{
+    // the counts start over with each recording
+    int droppedEvents = graph->getRecordNode()->getNumDroppedEvents();
+    int droppedSpikes = graph->getRecordNode()->getNumDroppedSpikes();
+
+    if (droppedEvents > lastDroppedEvents || droppedSpikes > lastDroppedSpikes)
+    {
+        String msg = "Record thread fell behind: " + String(droppedEvents) + " events and "
+                     + String(droppedSpikes) + " spikes dropped";
+        std::cout << msg << std::endl;
+        CoreServices::sendStatusMessage(msg);
+    }
+
+    lastDroppedEvents = droppedEvents;
+    lastDroppedSpikes = droppedSpikes;
+}
+
 bool ControlPanel::keyPressed(const KeyPress& key)
 {
     std::cout << "Control panel received" << key.getKeyCode() << std::endl;
@@ -405,6 +405,9 @@ private:
     /** Updates the values displayed by the CPUMeter and DiskSpaceMeter.*/
     void refreshMeters();
 
+    /** Reports events and spikes that the RecordNode had to drop since the last check.*/
+    void checkForDroppedEvents();
+
     bool keyPressed(const KeyPress& key);
 
 
@@ -423,6 +426,9 @@ private:
     ScopedPointer<UtilityButton> recordOptionsButton;
     int lastEngineIndex;
 
+    int lastDroppedEvents;
+    int lastDroppedSpikes;
+
 };
 
 